@@ -79,12 +79,14 @@
 #include "textcolor.h"
 #include "ax25_pad.h"
 #include "hdlc_rec2.h"
+#include "fix_pool.h"
 #include "dlq.h"
 #include "ptt.h"
 #include "dtime_now.h"
 #include "fx25.h"
 #include "il2p.h"
 #include "hdlc_rec.h"
+#include "rx_stats.h"
 
 
 #if 0	/* Typical but not flexible enough. */
@@ -174,6 +176,13 @@ extern float space_gain[MAX_SUBCHANS];
 static void usage (void);
 
 
+static void print_stats_line (void *arg, const char *line)
+{
+	(void)arg;
+	dw_printf ("%s\n", line);
+}
+
+
 static int decode_only = 0;		/* Set to 0 or 1 to decode only one channel.  2 for both.  */
 
 static int sample_number = -1;		/* Sample number from the file. */
@@ -181,6 +190,9 @@ static int sample_number = -1;		/* Sample number from the file. */
 					/* Use to print timestamp, relative to beginning */
 					/* of file, when frame was decoded. */
 
+#define ATEST_BLOCK_SIZE 256		/* Number of samples, for each channel, */
+					/* passed to multi_modem_process_block. */
+
 // command line options.
 
 static int B_opt = DEFAULT_BAUD;	// Bits per second.  Need to change all baud references to bps.
@@ -192,6 +204,7 @@ static char P_opt[16] = "";		// Demodulator profiles.
 static int d_x_opt = 1;			// FX.25 debug.
 static int d_o_opt = 0;			// "-d o" option for DCD output control. */	
 static int d_2_opt = 0;			// "-d 2" option for IL2P details. */
+static int d_s_opt = 0;			// "-d s" option for receive statistics. */
 static int dcd_count = 0;
 static int dcd_missing_errors = 0;
 
@@ -267,7 +280,7 @@ int main (int argc, char *argv[])
 
 	  /* ':' following option character means arg is required. */
 
-          c = getopt_long(argc, argv, "B:P:D:U:gjJF:L:G:012he:d:",
+          c = getopt_long(argc, argv, "B:P:D:U:gjJF:L:G:012he:d:T:X:",
                         long_options, &option_index);
           if (c == -1)
             break;
@@ -311,6 +324,15 @@ int main (int argc, char *argv[])
 
 	    case 'D':				/* -D reduce sampling rate for lower CPU usage. */
 
+	      if (*optarg == '/') {		/* -D /n for shared filter like "//n" in config file. */
+	        my_audio_config.achan[0].decimate_filter = 1;
+	        optarg++;
+	        if (*optarg == '\0') {
+	          dw_printf ("Divide audio sample rate by suitable amount, with filter\n");
+	          break;
+	        }
+	      }
+
 	      decimate = atoi(optarg);
 
 	      dw_printf ("Divide audio sample rate by %d\n", decimate);
@@ -386,6 +408,16 @@ int main (int argc, char *argv[])
 	       my_audio_config.recv_ber = atof(optarg);
 	       break;
 
+	     case 'T':				/* -T number of demodulator threads. */
+
+	       my_audio_config.demod_threads = atoi(optarg);
+	       break;
+
+	     case 'X':				/* -X number of threads to fix bits in background. */
+
+	       my_audio_config.fix_threads = atoi(optarg);
+	       break;
+
 	     case 'd':				/* Debug message options. */
 
 	       for (char *p=optarg; *p!='\0'; p++) {
@@ -393,6 +425,7 @@ int main (int argc, char *argv[])
 	           case 'x':  d_x_opt++; break;			// FX.25
 	           case 'o':  d_o_opt++; break;			// DCD output control
 	           case '2':  d_2_opt++; break;			// IL2P debug out
+	           case 's':  d_s_opt++; break;			// Receive statistics
 	           default: break;
 	        }
 	       }
@@ -641,39 +674,53 @@ int main (int argc, char *argv[])
 /*
  * Initialize the AFSK demodulator and HDLC decoder.
  * Needs to be done for each file because they could have different sample rates.
+ *
+ * We go much faster than real time so the deadline for fixing bits in
+ * the background doesn't mean much.  Wait for them instead.
+ * This must be first so multi_modem_init doesn't start the pool its way.
  */
+	fix_pool_init (my_audio_config.fix_threads, 1);
 	multi_modem_init (&my_audio_config);
 	packets_decoded_one = 0;
 
 
+/*
+ * Samples are collected into a block for each channel then demodulated together.
+ * Time stamps for decoded frames are to the end of the block.
+ */
 	e_o_f = 0;
 	while ( ! e_o_f) 
 	{
+	  static int16_t block[2][ATEST_BLOCK_SIZE];
+	  int nblock = 0;
 
+	  while (nblock < ATEST_BLOCK_SIZE && ! e_o_f) {
 
-          int audio_sample;
-          int c;
+            int audio_sample;
+            int c;
 
-          for (c=0; c<my_audio_config.adev[0].num_channels; c++)
-          {
+            for (c=0; c<my_audio_config.adev[0].num_channels; c++)
+            {
 
-            /* This reads either 1 or 2 bytes depending on */
-            /* bits per sample.  */
+              /* This reads either 1 or 2 bytes depending on */
+              /* bits per sample.  */
 
-            audio_sample = demod_get_sample (ACHAN2ADEV(c));
+              audio_sample = demod_get_sample (ACHAN2ADEV(c));
 
-            if (audio_sample >= 256 * 256) {
-               e_o_f = 1;
-	       continue;
-	    }
+              if (audio_sample >= 256 * 256) {
+                 e_o_f = 1;
+	         continue;
+	      }
 
-	    if (c == 0) sample_number++;
+	      block[c][nblock] = audio_sample;
+            }
+	    if ( ! e_o_f) nblock++;
+	  }
 
-            if (decode_only == 0 && c != 0) continue;
-            if (decode_only == 1 && c != 1) continue;
+	  sample_number += nblock;
 
-            multi_modem_process_sample(c,audio_sample);
-          }
+	  if (decode_only != 1) multi_modem_process_block (0, block[0], nblock);
+	  if (decode_only != 0 && my_audio_config.adev[0].num_channels == 2) multi_modem_process_block (1, block[1], nblock);
 
                 /* When a complete frame is accumulated, */
                 /* process_rec_frame, below, is called. */
@@ -710,6 +757,13 @@ int main (int argc, char *argv[])
 	  dw_printf ("DCD count = %d\n", dcd_count);
 	  dw_printf ("DCD missing errors = %d\n", dcd_missing_errors);
 	}
+	if (d_s_opt) {
+	  for (int ch = 0; ch < MAX_CHANS; ch++) {
+	    if (my_audio_config.chan_medium[ch] == MEDIUM_RADIO) {
+	      rx_stats_report (ch, print_stats_line, NULL);
+	    }
+	  }
+	}
 
 	if (error_if_less_than != -1 && packets_decoded_total < error_if_less_than) {
 	  text_color_set(DW_COLOR_ERROR);
@@ -987,6 +1041,8 @@ static void usage (void) {
 	dw_printf ("        -J     2400 bps QPSK compatible with MFJ-2400.\n");
 	dw_printf ("\n");
 	dw_printf ("        -D n   Divide audio sample rate by n.\n");
+	dw_printf ("        -D /n  Same with low pass filter shared by all demodulators.\n");
+	dw_printf ("               Suitable n is picked if omitted.\n");
 	dw_printf ("\n");
 	dw_printf ("        -h     Print frame contents as hexadecimal bytes.\n");
 	dw_printf ("\n");
@@ -997,6 +1053,8 @@ static void usage (void) {
 	dw_printf ("\n");
 	dw_printf ("        -d x   Debug information for FX.25.  Repeat for more detail.\n");
 	dw_printf ("\n");
+	dw_printf ("        -d s   Receive statistics, such as frames fixed, at the end.\n");
+	dw_printf ("\n");
 	dw_printf ("        -L     Error if less than this number decoded.\n");
 	dw_printf ("\n");
 	dw_printf ("        -G     Error if greater than this number decoded.\n");
@@ -1004,6 +1062,10 @@ static void usage (void) {
 	dw_printf ("        -P m   Select  the  demodulator  type such as D (default for 300 bps),\n");
 	dw_printf ("               E+ (default for 1200 bps), PQRS for 2400 bps, etc.\n");
 	dw_printf ("\n");
+	dw_printf ("        -T n   Number of threads to run multiple demodulators.\n");
+	dw_printf ("\n");
+	dw_printf ("        -X n   Number of threads to fix bits in the background.\n");
+	dw_printf ("\n");
 	dw_printf ("        -0     Use channel 0 (left) of stereo audio (default).\n");
 	dw_printf ("        -1     use channel 1 (right) of stereo audio.\n");
 	dw_printf ("        -2     decode both channels of stereo audio.\n");
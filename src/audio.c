@@ -984,26 +984,24 @@ static int set_oss_params (int a, int fd, struct audio_s *pa)
 
 /*------------------------------------------------------------------
  *
- * Name:        audio_get
+ * Name:        audio_fill
  *
- * Purpose:     Get one byte from the audio device.
+ * Purpose:     Make sure there is something in the input buffer.
  *
  * Inputs:	a	- Our number for audio device.
  *
- * Returns:     0 - 255 for a valid sample.
+ * Returns:     0 for success, with at least one byte available
+ *		  between inbuf_next and inbuf_len.
+ *		  (Could be none for UDP with empty datagram.)
  *              -1 for any type of error.
  *
- * Description:	The caller must deal with the details of mono/stereo
- *		and number of bytes per sample.
- *
- *		This will wait if no data is currently available.
+ * Description:	This will wait if no data is currently available.
+ *		Shared by audio_get and audio_read_samples.
  *
  *----------------------------------------------------------------*/
 
-// Use hot attribute for all functions called for every audio sample.
-
 __attribute__((hot))
-int audio_get (int a)
+static int audio_fill (int a)
 {
 	int n;
 #if USE_ALSA
@@ -1023,7 +1021,7 @@ int audio_get (int a)
 #if DEBUGx
 	text_color_set(DW_COLOR_DEBUG);
 
-	dw_printf ("audio_get():\n");
+	dw_printf ("audio_fill():\n");
 
 #endif
 
@@ -1261,6 +1259,41 @@ int audio_get (int a)
 	}
 
 
+	return (0);
+
+} /* end audio_fill */
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_get
+ *
+ * Purpose:     Get one byte from the audio device.
+ *
+ * Inputs:	a	- Our number for audio device.
+ *
+ * Returns:     0 - 255 for a valid sample.
+ *              -1 for any type of error.
+ *
+ * Description:	The caller must deal with the details of mono/stereo
+ *		and number of bytes per sample.
+ *
+ *		This will wait if no data is currently available.
+ *
+ *----------------------------------------------------------------*/
+
+// Use hot attribute for all functions called for every audio sample.
+
+__attribute__((hot))
+int audio_get (int a)
+{
+	int n;
+
+	if (audio_fill (a) < 0) {
+	  return (-1);
+	}
+
 	if (adev[a].inbuf_next < adev[a].inbuf_len)
 	  n = adev[a].inbuf_ptr[adev[a].inbuf_next++];
 	//No data to read, avoid reading outside buffer
@@ -1280,6 +1313,112 @@ int audio_get (int a)
 } /* end audio_get */
 
 
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_read_samples
+ *
+ * Purpose:     Get a number of audio samples from the audio device.
+ *
+ * Inputs:	a	- Our number for audio device.
+ *		max	- Maximum number of samples, for each channel.
+ *
+ * Outputs:	dst	- Samples, in the range of -32768 to 32767,
+ *			  separated by channel.  Left channel (or mono)
+ *			  goes into dst[0] thru dst[max-1].  Right channel,
+ *			  if stereo, goes into dst[max] thru dst[2*max-1].
+ *
+ * Returns:     Number of samples for each channel.
+ *              -1 for any type of error.
+ *
+ * Description:	This is the same as using demod_get_sample for each sample
+ *		(and each channel) but much less work for the usual case where
+ *		we have a buffer full of complete audio frames.
+ *
+ *		This will wait if no data is currently available but it
+ *		won't wait for more than is already in the buffer.
+ *
+ *----------------------------------------------------------------*/
+
+__attribute__((hot))
+int audio_read_samples (int a, int16_t *dst, int max)
+{
+	int num_chan = save_audio_config_p->adev[a].num_channels;
+	int bytes_per_sample = save_audio_config_p->adev[a].bits_per_sample / 8;
+	int bytes_per_frame = num_chan * bytes_per_sample;
+	int n, k, c;
+
+	assert (num_chan == 1 || num_chan == 2);
+	assert (bytes_per_sample == 1 || bytes_per_sample == 2);
+	assert (max > 0);
+
+	if (audio_fill (a) < 0) {
+	  return (-1);
+	}
+
+	n = (adev[a].inbuf_len - adev[a].inbuf_next) / bytes_per_frame;
+
+	if (n == 0) {
+
+	  // Partial frame left over.  The rest of it will be at the
+	  // beginning of the next read.  Shouldn't happen with a soundcard
+	  // but we have no control over UDP or stdin.  Take it slowly.
+
+	  for (c = 0; c < num_chan; c++) {
+	    int x1, x2;
+
+	    x1 = audio_get (a);
+	    if (x1 < 0) return (-1);
+	    if (bytes_per_sample == 1) {
+	      dst[c * max] = (x1 - 128) * 256;
+	    }
+	    else {
+	      x2 = audio_get (a);
+	      if (x2 < 0) return (-1);
+	      dst[c * max] = (int16_t)((x2 << 8) | x1);
+	    }
+	  }
+	  return (1);
+	}
+
+	if (n > max) n = max;
+
+	const unsigned char *p = adev[a].inbuf_ptr + adev[a].inbuf_next;
+
+	if (bytes_per_sample == 2) {
+
+	  // 16 bit little endian, lower byte first.
+
+	  if (num_chan == 1) {
+	    for (k = 0; k < n; k++) {
+	      dst[k] = (int16_t)(p[2*k] | (p[2*k+1] << 8));
+	    }
+	  }
+	  else {
+	    for (k = 0; k < n; k++) {
+	      dst[k]       = (int16_t)(p[4*k]   | (p[4*k+1] << 8));
+	      dst[max + k] = (int16_t)(p[4*k+2] | (p[4*k+3] << 8));
+	    }
+	  }
+	}
+	else {
+
+	  // 8 bit unsigned.  Scale 0..255 into -32k..+32k
+
+	  for (k = 0; k < n; k++) {
+	    for (c = 0; c < num_chan; c++) {
+	      dst[c * max + k] = (p[k * num_chan + c] - 128) * 256;
+	    }
+	  }
+	}
+
+	adev[a].inbuf_next += n * bytes_per_frame;
+
+	return (n);
+
+} /* end audio_read_samples */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_put
@@ -1317,6 +1456,52 @@ int audio_put (int a, int c)
 } /* end audio_put */
 
 
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_write
+ *
+ * Purpose:     Send a block of bytes to the audio device.
+ *
+ * Inputs:	a
+ *
+ *		buf	- Bytes in the same form as for audio_put.
+ *
+ *		len	- Number of bytes.
+ *
+ * Returns:     Normally non-negative.
+ *              -1 for any type of error.
+ *
+ * Description:	Same result as audio_put for each byte but the output
+ *		buffer is filled a whole piece at a time.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_write (int a, const unsigned char *buf, int len)
+{
+	while (len > 0) {
+	  int n = adev[a].outbuf_size_in_bytes - adev[a].outbuf_len;
+
+	  /* Should never be full at this point. */
+	  assert (n > 0);
+
+	  if (n > len) n = len;
+	  memcpy (adev[a].outbuf_ptr + adev[a].outbuf_len, buf, n);
+	  adev[a].outbuf_len += n;
+	  buf += n;
+	  len -= n;
+
+	  if (adev[a].outbuf_len == adev[a].outbuf_size_in_bytes) {
+	    if (audio_flush(a) < 0) {
+	      return (-1);
+	    }
+	  }
+	}
+
+	return (0);
+
+} /* end audio_write */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_flush
@@ -12,6 +12,8 @@
 #ifndef AUDIO_H
 #define AUDIO_H 1
 
+#include <stdint.h>
+
 #ifdef USE_HAMLIB
 #include <hamlib/rig.h>
 #endif
@@ -113,6 +115,14 @@ struct audio_s {
 					/* This should probably be per channel. One step at a time. */
 					/* v1.7 - replaced by layer2_xmit==LAYER2_FX25 */
 
+	int demod_threads;		/* Number of threads to run the demodulators */
+					/* for a channel.  0 or 1 for the usual */
+					/* case of the audio device receive thread. */
+
+	int fix_threads;		/* Number of threads to try fixing frames with */
+					/* bad CRC in the background.  0 for the usual */
+					/* case of doing it right away. */
+
 	int fx25_auto_enable;		/* Turn on FX.25 for current connected mode session */
 					/* under poor conditions. */
 					/* Set to 0 to disable feature. */
@@ -217,6 +227,14 @@ struct audio_s {
 	    int decimate;		/* Reduce AFSK sample rate by this factor to */
 					/* decrease computational requirements. */
 
+	    int decimate_filter;	/* Do the above once for the channel, with a */
+					/* low pass filter, rather than averaging in */
+					/* each demodulator.  "//n" on MODEM line. */
+
+	    int shared_prefilter;	/* With multiple frequency pairs, use one */
+					/* wider pre filter for all of them. */
+					/* "PREFILTER SHARED" in config file. */
+
 	    int upsample;		/* Upsample by this factor for G3RUH. */
 
             int mark_freq;		/* Two tones for AFSK modulation, in Hz. */
@@ -472,8 +490,12 @@ int audio_open (struct audio_s *pa);
 
 int audio_get (int a);		/* a = audio device, 0 for first */
 
+int audio_read_samples (int a, int16_t *dst, int max);
+
 int audio_put (int a, int c);
 
+int audio_write (int a, const unsigned char *buf, int len);
+
 int audio_flush (int a);
 
 void audio_wait (int a);
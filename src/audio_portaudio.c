@@ -1132,6 +1132,56 @@ int audio_get (int a)
 } /* end audio_get */
 
 
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_read_samples
+ *
+ * Purpose:     Get a number of audio samples from the audio device.
+ *
+ * Inputs:	a	- Our number for audio device.
+ *		max	- Maximum number of samples, for each channel.
+ *
+ * Outputs:	dst	- Samples, in the range of -32768 to 32767,
+ *			  separated by channel.  Left channel (or mono)
+ *			  goes into dst[0] thru dst[max-1].  Right channel,
+ *			  if stereo, goes into dst[max] thru dst[2*max-1].
+ *
+ * Returns:     Number of samples for each channel.
+ *              -1 for any type of error.
+ *
+ * Description:	Same interface as the version in audio.c.
+ *		This simply assembles samples from audio_get.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_read_samples (int a, int16_t *dst, int max)
+{
+	int num_chan = save_audio_config_p->adev[a].num_channels;
+	int bits_per_sample = save_audio_config_p->adev[a].bits_per_sample;
+	int k, c;
+
+	for (k = 0; k < max; k++) {
+	  for (c = 0; c < num_chan; c++) {
+	    int x1, x2;
+
+	    x1 = audio_get (a);
+	    if (x1 < 0) return (-1);
+	    if (bits_per_sample == 8) {
+	      dst[c * max + k] = (x1 - 128) * 256;
+	    }
+	    else {
+	      x2 = audio_get (a);
+	      if (x2 < 0) return (-1);
+	      dst[c * max + k] = (int16_t)((x2 << 8) | x1);
+	    }
+	  }
+	}
+	return (max);
+
+} /* end audio_read_samples */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_put
@@ -1207,6 +1257,46 @@ int audio_put (int a, int c)
 	return (0);
 }
 
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_write
+ *
+ * Purpose:     Send a block of bytes to the audio device.
+ *
+ * Inputs:	a
+ *
+ *		buf	- Bytes in the same form as for audio_put.
+ *
+ *		len	- Number of bytes.
+ *
+ * Returns:     Normally non-negative.
+ *              -1 for any type of error.
+ *
+ * Description:	Same result as audio_put for each byte but the output
+ *		buffer is filled a whole piece at a time.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_write (int a, const unsigned char *buf, int len)
+{
+	while (len > 0) {
+		int n = adev[a].outbuf_size_in_bytes - adev[a].outbuf_len;
+
+		if (n > len) n = len;
+		memcpy (adev[a].outbuf_ptr + adev[a].outbuf_len, buf, n);
+		adev[a].outbuf_len += n;
+		buf += n;
+		len -= n;
+
+		if (adev[a].outbuf_len >= adev[a].outbuf_size_in_bytes) {
+			audio_flush (a);
+		}
+	}
+
+	return (0);
+}
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_flush
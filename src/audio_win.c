@@ -47,6 +47,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <ctype.h>
 #include <io.h>
@@ -912,31 +913,62 @@ int audio_get (int a)
 } /* end audio_get */
 
 
+
 /*------------------------------------------------------------------
  *
- * Name:        audio_put
- *
- * Purpose:     Send one byte to the audio device.
+ * Name:        audio_read_samples
  *
- * Inputs:	a	- Index for audio device.
+ * Purpose:     Get a number of audio samples from the audio device.
  *
- *		c	- One byte in range of 0 - 255.
+ * Inputs:	a	- Our number for audio device.
+ *		max	- Maximum number of samples, for each channel.
  *
+ * Outputs:	dst	- Samples, in the range of -32768 to 32767,
+ *			  separated by channel.  Left channel (or mono)
+ *			  goes into dst[0] thru dst[max-1].  Right channel,
+ *			  if stereo, goes into dst[max] thru dst[2*max-1].
  *
- * Global In:	out_current	- index of output buffer currently being filled.
- *
- * Returns:     Normally non-negative.
+ * Returns:     Number of samples for each channel.
  *              -1 for any type of error.
  *
- * Description:	The caller must deal with the details of mono/stereo
- *		and number of bytes per sample.
- *
- * See Also:	audio_flush
- *		audio_wait
+ * Description:	Same interface as the version in audio.c.
+ *		This simply assembles samples from audio_get.
  *
  *----------------------------------------------------------------*/
 
-int audio_put (int a, int c)
+int audio_read_samples (int a, int16_t *dst, int max)
+{
+	int num_chan = save_audio_config_p->adev[a].num_channels;
+	int bits_per_sample = save_audio_config_p->adev[a].bits_per_sample;
+	int k, c;
+
+	for (k = 0; k < max; k++) {
+	  for (c = 0; c < num_chan; c++) {
+	    int x1, x2;
+
+	    x1 = audio_get (a);
+	    if (x1 < 0) return (-1);
+	    if (bits_per_sample == 8) {
+	      dst[c * max + k] = (x1 - 128) * 256;
+	    }
+	    else {
+	      x2 = audio_get (a);
+	      if (x2 < 0) return (-1);
+	      dst[c * max + k] = (int16_t)((x2 << 8) | x1);
+	    }
+	  }
+	}
+	return (max);
+
+} /* end audio_read_samples */
+
+
+/*
+ * Output buffer currently being filled.  Wait if none are available.
+ * Returns NULL if we give up waiting.
+ */
+
+static WAVEHDR *out_buffer (int a)
 {
 	WAVEHDR *p;
 
@@ -964,7 +996,7 @@ int audio_put (int a, int c)
 	    //dw_printf ("In recent years, this has been reported only when running the\n");
 	    //dw_printf ("Windows version with VMWare on a Macintosh.\n");
 	    ptt_term ();
-	    return (-1);
+	    return (NULL);
 	  }
 	}
 
@@ -981,9 +1013,45 @@ int audio_put (int a, int c)
 	assert (p->dwBufferLength >= 0);
 	assert (p->dwBufferLength < (DWORD)(A->outbuf_size));
 
+	return (p);
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_put
+ *
+ * Purpose:     Send one byte to the audio device.
+ *
+ * Inputs:	a	- Index for audio device.
+ *
+ *		c	- One byte in range of 0 - 255.
+ *
+ *
+ * Global In:	out_current	- index of output buffer currently being filled.
+ *
+ * Returns:     Normally non-negative.
+ *              -1 for any type of error.
+ *
+ * Description:	The caller must deal with the details of mono/stereo
+ *		and number of bytes per sample.
+ *
+ * See Also:	audio_flush
+ *		audio_wait
+ *
+ *----------------------------------------------------------------*/
+
+int audio_put (int a, int c)
+{
+	WAVEHDR *p = out_buffer (a);
+
+	if (p == NULL) {
+	  return (-1);
+	}
+
 	p->lpData[p->dwBufferLength++] = c;
 
-	if (p->dwBufferLength == (DWORD)(A->outbuf_size)) {
+	if (p->dwBufferLength == (DWORD)(adev[a].outbuf_size)) {
 	  return (audio_flush(a));
 	}
 
@@ -992,6 +1060,54 @@ int audio_put (int a, int c)
 } /* end audio_put */
 
 
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_write
+ *
+ * Purpose:     Send a block of bytes to the audio device.
+ *
+ * Inputs:	a	- Index for audio device.
+ *
+ *		buf	- Bytes in the same form as for audio_put.
+ *
+ *		len	- Number of bytes.
+ *
+ * Returns:     Normally non-negative.
+ *              -1 for any type of error.
+ *
+ * Description:	Same result as audio_put for each byte but each output
+ *		buffer is filled a whole piece at a time.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_write (int a, const unsigned char *buf, int len)
+{
+	while (len > 0) {
+	  WAVEHDR *p = out_buffer (a);
+
+	  if (p == NULL) {
+	    return (-1);
+	  }
+
+	  int n = adev[a].outbuf_size - p->dwBufferLength;
+	  if (n > len) n = len;
+	  memcpy (p->lpData + p->dwBufferLength, buf, n);
+	  p->dwBufferLength += n;
+	  buf += n;
+	  len -= n;
+
+	  if (p->dwBufferLength == (DWORD)(adev[a].outbuf_size)) {
+	    if (audio_flush(a) < 0) {
+	      return (-1);
+	    }
+	  }
+	}
+
+	return (0);
+
+} /* end audio_write */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_flush
@@ -186,11 +186,116 @@ char *strtok_r(char *str, const char *delim, char **saveptr);
  * Accumulate statistics.
  * If new_count gets much larger than delete_count plus the size of 
  * the transmit queue we have a memory leak.
+ *
+ * Packets are created and deleted by many threads so these
+ * are updated with atomic operations.
+ */
+
+static int new_count = 0;
+static int delete_count = 0;
+static int last_seq_num = 0;
+
+
+/*
+ * Every received frame is copied for the digipeater, IGate, and each
+ * KISS or AGW client, then thrown away soon after.  Rather than going
+ * to malloc and free each time, each thread keeps a few deleted packet
+ * objects for reuse.  No locking is needed because only the owning
+ * thread touches its list.
+ *
+ * A packet deleted by a different thread than the one which created it
+ * simply goes on the deleting thread's list.  Anything beyond
+ * PACKET_CACHE_MAX goes back to free() so a thread which only deletes
+ * can't hoard memory.
+ *
+ * All objects are the same size.  frame_data is updated in place, e.g.
+ * when inserting a digipeater address, so it must always be able to
+ * hold the largest frame.
+ */
+
+#define PACKET_CACHE_MAX 32
+
+static __thread struct packet_s *cache_head = NULL;	/* Linked with nextp. */
+static __thread int cache_count = 0;
+
+/*
+ * Client and command threads come and go.  Whatever is on the list of
+ * a thread that ends must be freed, otherwise it is lost, and the leak
+ * check can't see it because those were already counted as deleted.
+ * A thread specific data destructor does this.  Windows XP has nothing
+ * similar so there is no list there.
  */
 
-static volatile int new_count = 0;
-static volatile int delete_count = 0;
-static volatile int last_seq_num = 0;
+#if __WIN32__
+
+#undef PACKET_CACHE_MAX
+#define PACKET_CACHE_MAX 0
+
+#else
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static __thread int cache_key_set = 0;
+
+static void cache_drain (void *unused)
+{
+	while (cache_head != NULL) {
+	  struct packet_s *p = cache_head;
+	  cache_head = p->nextp;
+	  free (p);
+	}
+	cache_count = 0;
+	cache_key_set = 0;
+}
+
+static void cache_key_create (void)
+{
+	pthread_key_create (&cache_key, cache_drain);
+}
+
+#endif
+
+
+static struct packet_s *packet_alloc (void)
+{
+	struct packet_s *this_p = cache_head;
+
+	if (this_p != NULL) {
+	  cache_head = this_p->nextp;
+	  cache_count--;
+	  return (this_p);
+	}
+
+	this_p = malloc (sizeof (struct packet_s));
+
+	if (this_p == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("ERROR - can't allocate memory in ax25_new.\n");
+	}
+
+	assert (this_p != NULL);
+	return (this_p);
+}
+
+
+static void packet_free (struct packet_s *this_p)
+{
+	if (cache_count < PACKET_CACHE_MAX) {
+#if ! __WIN32__
+	  if ( ! cache_key_set) {
+	    pthread_once (&cache_key_once, cache_key_create);
+	    pthread_setspecific (cache_key, &cache_head);	/* Any non-NULL value. */
+	    cache_key_set = 1;
+	  }
+#endif
+	  this_p->nextp = cache_head;
+	  cache_head = this_p;
+	  cache_count++;
+	  return;
+	}
+	free (this_p);
+}
+
 
 #if AX25MEMDEBUG
 
@@ -233,18 +338,10 @@ int ax25memdebug_seq (packet_t this_p)
  *------------------------------------------------------------------------------*/
 
 
-packet_t ax25_new (void)
+static int new_seq (void)
 {
-	struct packet_s *this_p;
-
-
-#if DEBUG 
-        text_color_set(DW_COLOR_DEBUG);
-        dw_printf ("ax25_new(): before alloc, new=%d, delete=%d\n", new_count, delete_count);
-#endif
-
-	last_seq_num++;
-	new_count++;
+	int nnew = __atomic_add_fetch (&new_count, 1, __ATOMIC_RELAXED);
+	int ndel = __atomic_load_n (&delete_count, __ATOMIC_RELAXED);
 
 /*
  * check for memory leak.
@@ -252,29 +349,37 @@ packet_t ax25_new (void)
 
 // version 1.4 push up the threshold.   We could have considerably more with connected mode.
 
-	//if (new_count > delete_count + 100) {
-	if (new_count > delete_count + 256) {
+	//if (nnew > ndel + 100) {
+	if (nnew > ndel + 256) {
 
 
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Report to WB2OSZ - Memory leak for packet objects.  new=%d, delete=%d\n", new_count, delete_count);
+	  dw_printf ("Report to WB2OSZ - Memory leak for packet objects.  new=%d, delete=%d\n", nnew, ndel);
 #if AX25MEMDEBUG
 	  // Force on debug option to gather evidence.
 	  ax25memdebug_set();
 #endif
 	}
 
-	this_p = calloc(sizeof (struct packet_s), (size_t)1);
+	return (__atomic_add_fetch (&last_seq_num, 1, __ATOMIC_RELAXED));
+}
+
 
-	if (this_p == NULL) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("ERROR - can't allocate memory in ax25_new.\n");
-	}
+packet_t ax25_new (void)
+{
+	struct packet_s *this_p;
 
-	assert (this_p != NULL);
+
+#if DEBUG 
+        text_color_set(DW_COLOR_DEBUG);
+        dw_printf ("ax25_new(): before alloc, new=%d, delete=%d\n", new_count, delete_count);
+#endif
+
+	this_p = packet_alloc ();
+	memset (this_p, 0, sizeof (struct packet_s));
 
 	this_p->magic1 = MAGIC;
-	this_p->seq = last_seq_num;
+	this_p->seq = new_seq ();
 	this_p->magic2 = MAGIC;
 	this_p->num_addr = (-1);
 
@@ -307,7 +412,7 @@ void ax25_delete (packet_t this_p)
 	}
 
 
-	delete_count++;
+	__atomic_add_fetch (&delete_count, 1, __ATOMIC_RELAXED);
 
 #if AX25MEMDEBUG	
 	if (ax25memdebug) {
@@ -320,10 +425,9 @@ void ax25_delete (packet_t this_p)
 	assert (this_p->magic2 == MAGIC);
 	
 	this_p->magic1 = 0;
-	this_p->magic1 = 0;
+	this_p->magic2 = 0;
 
-	//memset (this_p, 0, sizeof (struct packet_s));
-	free (this_p);
+	packet_free (this_p);
 }
 
 
@@ -698,17 +802,16 @@ packet_t ax25_dup_debug (packet_t copy_from, char *src_file, int src_line)
 packet_t ax25_dup (packet_t copy_from)
 #endif
 {
-	int save_seq;
 	packet_t this_p;
 
-	
-	this_p = ax25_new ();
-	assert (this_p != NULL);
+	assert (copy_from->magic1 == MAGIC);
+	assert (copy_from->magic2 == MAGIC);
 
-	save_seq = this_p->seq;
+	this_p = packet_alloc ();		// No need to clear, like ax25_new.
 
 	memcpy (this_p, copy_from, sizeof (struct packet_s));
-	this_p->seq = save_seq;
+	this_p->seq = new_seq ();
+	this_p->nextp = NULL;
 
 #if AX25MEMDEBUG
 	if (ax25memdebug) {	
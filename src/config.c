@@ -62,6 +62,8 @@
 #include "xmit.h"
 #include "tt_text.h"
 #include "ax25_link.h"
+#include "demod_pool.h"
+#include "fix_pool.h"
 
 #if USE_CM108		// Current Linux or Windows only
 #include "cm108.h"
@@ -814,6 +816,8 @@ void config_init (char *fname, struct audio_s *p_audio_config,
 	}
 
 	p_audio_config->fx25_auto_enable = AX25_N2_RETRY_DEFAULT / 2;
+	p_audio_config->demod_threads = 1;
+	p_audio_config->fix_threads = 0;
 
 	/* First channel should always be valid. */
 	/* If there is no ADEVICE, it uses default device in mono. */
@@ -1595,6 +1599,22 @@ void config_init (char *fname, struct audio_s *p_audio_config,
 		  strlcpy (p_audio_config->achan[channel].profiles, t, sizeof(p_audio_config->achan[channel].profiles));
 	        }
 
+		else if (t[0] == '/' && t[1] == '/') {		/* //div - shared filter.  Pick suitable div if omitted. */
+		  int n = atoi(t+2);
+
+	          p_audio_config->achan[channel].decimate_filter = 1;
+                  if (t[2] == '\0') {
+	            p_audio_config->achan[channel].decimate = 0;
+		  }
+                  else if (n >= 1 && n <= 8) {
+	            p_audio_config->achan[channel].decimate = n;
+		  }
+	    	  else {
+	            text_color_set(DW_COLOR_ERROR);
+                    dw_printf ("Line %d: Ignoring unreasonable sample rate division factor of %d.\n", line, n);
+		  }
+		}
+
 		else if (*t == '/') {		/* /div */
 		  int n = atoi(t+1);
 
@@ -1657,6 +1677,31 @@ void config_init (char *fname, struct audio_s *p_audio_config,
 
 
 
+/*
+ * PREFILTER  SHARED | SEPARATE
+ *
+ *	- With multiple frequency pairs, e.g. "MODEM 300 7@30", each
+ *	  demodulator normally has its own band pass filter.
+ *	  SHARED uses one, a little wider, for all of them.
+ *	  This saves CPU time but might decode a little less.
+ */
+
+	  else if (strcasecmp(t, "PREFILTER") == 0) {
+
+	    t = split(NULL,0);
+	    if (t != NULL && strcasecmp(t, "SHARED") == 0) {
+	      p_audio_config->achan[channel].shared_prefilter = 1;
+	    }
+	    else if (t != NULL && strcasecmp(t, "SEPARATE") == 0) {
+	      p_audio_config->achan[channel].shared_prefilter = 0;
+	    }
+	    else {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: PREFILTER must be followed by SHARED or SEPARATE.\n", line);
+	    }
+	  }
+
+
 /*
  * DTMF  		- Enable DTMF decoder.
  *
@@ -2334,6 +2379,60 @@ void config_init (char *fname, struct audio_s *p_audio_config,
    	    }
 	  }
 
+/*
+ * DEMODTHREADS n	- Number of threads used to run the demodulators for a channel.
+ *				Useful with multiple demodulators, e.g. "MODEM 1200 /9" or "MODEM 300 7@30".
+ *				Default 1, for the audio device receive thread only.
+ *				Currently a global setting.
+ */
+
+	  else if (strcasecmp(t, "DEMODTHREADS") == 0) {
+	    int n;
+	    t = split(NULL,0);
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing number for DEMODTHREADS command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n >= 1 && n <= DEMOD_POOL_MAX_THREADS + 1) {
+	      p_audio_config->demod_threads = n;
+	    }
+	    else {
+	      p_audio_config->demod_threads = 1;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Number of demodulator threads should be in range of 1 to %d. Using %d.\n",
+			line, DEMOD_POOL_MAX_THREADS + 1, p_audio_config->demod_threads);
+   	    }
+	  }
+
+/*
+ * FIXTHREADS n		- Number of threads used to try fixing frames with a bad CRC.
+ *				Useful with the higher FIX_BITS levels so a damaged frame
+ *				doesn't hold up the audio.
+ *				Default 0, to do it right away, in the audio receive thread.
+ */
+
+	  else if (strcasecmp(t, "FIXTHREADS") == 0) {
+	    int n;
+	    t = split(NULL,0);
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing number for FIXTHREADS command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n >= 0 && n <= FIX_POOL_MAX_THREADS) {
+	      p_audio_config->fix_threads = n;
+	    }
+	    else {
+	      p_audio_config->fix_threads = 0;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Number of bit fixing threads should be in range of 0 to %d. Using %d.\n",
+			line, FIX_POOL_MAX_THREADS, p_audio_config->fix_threads);
+   	    }
+	  }
+
 /*
  * FX25AUTO n		- Enable Automatic use of FX.25 for connected mode.
  *				Automatically enable, for that session only, when an identical
@@ -0,0 +1,516 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      convolve.c
+ *
+ * Purpose:   	FIR filter kernels for the demodulators.
+ *
+ * Description:	Most of the demodulator CPU time is spent here.
+ *		The AFSK, PSK, and 9600 demodulators each had their own
+ *		copy of the same simple loop.
+ *
+ *		Packagers build for the lowest common denominator so the
+ *		application will run on older computers.  See comments in
+ *		cmake/modules/FindCPUflags.cmake.  That means the newer
+ *		wider vector instructions were never used.
+ *
+ *		Here we compile several versions, each for a different
+ *		instruction set, and pick the best one the CPU supports
+ *		when the application starts up.
+ *
+ *			x86:	SSE2, AVX2 + FMA, AVX-512.
+ *			ARM:	NEON, when enabled at compile time.
+ *				(It is always there for 64 bit ARM.)
+ *			Others:	Plain C and let the compiler do what it can.
+ *
+ *		Different implementations add up the products in a different
+ *		order so the results can differ in the last few bits.
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#include "textcolor.h"
+#include "convolve.h"
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CONV_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+/*-------------------------------------------------------------------
+ *
+ *	Plain C.  Same as what we had before.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((hot))
+static float convolve_generic (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	float sum = 0.0f;
+
+	for (int j = 0; j < taps; j++) {
+	  sum += filter[j] * data[j];
+	}
+	return (sum);
+}
+
+__attribute__((hot))
+static void convolve_iq_generic (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	float sum_i = 0.0f;
+	float sum_q = 0.0f;
+
+	for (int j = 0; j < taps; j++) {
+	  sum_i += filter[j] * data_i[j];
+	  sum_q += filter[j] * data_q[j];
+	}
+	*out_i = sum_i;
+	*out_q = sum_q;
+}
+
+
+#if CONV_X86
+
+/*-------------------------------------------------------------------
+ *
+ *	SSE2 - 4 at a time.
+ *
+ *	Always available for 64 bit x86.  Might not be for 32 bit.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((target("sse2"))) __attribute__((always_inline))
+static inline float hsum_sse (__m128 v)
+{
+	v = _mm_add_ps (v, _mm_movehl_ps (v, v));
+	v = _mm_add_ss (v, _mm_shuffle_ps (v, v, 1));
+	return (_mm_cvtss_f32 (v));
+}
+
+__attribute__((hot)) __attribute__((target("sse2")))
+static float convolve_sse2 (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 8 <= taps; j += 8) {
+	  acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps(filter + j), _mm_loadu_ps(data + j)));
+	  acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps(filter + j + 4), _mm_loadu_ps(data + j + 4)));
+	}
+	if (j + 4 <= taps) {
+	  acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps(filter + j), _mm_loadu_ps(data + j)));
+	  j += 4;
+	}
+
+	float sum = hsum_sse (_mm_add_ps (acc0, acc1));
+	for ( ; j < taps; j++) {
+	  sum += filter[j] * data[j];
+	}
+	return (sum);
+}
+
+__attribute__((hot)) __attribute__((target("sse2")))
+static void convolve_iq_sse2 (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	__m128 acc_i = _mm_setzero_ps();
+	__m128 acc_q = _mm_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 4 <= taps; j += 4) {
+	  __m128 f = _mm_loadu_ps (filter + j);
+	  acc_i = _mm_add_ps (acc_i, _mm_mul_ps (f, _mm_loadu_ps(data_i + j)));
+	  acc_q = _mm_add_ps (acc_q, _mm_mul_ps (f, _mm_loadu_ps(data_q + j)));
+	}
+
+	float sum_i = hsum_sse (acc_i);
+	float sum_q = hsum_sse (acc_q);
+	for ( ; j < taps; j++) {
+	  sum_i += filter[j] * data_i[j];
+	  sum_q += filter[j] * data_q[j];
+	}
+	*out_i = sum_i;
+	*out_q = sum_q;
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ *	AVX2 with fused multiply-add - 8 at a time.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((target("avx2,fma"))) __attribute__((always_inline))
+static inline float hsum_avx (__m256 v)
+{
+	__m128 x = _mm_add_ps (_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	x = _mm_add_ps (x, _mm_movehl_ps (x, x));
+	x = _mm_add_ss (x, _mm_shuffle_ps (x, x, 1));
+	return (_mm_cvtss_f32 (x));
+}
+
+__attribute__((hot)) __attribute__((target("avx2,fma")))
+static float convolve_avx2 (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 16 <= taps; j += 16) {
+	  acc0 = _mm256_fmadd_ps (_mm256_loadu_ps(filter + j), _mm256_loadu_ps(data + j), acc0);
+	  acc1 = _mm256_fmadd_ps (_mm256_loadu_ps(filter + j + 8), _mm256_loadu_ps(data + j + 8), acc1);
+	}
+	if (j + 8 <= taps) {
+	  acc0 = _mm256_fmadd_ps (_mm256_loadu_ps(filter + j), _mm256_loadu_ps(data + j), acc0);
+	  j += 8;
+	}
+
+	float sum = hsum_avx (_mm256_add_ps (acc0, acc1));
+	for ( ; j < taps; j++) {
+	  sum += filter[j] * data[j];
+	}
+	return (sum);
+}
+
+__attribute__((hot)) __attribute__((target("avx2,fma")))
+static void convolve_iq_avx2 (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	__m256 acc_i = _mm256_setzero_ps();
+	__m256 acc_q = _mm256_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 8 <= taps; j += 8) {
+	  __m256 f = _mm256_loadu_ps (filter + j);
+	  acc_i = _mm256_fmadd_ps (f, _mm256_loadu_ps(data_i + j), acc_i);
+	  acc_q = _mm256_fmadd_ps (f, _mm256_loadu_ps(data_q + j), acc_q);
+	}
+
+	float sum_i = hsum_avx (acc_i);
+	float sum_q = hsum_avx (acc_q);
+	for ( ; j < taps; j++) {
+	  sum_i += filter[j] * data_i[j];
+	  sum_q += filter[j] * data_q[j];
+	}
+	*out_i = sum_i;
+	*out_q = sum_q;
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ *	AVX-512 - 16 at a time.
+ *
+ *	A masked load takes care of the leftovers at the end.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((hot)) __attribute__((target("avx512f")))
+static float convolve_avx512 (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	__m512 acc = _mm512_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 16 <= taps; j += 16) {
+	  acc = _mm512_fmadd_ps (_mm512_loadu_ps(filter + j), _mm512_loadu_ps(data + j), acc);
+	}
+	if (j < taps) {
+	  __mmask16 m = (__mmask16)((1u << (taps - j)) - 1);
+	  acc = _mm512_fmadd_ps (_mm512_maskz_loadu_ps(m, filter + j), _mm512_maskz_loadu_ps(m, data + j), acc);
+	}
+	return (_mm512_reduce_add_ps (acc));
+}
+
+__attribute__((hot)) __attribute__((target("avx512f")))
+static void convolve_iq_avx512 (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	__m512 acc_i = _mm512_setzero_ps();
+	__m512 acc_q = _mm512_setzero_ps();
+	int j = 0;
+
+	for ( ; j + 16 <= taps; j += 16) {
+	  __m512 f = _mm512_loadu_ps (filter + j);
+	  acc_i = _mm512_fmadd_ps (f, _mm512_loadu_ps(data_i + j), acc_i);
+	  acc_q = _mm512_fmadd_ps (f, _mm512_loadu_ps(data_q + j), acc_q);
+	}
+	if (j < taps) {
+	  __mmask16 m = (__mmask16)((1u << (taps - j)) - 1);
+	  __m512 f = _mm512_maskz_loadu_ps (m, filter + j);
+	  acc_i = _mm512_fmadd_ps (f, _mm512_maskz_loadu_ps(m, data_i + j), acc_i);
+	  acc_q = _mm512_fmadd_ps (f, _mm512_maskz_loadu_ps(m, data_q + j), acc_q);
+	}
+	*out_i = _mm512_reduce_add_ps (acc_i);
+	*out_q = _mm512_reduce_add_ps (acc_q);
+}
+
+#endif	/* CONV_X86 */
+
+
+#if CONV_NEON
+
+/*-------------------------------------------------------------------
+ *
+ *	ARM NEON - 4 at a time.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((always_inline))
+static inline float hsum_neon (float32x4_t v)
+{
+#if defined(__aarch64__)
+	return (vaddvq_f32 (v));
+#else
+	float32x2_t x = vadd_f32 (vget_low_f32(v), vget_high_f32(v));
+	x = vpadd_f32 (x, x);
+	return (vget_lane_f32 (x, 0));
+#endif
+}
+
+__attribute__((hot))
+static float convolve_neon (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	float32x4_t acc0 = vdupq_n_f32 (0.0f);
+	float32x4_t acc1 = vdupq_n_f32 (0.0f);
+	int j = 0;
+
+	for ( ; j + 8 <= taps; j += 8) {
+	  acc0 = vmlaq_f32 (acc0, vld1q_f32(filter + j), vld1q_f32(data + j));
+	  acc1 = vmlaq_f32 (acc1, vld1q_f32(filter + j + 4), vld1q_f32(data + j + 4));
+	}
+	if (j + 4 <= taps) {
+	  acc0 = vmlaq_f32 (acc0, vld1q_f32(filter + j), vld1q_f32(data + j));
+	  j += 4;
+	}
+
+	float sum = hsum_neon (vaddq_f32 (acc0, acc1));
+	for ( ; j < taps; j++) {
+	  sum += filter[j] * data[j];
+	}
+	return (sum);
+}
+
+__attribute__((hot))
+static void convolve_iq_neon (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	float32x4_t acc_i = vdupq_n_f32 (0.0f);
+	float32x4_t acc_q = vdupq_n_f32 (0.0f);
+	int j = 0;
+
+	for ( ; j + 4 <= taps; j += 4) {
+	  float32x4_t f = vld1q_f32 (filter + j);
+	  acc_i = vmlaq_f32 (acc_i, f, vld1q_f32(data_i + j));
+	  acc_q = vmlaq_f32 (acc_q, f, vld1q_f32(data_q + j));
+	}
+
+	float sum_i = hsum_neon (acc_i);
+	float sum_q = hsum_neon (acc_q);
+	for ( ; j < taps; j++) {
+	  sum_i += filter[j] * data_i[j];
+	  sum_q += filter[j] * data_q[j];
+	}
+	*out_i = sum_i;
+	*out_q = sum_q;
+}
+
+#endif	/* CONV_NEON */
+
+
+/*-------------------------------------------------------------------
+ *
+ *	Table of available implementations, best first.
+ *
+ *--------------------------------------------------------------------*/
+
+struct convolve_impl_s {
+	const char *name;
+	int (*supported) (void);
+	float (*conv) (const float *data, const float *filter, int taps);
+	void (*conv_iq) (const float *data_i, const float *data_q, const float *filter, int taps, float *out_i, float *out_q);
+};
+
+#if CONV_X86
+static int have_avx512 (void) { return (__builtin_cpu_supports("avx512f")); }
+static int have_avx2 (void) { return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")); }
+static int have_sse2 (void) { return (__builtin_cpu_supports("sse2")); }
+#endif
+static int have_always (void) { return (1); }
+
+static const struct convolve_impl_s impl_table[] = {
+#if CONV_X86
+	{ "AVX-512",	have_avx512,	convolve_avx512,	convolve_iq_avx512 },
+	{ "AVX2",	have_avx2,	convolve_avx2,		convolve_iq_avx2 },
+	{ "SSE2",	have_sse2,	convolve_sse2,		convolve_iq_sse2 },
+#endif
+#if CONV_NEON
+	{ "NEON",	have_always,	convolve_neon,		convolve_iq_neon },
+#endif
+	{ "generic",	have_always,	convolve_generic,	convolve_iq_generic }
+};
+
+#define NUM_IMPL ((int)(sizeof(impl_table) / sizeof(impl_table[0])))
+
+
+float (*convolve_kernel) (const float *data, const float *filter, int taps) = convolve_generic;
+
+void (*convolve_iq_kernel) (const float *data_i, const float *data_q, const float *filter, int taps, float *out_i, float *out_q) = convolve_iq_generic;
+
+static const char *impl_name = "generic";
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        convolve_init
+ *
+ * Purpose:     Select the best implementation for this CPU.
+ *
+ * Description:	Called from each of the demodulator init functions.
+ *		Only the first call does anything.
+ *
+ *--------------------------------------------------------------------*/
+
+void convolve_init (void)
+{
+	static int done = 0;
+
+	if (done) return;
+	done = 1;
+
+#if CONV_X86
+	__builtin_cpu_init ();
+#endif
+	for (int n = 0; n < NUM_IMPL; n++) {
+	  if (impl_table[n].supported()) {
+	    convolve_kernel = impl_table[n].conv;
+	    convolve_iq_kernel = impl_table[n].conv_iq;
+	    impl_name = impl_table[n].name;
+	    break;
+	  }
+	}
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        convolve_impl_name
+ *
+ * Purpose:     Which implementation was selected, for informational
+ *		or debugging purposes.
+ *
+ *--------------------------------------------------------------------*/
+
+const char *convolve_impl_name (void)
+{
+	return (impl_name);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ *	Unit test.  Compare each implementation, that this CPU can
+ *	run, with a double precision reference.
+ *
+ *--------------------------------------------------------------------*/
+
+#if CONVTEST
+
+#define MAXTAPS 500
+
+int main (int argc, char *argv[])
+{
+	static float data[MAXTAPS+1], data2[MAXTAPS+1], filter[MAXTAPS+1];
+	int errors = 0;
+
+	convolve_init ();
+	text_color_set (DW_COLOR_INFO);
+	dw_printf ("Selected implementation: %s\n", convolve_impl_name());
+
+	srand (1);
+	for (int j = 0; j < MAXTAPS+1; j++) {
+	  data[j] = (float)rand() / RAND_MAX - 0.5f;
+	  data2[j] = (float)rand() / RAND_MAX - 0.5f;
+	  filter[j] = (float)rand() / RAND_MAX - 0.5f;
+	}
+
+	for (int n = 0; n < NUM_IMPL; n++) {
+
+	  if ( ! impl_table[n].supported()) {
+	    dw_printf ("%s is not supported by this CPU.  Skipping.\n", impl_table[n].name);
+	    continue;
+	  }
+	  dw_printf ("Testing %s\n", impl_table[n].name);
+
+	  // Try all sizes and an odd alignment to exercise the leftovers.
+
+	  for (int offset = 0; offset <= 1; offset++) {
+	    for (int taps = 0; taps <= MAXTAPS; taps++) {
+	      double ref_i = 0, ref_q = 0;
+	      for (int j = 0; j < taps; j++) {
+	        ref_i += (double)filter[j] * data[j+offset];
+	        ref_q += (double)filter[j] * data2[j+offset];
+	      }
+	      float a = impl_table[n].conv (data + offset, filter, taps);
+	      float b_i, b_q;
+	      impl_table[n].conv_iq (data + offset, data2 + offset, filter, taps, &b_i, &b_q);
+
+	      if (fabs(a - ref_i) > 1e-4 || fabs(b_i - ref_i) > 1e-4 || fabs(b_q - ref_q) > 1e-4) {
+	        text_color_set (DW_COLOR_ERROR);
+	        dw_printf ("%s, taps=%d, offset=%d: expected %.6f %.6f, got %.6f %.6f %.6f\n",
+			impl_table[n].name, taps, offset, ref_i, ref_q, a, b_i, b_q);
+	        text_color_set (DW_COLOR_INFO);
+	        errors++;
+	      }
+	    }
+	  }
+	}
+
+	if (errors) {
+	  text_color_set (DW_COLOR_ERROR);
+	  dw_printf ("\nConvolve test FAILED with %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+
+	text_color_set (DW_COLOR_REC);
+	dw_printf ("\nConvolve test passed.\n");
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
+/* end convolve.c */
@@ -0,0 +1,77 @@
+/* convolve.h */
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H 1
+
+
+/*
+ * FIR filter kernels shared by all of the demodulators.
+ *
+ * The kernels are function pointers so the best implementation for
+ * the CPU can be selected at run time.  convolve_init must be
+ * called before the first use.  It is safe to call more than once.
+ * Use the convolve and convolve_iq wrappers below rather than
+ * calling the kernels directly.
+ *
+ * data is most recent sample first.  Neither needs any special alignment.
+ */
+
+void convolve_init (void);
+
+const char *convolve_impl_name (void);
+
+
+/* Single filter.  Returns sum of data[j] * filter[j] for j = 0 .. taps-1. */
+
+extern float (*convolve_kernel) (const float *data, const float *filter, int taps);
+
+
+/* Same filter applied to two different inputs, such as the I and Q */
+/* mixer outputs.  The filter is read only once for both. */
+
+extern void (*convolve_iq_kernel) (const float *data_i, const float *data_q, const float *filter, int taps, float *out_i, float *out_q);
+
+
+/*
+ * Very short filters, such as for 9600 baud at 44100 samples per second,
+ * are over before the vector version gets going.  The call through a
+ * pointer costs more than the work.  Keep those inline.
+ */
+
+#define CONVOLVE_SHORT 16
+
+__attribute__((hot)) __attribute__((always_inline))
+static inline float convolve (const float *__restrict__ data, const float *__restrict__ filter, int taps)
+{
+	if (taps < CONVOLVE_SHORT) {
+	  float sum = 0.0f;
+	  for (int j = 0; j < taps; j++) {
+	    sum += filter[j] * data[j];
+	  }
+	  return (sum);
+	}
+	return ((*convolve_kernel)(data, filter, taps));
+}
+
+__attribute__((hot)) __attribute__((always_inline))
+static inline void convolve_iq (const float *__restrict__ data_i, const float *__restrict__ data_q,
+			const float *__restrict__ filter, int taps, float *out_i, float *out_q)
+{
+	if (taps < CONVOLVE_SHORT) {
+	  float sum_i = 0.0f;
+	  float sum_q = 0.0f;
+	  for (int j = 0; j < taps; j++) {
+	    sum_i += filter[j] * data_i[j];
+	    sum_q += filter[j] * data_q[j];
+	  }
+	  *out_i = sum_i;
+	  *out_q = sum_q;
+	  return;
+	}
+	(*convolve_iq_kernel)(data_i, data_q, filter, taps, out_i, out_q);
+}
+
+
+#endif
+
+/* end convolve.h */
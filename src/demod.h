@@ -2,6 +2,8 @@
 
 /* demod.h */
 
+#include <stdint.h>		/* for int16_t */
+
 #include "audio.h" 	/* for struct audio_s */
 #include "ax25_pad.h"	/* for alevel_t */
 
@@ -12,8 +14,18 @@ void demod_mute_input (int chan, int mute);
 
 int demod_get_sample (int a);
 
+void demod_shared_block (int chan, const int16_t *samples, int n);
+
 void demod_process_sample (int chan, int subchan, int sam);
 
+void demod_process_block (int chan, int subchan, const int16_t *samples, int n);
+
+int demod_block_position (int chan, int subchan);
+
+int demod_front_end_factor (int chan);
+
+int demod_front_end_block (int chan, const int16_t *in, int n, int16_t *out);
+
 void demod_print_agc (int chan, int subchan);
 
 alevel_t demod_get_audio_level (int chan, int subchan);
@@ -61,6 +61,7 @@
 #include "demod_9600.h"
 #include "textcolor.h"
 #include "dsp.h"
+#include "convolve.h"
 
 
 
@@ -78,21 +79,6 @@ static inline void push_sample (float val, float *buff, int size)
 }
 
 
-/* FIR filter kernel. */
-
-__attribute__((hot)) __attribute__((always_inline))
-static inline float convolve (const float *__restrict__ data, const float *__restrict__ filter, int filter_size)
-{
-	float sum = 0.0f;
-	int j;
-
-//#pragma GCC ivdep				// ignored until gcc 4.9
-	for (j=0; j<filter_size; j++) {
-	    sum += filter[j] * data[j];
-	}
-	return (sum);
-}
-
 /* Automatic gain control. */
 /* Result should settle down to 1 unit peak to peak.  i.e. -0.5 to +0.5 */
 
@@ -151,6 +137,8 @@ void demod_9600_init (enum modem_t modem_type, int original_sample_rate, int ups
 	if (upsample > 4) upsample = 4;
 
 
+	convolve_init ();
+
 	memset (D, 0, sizeof(struct demodulator_state_s));
 	D->modem_type = modem_type;
 	D->num_slicers = 1;
@@ -383,8 +371,8 @@ inline static void nudge_pll (int chan, int subchan, int slice, float demod_out,
 static void process_filtered_sample (int chan, float fsam, struct demodulator_state_s *D);
 
 
-__attribute__((hot))
-void demod_9600_process_sample (int chan, int sam, int upsample, struct demodulator_state_s *D)
+__attribute__((hot)) __attribute__((always_inline))
+static inline void process_one_sample (int chan, int sam, int upsample, struct demodulator_state_s *D)
 {
 	float fsam;
 
@@ -393,11 +381,6 @@ void demod_9600_process_sample (int chan, int sam, int upsample, struct demodula
 	static int log_file_seq = 0;		/* Part of log file name */
 #endif
 
-	int subchan = 0;
-
-	assert (chan >= 0 && chan < MAX_CHANS);
-	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
-
 	/* Scale to nice number for convenience. */
 	/* Consistent with the AFSK demodulator, we'd like to use */
 	/* only half of the dynamic range to have some headroom. */
@@ -426,6 +409,33 @@ void demod_9600_process_sample (int chan, int sam, int upsample, struct demodula
 }
 
 
+__attribute__((hot))
+void demod_9600_process_sample (int chan, int sam, int upsample, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	process_one_sample (chan, sam, upsample, D);
+}
+
+
+/*
+ * Same thing for a buffer of samples.
+ * Sanity checks are done once and the loop body is inlined.
+ */
+
+__attribute__((hot))
+void demod_9600_process_block (int chan, const int16_t *samples, int n, int upsample, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	for (int k = 0; k < n; k++) {
+	  D->block_pos = k;
+	  alevel_rec_sample (D, samples[k] / 16384.0f);
+	  process_one_sample (chan, samples[k], upsample, D);
+	}
+}
+
+
 __attribute__((hot))
 static void process_filtered_sample (int chan, float fsam, struct demodulator_state_s *D)
 {
@@ -610,8 +620,12 @@ inline static void nudge_pll (int chan, int subchan, int slice, float demod_out_
 	if ( D->slicer[slice].prev_d_c_pll > 1000000000 && D->slicer[slice].data_clock_pll < -1000000000) {
 
 	  /* Overflow.  Was large positive, wrapped around, now large negative. */
+	  /* After AGC, a full strength bit is +-0.5.  Quality is 0 to 100 like the others. */
+
+	  int quality = fabsf(demod_out_f) * 200.0f;
+	  if (quality > 100) quality = 100;
 
-	  hdlc_rec_bit (chan, subchan, slice, demod_out_f > 0, D->modem_type == MODEM_SCRAMBLE, D->slicer[slice].lfsr);
+	  hdlc_rec_bit (chan, subchan, slice, demod_out_f > 0, D->modem_type == MODEM_SCRAMBLE, quality);
 	  pll_dcd_each_symbol2 (D, chan, subchan, slice);
 	}
 
@@ -10,6 +10,8 @@ void demod_9600_init (enum modem_t modem_type, int original_sample_rate, int ups
 
 void demod_9600_process_sample (int chan, int sam, int upsample, struct demodulator_state_s *D);
 
+void demod_9600_process_block (int chan, const int16_t *samples, int n, int upsample, struct demodulator_state_s *D);
+
 
 
 
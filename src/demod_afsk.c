@@ -59,6 +59,8 @@
 #include "textcolor.h"
 #include "demod_afsk.h"
 #include "dsp.h"
+#include "convolve.h"
+#include "fft_filter.h"
 
 #define MIN(a,b) ((a)<(b)?(a):(b))
 #define MAX(a,b) ((a)>(b)?(a):(b))
@@ -79,6 +81,8 @@ static float fcos256_table[256];
 #define fsin256(x) (fcos256_table[(((x)>>24)-64)&0xff])
 
 static void nudge_pll (int chan, int subchan, int slice, float demod_out, struct demodulator_state_s *D, float amplitude);
+static inline void nudge_pll_multi (int chan, int subchan, const float *demod_out, const float *amplitude, struct demodulator_state_s *D);
+static void multi_slicer_setup (struct demodulator_state_s *D);
 
 
 /* Quick approximation to sqrt(x*x + y*y) */
@@ -104,31 +108,36 @@ static inline float fast_hypot(float x, float y)
 }
 
 
-/* Add sample to buffer and shift the rest down. */
+/*
+ * Circular history for the filters.
+ *
+ * Originally we shifted the whole buffer down for each new sample.
+ * With up to 7 buffers of a few hundred samples each, that added up.
+ *
+ * Now the buffer is twice the filter size and each sample is stored
+ * in two places, 'size' apart.  The most recent 'size' samples are
+ * then always contiguous, newest first, starting at buff + ix, so
+ * the convolution can use them directly.
+ */
+
+/* Move to the position for the next sample.  Returns new index. */
 
 __attribute__((hot)) __attribute__((always_inline))
-static inline void push_sample (float val, float *buff, int size)
+static inline int ring_advance (int ix, int size)
 {
-	memmove(buff+1,buff,(size-1)*sizeof(float));
-	buff[0] = val; 
+	return ((ix > 0 ? ix : size) - 1);
 }
 
-
-/* FIR filter kernel. */
+/* Put sample at current position and its mirror image. */
 
 __attribute__((hot)) __attribute__((always_inline))
-static inline float convolve (const float *__restrict__ data, const float *__restrict__ filter, int filter_taps)
+static inline void ring_put (float val, float *buff, int ix, int size)
 {
-	float sum = 0.0f;
-	int j;
-
-//#pragma GCC ivdep				// ignored until gcc 4.9
-	for (j=0; j<filter_taps; j++) {
-	    sum += filter[j] * data[j];
-	}
-	return (sum);
+	buff[ix] = val;
+	buff[ix + size] = val;
 }
 
+
 // Automatic Gain control - used when we have a single slicer.
 //
 // The first step is to create an envelope for the peak and valley
@@ -241,10 +250,16 @@ void demod_afsk_init (int samples_per_sec, int baud, int mark_freq,
 	
 	int j;
 
+	convolve_init ();
+
 	for (j = 0; j < 256; j++) {
 	  fcos256_table[j] = cosf((float)j * 2.0f * (float)M_PI / 256.0f);
 	}
 	
+	fft_filter_delete (D->pre_fft);		// In case this is not the first time.
+	fft_filter_delete (D->lp_fft[0]);
+	fft_filter_delete (D->lp_fft[1]);
+
 	memset (D, 0, sizeof(struct demodulator_state_s));
 	D->num_slicers = 1;
 
@@ -505,6 +520,25 @@ void demod_afsk_init (int samples_per_sec, int baud, int mark_freq,
 	  gen_lowpass (fc, D->lp_filter, D->lp_filter_taps, D->lp_window);
 	}
 
+/*
+ * Long filters can be applied faster with FFT when we get
+ * a block of samples at a time.
+ */
+	fft_filter_init ();
+
+	TUNE("TUNE_FFT_MIN_TAPS", fft_filter_min_taps, "fft_filter_min_taps", "%d")
+
+	if (D->use_prefilter && D->pre_filter_taps >= fft_filter_min_taps) {
+	  D->pre_fft = fft_filter_new (D->pre_filter, D->pre_filter_taps);
+	}
+
+	if (D->lp_filter_taps >= fft_filter_min_taps) {
+	  D->lp_fft[0] = fft_filter_new (D->lp_filter, D->lp_filter_taps);
+	  if (D->profile != 'B' && D->profile != 'D') {
+	    D->lp_fft[1] = fft_filter_new (D->lp_filter, D->lp_filter_taps);
+	  }
+	}
+
 
 /*
  * Starting with version 1.2
@@ -601,199 +635,233 @@ void demod_afsk_init (int samples_per_sec, int baud, int mark_freq,
 
 
 
-__attribute__((hot))
-void demod_afsk_process_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
-{
-#if DEBUG4
-	static FILE *demod_log_fp = NULL;
-	static int seq = 0;			/* for log file name */
-#endif
+/*
+ * The rest of the demodulator, after the low pass filters.
+ * Shared by the sample at a time and the block versions.
+ */
 
-	assert (chan >= 0 && chan < MAX_CHANS);
-	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+__attribute__((hot)) __attribute__((always_inline))
+static inline void profile_a_detect (int chan, int subchan, float m_I, float m_Q, float s_I, float s_Q, struct demodulator_state_s *D)
+{
+	float m_amp = fast_hypot(m_I, m_Q);
+	float s_amp = fast_hypot(s_I, s_Q);
 
-/* 
- * Filters use last 'filter_taps' samples.
- *
- * First push the older samples down. 
- *
- * Finally, put the most recent at the beginning.
- *
- * Future project?  Can we do better than shifting each time?
+/*
+ * Capture the mark and space peak amplitudes for display.
+ * It uses fast attack and slow decay to get an idea of the
+ * overall amplitude.
  */
+	if (m_amp >= D->alevel_mark_peak) {
+	  D->alevel_mark_peak = m_amp * D->quick_attack + D->alevel_mark_peak * (1.0f - D->quick_attack);
+	}
+	else {
+	  D->alevel_mark_peak = m_amp * D->sluggish_decay + D->alevel_mark_peak * (1.0f - D->sluggish_decay);
+	}
 
-	/* Scale to nice number. */
+	if (s_amp >= D->alevel_space_peak) {
+	  D->alevel_space_peak = s_amp * D->quick_attack + D->alevel_space_peak * (1.0f - D->quick_attack);
+	}
+	else {
+	  D->alevel_space_peak = s_amp * D->sluggish_decay + D->alevel_space_peak * (1.0f - D->sluggish_decay);
+	}
 
-	float fsam = (float)sam / 16384.0f;
+	if (D->num_slicers <= 1) {
 
-	switch (D->profile) {
+	  // Which tone is stonger?  That's simple with an ideal signal.
+	  // However, we don't see too many ideal signals.
+	  // Due to mismatching pre-emphasis and de-emphasis, the two
+	  // tones will often have greatly different amplitudes so we use
+	  // automatic gain control (AGC) to scale each to the same range
+	  // before comparing.
+	  // This is probably over complicated and could be combined with
+	  // the signal amplitude measurement, above.
+	  // It works so let's move along to other topics.
 
-	  case 'E':
-	  default:
-	  case 'A': {
-				/* ========== New in Version 1.7 ========== */
+	  float m_norm = agc (m_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->m_peak), &(D->m_valley));
+	  float s_norm = agc (s_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->s_peak), &(D->s_valley));
 
-				//	Cleaner & simpler than earlier 'A' thru 'E'
+	  // The normalized values should be around -0.5 to +0.5 so the difference
+	  // should work out to be around -1 to +1.
+	  // This is important because nudge_pll uses the demod_out amplitude to assign
+	  // a quality or confidence score to the symbol.
 
-	    if (D->use_prefilter) {
-	      push_sample (fsam, D->raw_cb, D->pre_filter_taps);
-	      fsam = convolve (D->raw_cb, D->pre_filter, D->pre_filter_taps);
-	    }
+	  float demod_out = m_norm - s_norm;
 
-	    push_sample (fsam * fcos256(D->u.afsk.m_osc_phase), D->u.afsk.m_I_raw, D->lp_filter_taps);
-	    push_sample (fsam * fsin256(D->u.afsk.m_osc_phase), D->u.afsk.m_Q_raw, D->lp_filter_taps);
-	    D->u.afsk.m_osc_phase += D->u.afsk.m_osc_delta;
+	  // Tested and it looks good.  Range of about -1 to +1.
+	  //printf ("JWL DEBUG demod A with agc = %6.2f\n", demod_out);
 
-	    push_sample (fsam * fcos256(D->u.afsk.s_osc_phase), D->u.afsk.s_I_raw, D->lp_filter_taps);
-	    push_sample (fsam * fsin256(D->u.afsk.s_osc_phase), D->u.afsk.s_Q_raw, D->lp_filter_taps);
-	    D->u.afsk.s_osc_phase += D->u.afsk.s_osc_delta;
+	  nudge_pll (chan, subchan, 0, demod_out, D, 1.0);
 
-	    float m_I = convolve (D->u.afsk.m_I_raw, D->lp_filter, D->lp_filter_taps);
-	    float m_Q = convolve (D->u.afsk.m_Q_raw, D->lp_filter, D->lp_filter_taps);
-	    float m_amp = fast_hypot(m_I, m_Q);
+	}
+	else {
+	  // Multiple slice case.
+	  // Rather than trying to find the best threshold location, use multiple 
+	  // slicer thresholds in parallel.
+	  // The best slicing point will vary from packet to packet but should
+	  // remain about the same for a given packet.
 
-	    float s_I = convolve (D->u.afsk.s_I_raw, D->lp_filter, D->lp_filter_taps);
-	    float s_Q = convolve (D->u.afsk.s_Q_raw, D->lp_filter, D->lp_filter_taps);
-	    float s_amp = fast_hypot(s_I, s_Q);
+	  // We are not performing the AGC step here but still want the envelope
+	  // for caluculating the confidence level (or quality) of the sample.
 
-/*
- * Capture the mark and space peak amplitudes for display.
- * It uses fast attack and slow decay to get an idea of the
- * overall amplitude.
- */
-	    if (m_amp >= D->alevel_mark_peak) {
-	      D->alevel_mark_peak = m_amp * D->quick_attack + D->alevel_mark_peak * (1.0f - D->quick_attack);
-	    }
-	    else {
-	      D->alevel_mark_peak = m_amp * D->sluggish_decay + D->alevel_mark_peak * (1.0f - D->sluggish_decay);
-	    }
+	  (void) agc (m_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->m_peak), &(D->m_valley));
+	  (void) agc (s_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->s_peak), &(D->s_valley));
 
-	    if (s_amp >= D->alevel_space_peak) {
-	      D->alevel_space_peak = s_amp * D->quick_attack + D->alevel_space_peak * (1.0f - D->quick_attack);
-	    }
-	      else {
-	      D->alevel_space_peak = s_amp * D->sluggish_decay + D->alevel_space_peak * (1.0f - D->sluggish_decay);
-	    }
+	  if (D->u.afsk.ms_num_slicers != D->num_slicers) {
+	    multi_slicer_setup (D);
+	  }
 
-	    if (D->num_slicers <= 1) {
+	  // All slicers at once.  These loops should turn into a few vector instructions.
 
-	      // Which tone is stonger?  That's simple with an ideal signal.
-	      // However, we don't see too many ideal signals.
-	      // Due to mismatching pre-emphasis and de-emphasis, the two
-	      // tones will often have greatly different amplitudes so we use
-	      // automatic gain control (AGC) to scale each to the same range
-	      // before comparing.
-	      // This is probably over complicated and could be combined with
-	      // the signal amplitude measurement, above.
-	      // It works so let's move along to other topics.
+	  float m_span = D->m_peak - D->m_valley;
+	  float s_span = D->s_peak - D->s_valley;
+	  float demod_out[SLICER_LANES] __attribute__((aligned(16)));
+	  float amp[SLICER_LANES] __attribute__((aligned(16)));
 
-	      float m_norm = agc (m_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->m_peak), &(D->m_valley));
-	      float s_norm = agc (s_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->s_peak), &(D->s_valley));
+	  for (int k = 0; k < SLICER_LANES; k++) {
+	    demod_out[k] = m_amp - s_amp * D->u.afsk.ms_gain[k];
+	    amp[k] = 0.5f * (m_span + s_span * D->u.afsk.ms_gain[k]);
+	    amp[k] = amp[k] < 0.0000001f ? 1.0f : amp[k];	// avoid divide by zero with no signal.
+	  }
 
-	      // The normalized values should be around -0.5 to +0.5 so the difference
-	      // should work out to be around -1 to +1.
-	      // This is important because nudge_pll uses the demod_out amplitude to assign
-	      // a quality or confidence score to the symbol.
+	  // Tested and it looks good.  Range of about -1 to +1 relative to amp.
+	  // Biased one way or the other depending on the space gain.
 
-	      float demod_out = m_norm - s_norm;
+	  nudge_pll_multi (chan, subchan, demod_out, amp, D);
+	}
+}
 
-	      // Tested and it looks good.  Range of about -1 to +1.
-	      //printf ("JWL DEBUG demod A with agc = %6.2f\n", demod_out);
 
-	      nudge_pll (chan, subchan, 0, demod_out, D, 1.0);
+__attribute__((hot)) __attribute__((always_inline))
+static inline void profile_b_detect (int chan, int subchan, float c_I, float c_Q, struct demodulator_state_s *D)
+{
+	float phase = atan2f (c_Q, c_I);
+	float rate = phase - D->u.afsk.prev_phase; 
+	if (rate > M_PI) rate -= 2 * M_PI;
+	else if (rate < -M_PI) rate += 2 * M_PI;
+	D->u.afsk.prev_phase = phase;
 
-	    }
-	    else {
-	      // Multiple slice case.
-	      // Rather than trying to find the best threshold location, use multiple 
-	      // slicer thresholds in parallel.
-	      // The best slicing point will vary from packet to packet but should
-	      // remain about the same for a given packet.
+	// Rate is radians per audio sample interval or something like that.
+	// Scale scale that into -1 to +1 for expected tones.
 
-	      // We are not performing the AGC step here but still want the envelope
-	      // for caluculating the confidence level (or quality) of the sample.
+	float norm_rate = rate * D->u.afsk.normalize_rpsam;
 
-	      (void) agc (m_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->m_peak), &(D->m_valley));
-	      (void) agc (s_amp, D->agc_fast_attack, D->agc_slow_decay, &(D->s_peak), &(D->s_valley));
+	// We really don't have mark and space amplitudes available in this case.
 
-	      for (int slice=0; slice<D->num_slicers; slice++) {
-	        float demod_out = m_amp - s_amp * space_gain[slice];
-	        float amp = 0.5f * (D->m_peak - D->m_valley + (D->s_peak - D->s_valley) * space_gain[slice]);
-	        if (amp < 0.0000001f) amp = 1;	// avoid divide by zero with no signal.
+	if (D->num_slicers <= 1) {
 
-	        // Tested and it looks good.  Range of about -1 to +1 relative to amp.
-		// Biased one way or the other depending on the space gain.
-	        //printf ("JWL DEBUG demod A with slicer %d: %6.2f / %6.2f = %6.2f\n", slice, demod_out, amp, demod_out/amp);
+	  float demod_out = norm_rate;
+	  // Tested and it looks good.  Range roughly -1 to +1.
+	  //printf ("JWL DEBUG demod B single = %6.2f\n", demod_out);
 
-	        nudge_pll (chan, subchan, slice, demod_out, D, amp);
-	      }
-	    }
-	  }
-	  break;
+	  nudge_pll (chan, subchan, 0, demod_out, D, 1.0);
 
-	case 'D':
-	case 'B': {
-				/* ========== Version 1.7 Experiment ========== */
+	}
+	else {
 
-				// New - Convert frequency to a value proportional to frequency.
+	  // This would be useful for HF SSB where a tuning error
+	  // would shift the frequency.  Multiple slicing points would
+	  // then compensate for differences in transmit/receive frequencies.
+	  // 
+	  // Where should we set the thresholds?
+	  // I'm thinking something like:
+	  // 	-.5	-.375	-.25	-.125	0	.125	.25	.375	.5
+	  //
+	  // Assuming a 300 Hz shift, this would put slicing thresholds up
+	  // to +-75 Hz from the center.
+
+	  if (D->u.afsk.ms_num_slicers != D->num_slicers) {
+	    multi_slicer_setup (D);
+	  }
 
-	  if (D->use_prefilter) {
-	    push_sample (fsam, D->raw_cb, D->pre_filter_taps);
-	    fsam = convolve (D->raw_cb, D->pre_filter, D->pre_filter_taps);
+	  float demod_out[SLICER_LANES] __attribute__((aligned(16)));
+	  static const float one[SLICER_LANES] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+	  for (int k = 0; k < SLICER_LANES; k++) {
+	    demod_out[k] = norm_rate + D->u.afsk.ms_offset[k];
 	  }
 
-	  push_sample (fsam * fcos256(D->u.afsk.c_osc_phase), D->u.afsk.c_I_raw, D->lp_filter_taps);
-	  push_sample (fsam * fsin256(D->u.afsk.c_osc_phase), D->u.afsk.c_Q_raw, D->lp_filter_taps);
-	  D->u.afsk.c_osc_phase += D->u.afsk.c_osc_delta;
+	  nudge_pll_multi (chan, subchan, demod_out, one, D);
+	}
+}
+
+
 
-	  float c_I = convolve (D->u.afsk.c_I_raw, D->lp_filter, D->lp_filter_taps);
-	  float c_Q = convolve (D->u.afsk.c_Q_raw, D->lp_filter, D->lp_filter_taps);
+__attribute__((hot)) __attribute__((always_inline))
+static inline void process_one_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
+{
+#if DEBUG4
+	static FILE *demod_log_fp = NULL;
+	static int seq = 0;			/* for log file name */
+#endif
 
-	  float phase = atan2f (c_Q, c_I);
-	  float rate = phase - D->u.afsk.prev_phase; 
-	  if (rate > M_PI) rate -= 2 * M_PI;
-	  else if (rate < -M_PI) rate += 2 * M_PI;
-	  D->u.afsk.prev_phase = phase;
+/* 
+ * Filters use last 'filter_taps' samples.
+ *
+ * These are kept in circular buffers, most recent first, starting
+ * at the current index.  See ring_advance and ring_put above.
+ */
 
-	  // Rate is radians per audio sample interval or something like that.
-	  // Scale scale that into -1 to +1 for expected tones.
+	/* Scale to nice number. */
 
-	  float norm_rate = rate * D->u.afsk.normalize_rpsam;
+	float fsam = (float)sam / 16384.0f;
 
-	  // We really don't have mark and space amplitudes available in this case.
+	switch (D->profile) {
 
-	  if (D->num_slicers <= 1) {
+	  case 'E':
+	  default:
+	  case 'A': {
+				/* ========== New in Version 1.7 ========== */
 
-	    float demod_out = norm_rate;
-	    // Tested and it looks good.  Range roughly -1 to +1.
-	    //printf ("JWL DEBUG demod B single = %6.2f\n", demod_out);
+				//	Cleaner & simpler than earlier 'A' thru 'E'
 
-	    nudge_pll (chan, subchan, 0, demod_out, D, 1.0);
+	    if (D->use_prefilter) {
+	      D->raw_cb_ix = ring_advance (D->raw_cb_ix, D->pre_filter_taps);
+	      ring_put (fsam, D->raw_cb, D->raw_cb_ix, D->pre_filter_taps);
+	      fsam = convolve (D->raw_cb + D->raw_cb_ix, D->pre_filter, D->pre_filter_taps);
+	    }
 
-	  }
-	  else {
+	    int ix = D->u.afsk.raw_ix = ring_advance (D->u.afsk.raw_ix, D->lp_filter_taps);
 
-	    // This would be useful for HF SSB where a tuning error
-	    // would shift the frequency.  Multiple slicing points would
-	    // then compensate for differences in transmit/receive frequencies.
-	    // 
-	    // Where should we set the thresholds?
-	    // I'm thinking something like:
-	    // 	-.5	-.375	-.25	-.125	0	.125	.25	.375	.5
-	    //
-	    // Assuming a 300 Hz shift, this would put slicing thresholds up
-	    // to +-75 Hz from the center.
+	    ring_put (fsam * fcos256(D->u.afsk.m_osc_phase), D->u.afsk.m_I_raw, ix, D->lp_filter_taps);
+	    ring_put (fsam * fsin256(D->u.afsk.m_osc_phase), D->u.afsk.m_Q_raw, ix, D->lp_filter_taps);
+	    D->u.afsk.m_osc_phase += D->u.afsk.m_osc_delta;
 
-	    for (int slice=0; slice<D->num_slicers; slice++) {
+	    ring_put (fsam * fcos256(D->u.afsk.s_osc_phase), D->u.afsk.s_I_raw, ix, D->lp_filter_taps);
+	    ring_put (fsam * fsin256(D->u.afsk.s_osc_phase), D->u.afsk.s_Q_raw, ix, D->lp_filter_taps);
+	    D->u.afsk.s_osc_phase += D->u.afsk.s_osc_delta;
 
-	      float offset = -0.5 + slice * (1. / (D->num_slicers - 1));
-	      float demod_out = norm_rate + offset;
+	    float m_I, m_Q;
+	    convolve_iq (D->u.afsk.m_I_raw + ix, D->u.afsk.m_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &m_I, &m_Q);
 
-	      //printf ("JWL DEBUG demod B slice %d, offset = %6.3f, demod_out = %6.2f\n", slice, offset, demod_out);
+	    float s_I, s_Q;
+	    convolve_iq (D->u.afsk.s_I_raw + ix, D->u.afsk.s_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &s_I, &s_Q);
 
-	      nudge_pll (chan, subchan, slice, demod_out, D, 1.0);
-	    }
+	    profile_a_detect (chan, subchan, m_I, m_Q, s_I, s_Q, D);
 	  }
+	  break;
+
+	case 'D':
+	case 'B': {
+				/* ========== Version 1.7 Experiment ========== */
+
+				// New - Convert frequency to a value proportional to frequency.
+
+	  if (D->use_prefilter) {
+	    D->raw_cb_ix = ring_advance (D->raw_cb_ix, D->pre_filter_taps);
+	    ring_put (fsam, D->raw_cb, D->raw_cb_ix, D->pre_filter_taps);
+	    fsam = convolve (D->raw_cb + D->raw_cb_ix, D->pre_filter, D->pre_filter_taps);
+	  }
+
+	  int ix = D->u.afsk.raw_ix = ring_advance (D->u.afsk.raw_ix, D->lp_filter_taps);
+
+	  ring_put (fsam * fcos256(D->u.afsk.c_osc_phase), D->u.afsk.c_I_raw, ix, D->lp_filter_taps);
+	  ring_put (fsam * fsin256(D->u.afsk.c_osc_phase), D->u.afsk.c_Q_raw, ix, D->lp_filter_taps);
+	  D->u.afsk.c_osc_phase += D->u.afsk.c_osc_delta;
+
+	  float c_I, c_Q;
+	  convolve_iq (D->u.afsk.c_I_raw + ix, D->u.afsk.c_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &c_I, &c_Q);
+
+	  profile_b_detect (chan, subchan, c_I, c_Q, D);
 	  }
 	  break;
 	}
@@ -831,9 +899,224 @@ void demod_afsk_process_sample (int chan, int subchan, int sam, struct demodulat
 #endif
 
 
+} /* end process_one_sample */
+
+
+__attribute__((hot))
+void demod_afsk_process_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+	// Always the direct form here.  FFT needs a block to be worthwhile.
+
+	if (D->pre_fft != NULL || D->lp_fft[0] != NULL) {
+	  D->fft_stale = 1;
+	}
+
+	process_one_sample (chan, subchan, sam, D);
+
 } /* end demod_afsk_process_sample */
 
 
+/*
+ * Same thing for a buffer of samples.
+ * Sanity checks are done once and the loop body is inlined so the
+ * demodulator state can stay in registers between samples.
+ */
+
+static void process_block_staged (int chan, int subchan, const int16_t *samples, const float *filtered, int n, struct demodulator_state_s *D);
+
+__attribute__((hot))
+void demod_afsk_process_block (int chan, int subchan, const int16_t *samples, int n, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+	if (D->pre_fft != NULL || D->lp_fft[0] != NULL) {
+	  process_block_staged (chan, subchan, samples, NULL, n, D);
+	  return;
+	}
+
+	for (int k = 0; k < n; k++) {
+	  D->block_pos = k;
+	  alevel_rec_sample (D, samples[k] / 16384.0f);
+	  process_one_sample (chan, subchan, samples[k], D);
+	}
+
+} /* end demod_afsk_process_block */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        demod_afsk_process_prefiltered
+ *
+ * Purpose:     Same as demod_afsk_process_block but the band pass
+ *		pre filter has already been applied.
+ *
+ * Inputs:	samples		- Original audio, for the level display.
+ *				  NULL if the caller already took care of that.
+ *		filtered	- After the pre filter, same scale as the
+ *				  demodulator uses:  sample / 16384.
+ *		n		- Number of samples.
+ *
+ * Description:	Several demodulators with different tones, such as
+ *		"MODEM 300 7@30" for HF, can share one wider pre filter.
+ *		See demod_shared_block.  The demodulator's own pre filter
+ *		is skipped.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((hot))
+void demod_afsk_process_prefiltered (int chan, int subchan, const int16_t *samples, const float *filtered, int n, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+	process_block_staged (chan, subchan, samples, filtered, n, D);
+}
+
+
+
+/*
+ * Block version with the stages separated.
+ *
+ * Rather than taking each sample all the way through, each step is
+ * done for a whole chunk of samples:  pre filter, mixers, low pass
+ * filters, and then the rest one sample at a time.  This allows
+ * FFT to be used for the filters.
+ *
+ * The circular buffers are still kept up to date so we can switch
+ * back to the direct form.  That's just a store or two per sample.
+ * Very short blocks are faster that way.
+ */
+
+#define FFT_CHUNK 256
+#define FFT_MIN_BLOCK 64
+
+__attribute__((hot))
+static void process_block_staged (int chan, int subchan, const int16_t *samples, const float *filtered, int n, struct demodulator_state_s *D)
+{
+	float x[FFT_CHUNK];
+	float a_i[FFT_CHUNK], a_q[FFT_CHUNK];	// Mark, or center for profile B.
+	float b_i[FFT_CHUNK], b_q[FFT_CHUNK];	// Space.
+	int profile_b = (D->profile == 'B' || D->profile == 'D');
+	fft_filter_t *pre_fft = NULL;
+	fft_filter_t *lp_fft = NULL;
+	int off, len, k;
+
+	if (n >= FFT_MIN_BLOCK) {
+	  pre_fft = filtered == NULL ? D->pre_fft : NULL;
+	  lp_fft = D->lp_fft[0];
+	}
+	else if (D->pre_fft != NULL || D->lp_fft[0] != NULL) {
+	  D->fft_stale = 1;
+	}
+
+	if (D->fft_stale && (pre_fft != NULL || lp_fft != NULL)) {
+	  if (D->pre_fft != NULL) {
+	    fft_filter_set_history (D->pre_fft, D->raw_cb + D->raw_cb_ix, NULL);
+	  }
+	  if (D->lp_fft[0] != NULL) {
+	    int ix = D->u.afsk.raw_ix;
+	    if (profile_b) {
+	      fft_filter_set_history (D->lp_fft[0], D->u.afsk.c_I_raw + ix, D->u.afsk.c_Q_raw + ix);
+	    }
+	    else {
+	      fft_filter_set_history (D->lp_fft[0], D->u.afsk.m_I_raw + ix, D->u.afsk.m_Q_raw + ix);
+	      fft_filter_set_history (D->lp_fft[1], D->u.afsk.s_I_raw + ix, D->u.afsk.s_Q_raw + ix);
+	    }
+	  }
+	  D->fft_stale = 0;
+	}
+
+	for (off = 0; off < n; off += len) {
+	  len = n - off < FFT_CHUNK ? n - off : FFT_CHUNK;
+
+	  if (filtered != NULL) {
+	    memcpy (x, filtered + off, len * sizeof(float));
+	  }
+	  else {
+	    for (k = 0; k < len; k++) {
+	      x[k] = (float)samples[off + k] / 16384.0f;
+	    }
+
+	    if (D->use_prefilter) {
+	      for (k = 0; k < len; k++) {
+	        D->raw_cb_ix = ring_advance (D->raw_cb_ix, D->pre_filter_taps);
+	        ring_put (x[k], D->raw_cb, D->raw_cb_ix, D->pre_filter_taps);
+	        if (pre_fft == NULL) {
+	          x[k] = convolve (D->raw_cb + D->raw_cb_ix, D->pre_filter, D->pre_filter_taps);
+	        }
+	      }
+	      if (pre_fft != NULL) {
+	        fft_filter_real (pre_fft, x, len, x);
+	      }
+	    }
+	  }
+
+	  if (profile_b) {
+	    for (k = 0; k < len; k++) {
+	      int ix = D->u.afsk.raw_ix = ring_advance (D->u.afsk.raw_ix, D->lp_filter_taps);
+
+	      a_i[k] = x[k] * fcos256(D->u.afsk.c_osc_phase);
+	      a_q[k] = x[k] * fsin256(D->u.afsk.c_osc_phase);
+	      ring_put (a_i[k], D->u.afsk.c_I_raw, ix, D->lp_filter_taps);
+	      ring_put (a_q[k], D->u.afsk.c_Q_raw, ix, D->lp_filter_taps);
+	      D->u.afsk.c_osc_phase += D->u.afsk.c_osc_delta;
+
+	      if (lp_fft == NULL) {
+	        convolve_iq (D->u.afsk.c_I_raw + ix, D->u.afsk.c_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &a_i[k], &a_q[k]);
+	      }
+	    }
+	    if (lp_fft != NULL) {
+	      fft_filter_iq (lp_fft, a_i, a_q, len, a_i, a_q);
+	    }
+
+	    for (k = 0; k < len; k++) {
+	      D->block_pos = off + k;
+	      if (samples != NULL) alevel_rec_sample (D, samples[off + k] / 16384.0f);
+	      profile_b_detect (chan, subchan, a_i[k], a_q[k], D);
+	    }
+	  }
+	  else {
+	    for (k = 0; k < len; k++) {
+	      int ix = D->u.afsk.raw_ix = ring_advance (D->u.afsk.raw_ix, D->lp_filter_taps);
+
+	      a_i[k] = x[k] * fcos256(D->u.afsk.m_osc_phase);
+	      a_q[k] = x[k] * fsin256(D->u.afsk.m_osc_phase);
+	      ring_put (a_i[k], D->u.afsk.m_I_raw, ix, D->lp_filter_taps);
+	      ring_put (a_q[k], D->u.afsk.m_Q_raw, ix, D->lp_filter_taps);
+	      D->u.afsk.m_osc_phase += D->u.afsk.m_osc_delta;
+
+	      b_i[k] = x[k] * fcos256(D->u.afsk.s_osc_phase);
+	      b_q[k] = x[k] * fsin256(D->u.afsk.s_osc_phase);
+	      ring_put (b_i[k], D->u.afsk.s_I_raw, ix, D->lp_filter_taps);
+	      ring_put (b_q[k], D->u.afsk.s_Q_raw, ix, D->lp_filter_taps);
+	      D->u.afsk.s_osc_phase += D->u.afsk.s_osc_delta;
+
+	      if (lp_fft == NULL) {
+	        convolve_iq (D->u.afsk.m_I_raw + ix, D->u.afsk.m_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &a_i[k], &a_q[k]);
+	        convolve_iq (D->u.afsk.s_I_raw + ix, D->u.afsk.s_Q_raw + ix, D->lp_filter, D->lp_filter_taps, &b_i[k], &b_q[k]);
+	      }
+	    }
+	    if (lp_fft != NULL) {
+	      fft_filter_iq (D->lp_fft[0], a_i, a_q, len, a_i, a_q);
+	      fft_filter_iq (D->lp_fft[1], b_i, b_q, len, b_i, b_q);
+	    }
+
+	    for (k = 0; k < len; k++) {
+	      D->block_pos = off + k;
+	      if (samples != NULL) alevel_rec_sample (D, samples[off + k] / 16384.0f);
+	      profile_a_detect (chan, subchan, a_i[k], a_q[k], b_i[k], b_q[k], D);
+	    }
+	  }
+	}
+
+} /* end process_block_staged */
+
+
 
 /*
  * Finally, a PLL is used to sample near the centers of the data bits.
@@ -941,4 +1224,100 @@ static void nudge_pll (int chan, int subchan, int slice, float demod_out, struct
 } /* end nudge_pll */
 
 
+
+/*
+ * Same thing for all of the slicers at once.
+ *
+ * The slicer state is laid out as a struct of arrays so the
+ * clock advance, transition check, and phase nudge can be done
+ * for every slicer in a few vector instructions.  Only the rare
+ * symbol boundaries, where a bit goes to the HDLC decoder, are
+ * handled one slicer at a time.
+ *
+ * The results are exactly the same as calling nudge_pll for each.
+ */
+
+#if MAX_SLICERS > SLICER_LANES
+#error "SLICER_LANES must be at least MAX_SLICERS."
+#endif
+
+__attribute__((hot)) __attribute__((always_inline))
+static inline void nudge_pll_multi (int chan, int subchan, const float *demod_out, const float *amplitude, struct demodulator_state_s *D)
+{
+	int32_t *__restrict__ pll = D->u.afsk.ms_pll;
+	int32_t *__restrict__ prev_data = D->u.afsk.ms_prev_data;
+	int32_t *__restrict__ locked = D->u.afsk.ms_locked;
+	int32_t *__restrict__ good = D->u.afsk.ms_good;
+	int32_t *__restrict__ bad = D->u.afsk.ms_bad;
+
+	int32_t wrapped[SLICER_LANES] __attribute__((aligned(16)));
+	int32_t any = 0;
+
+	// Perform the add as unsigned to avoid signed overflow error.
+	// Going from positive to negative is where we sample.
+
+	for (int k = 0; k < SLICER_LANES; k++) {
+	  int32_t prev = pll[k];
+	  pll[k] = (int32_t)((uint32_t)prev + (uint32_t)(D->pll_step_per_sample));
+	  wrapped[k] = (pll[k] < 0) & (prev > 0);
+	  any |= wrapped[k];
+	}
+
+	if (any) {
+	  for (int slice = 0; slice < D->num_slicers; slice++) {
+	    if (wrapped[slice]) {
+
+	      int quality = fabsf(demod_out[slice]) * 100.0f / amplitude[slice];
+	      if (quality > 100) quality = 100;
+
+	      hdlc_rec_bit (chan, subchan, slice, demod_out[slice] > 0, 0, quality);
+
+	      D->slicer[slice].good_flag = good[slice];
+	      D->slicer[slice].bad_flag = bad[slice];
+	      good[slice] = 0;
+	      bad[slice] = 0;
+	      pll_dcd_each_symbol2 (D, chan, subchan, slice);
+	      locked[slice] = D->slicer[slice].data_detect;
+	    }
+	  }
+	}
+
+	// Transitions nudge the DPLL phase toward the incoming signal.
+
+	for (int k = 0; k < SLICER_LANES; k++) {
+	  int32_t demod_data = demod_out[k] > 0;
+	  int32_t transition = demod_data != prev_data[k];
+	  int32_t near = (pll[k] > - DCD_GOOD_WIDTH * 1024 * 1024) & (pll[k] < DCD_GOOD_WIDTH * 1024 * 1024);
+
+	  good[k] |= transition & near;
+	  bad[k] |= transition & ! near;
+
+	  float inertia = locked[k] ? D->pll_locked_inertia : D->pll_searching_inertia;
+	  int32_t nudged = (int32_t)(pll[k] * inertia);
+	  pll[k] = transition ? nudged : pll[k];
+
+	  prev_data[k] = demod_data;
+	}
+
+} /* end nudge_pll_multi */
+
+
+/*
+ * Per slicer constants for nudge_pll_multi.
+ * num_slicers is changed after demod_afsk_init so do this on first use.
+ */
+
+static void multi_slicer_setup (struct demodulator_state_s *D)
+{
+	for (int k = 0; k < SLICER_LANES; k++) {
+	  D->u.afsk.ms_gain[k] = space_gain[k < MAX_SUBCHANS ? k : MAX_SUBCHANS - 1];
+	  D->u.afsk.ms_offset[k] = 0;
+	  if (k < D->num_slicers && D->num_slicers > 1) {
+	    D->u.afsk.ms_offset[k] = -0.5 + k * (1. / (D->num_slicers - 1));
+	  }
+	}
+	D->u.afsk.ms_num_slicers = D->num_slicers;
+}
+
+
 /* end demod_afsk.c */
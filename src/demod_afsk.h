@@ -6,3 +6,7 @@ void demod_afsk_init (int samples_per_sec, int baud, int mark_freq,
 			int space_freq, char profile, struct demodulator_state_s *D);
 
 void demod_afsk_process_sample (int chan, int subchan, int sam, struct demodulator_state_s *D);
+
+void demod_afsk_process_block (int chan, int subchan, const int16_t *samples, int n, struct demodulator_state_s *D);
+
+void demod_afsk_process_prefiltered (int chan, int subchan, const int16_t *samples, const float *filtered, int n, struct demodulator_state_s *D);
@@ -0,0 +1,406 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      demod_pool.c
+ *
+ * Purpose:   	Run the demodulators for one channel on several CPU cores.
+ *
+ * Description:	Each audio device has a single receive thread.  With
+ *		something like "MODEM 1200 /9" or "MODEM 300 7@30", all of
+ *		the demodulators for the channel were run, one after the
+ *		other, by that one thread.  Only one core would be used.
+ *
+ *		Here we have a pool of worker threads.  The caller has
+ *		some number of independent tasks, one for each demodulator.
+ *		The tasks are divided among the workers and the calling thread,
+ *		which also does its share.  We return when they are all done.
+ *
+ *		Different demodulators, and especially the different profiles
+ *		with different numbers of slicers, can take very different
+ *		amounts of time.  Each participant starts off with its own
+ *		list of tasks.  When finished with those, it steals from the
+ *		others rather than sitting idle.
+ *
+ *		Each list is just a range of task numbers, [lo, hi), packed
+ *		into one 64 bit word.  The owner takes from the high end and
+ *		thieves take from the low end.  Both use compare and swap on
+ *		the whole word so there is no locking.
+ *
+ *		If more than one audio device tries to use the pool at
+ *		the same time, the later one simply does its own work.
+ *
+ *		Not available for Windows yet.  The tasks are run by the
+ *		caller, one at a time, as before.
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+
+#if ! __WIN32__
+#include <pthread.h>
+#endif
+
+#include "textcolor.h"
+#include "demod_pool.h"
+
+
+#if ! __WIN32__
+
+#define MAX_PARTICIPANTS (DEMOD_POOL_MAX_THREADS + 1)	// Workers plus caller.
+
+static int num_workers = 0;		// Number of worker threads.  0 if pool not in use.
+
+static pthread_t worker_tid[DEMOD_POOL_MAX_THREADS];
+
+static dw_mutex_t owner_mutex;		// Only one caller can use the pool at a time.
+
+static pthread_mutex_t wake_mutex;	// Protects job_gen.
+static pthread_cond_t wake_cond;	// Workers wait here for a new job.
+static pthread_cond_t done_cond;	// Caller waits here for the last task to finish.
+
+
+/*
+ * Current job.
+ * fn and arg are set before the task lists are published
+ * so anyone who manages to take a task sees the right ones.
+ */
+
+static demod_pool_fn_t job_fn;
+static void *job_arg;
+static int job_remaining;		// Tasks not finished yet.
+static unsigned int job_gen;		// Incremented for each new job.
+
+static uint64_t task_list[MAX_PARTICIPANTS];	// lo in upper 32 bits, hi in lower.
+
+#define PACK(lo,hi) (((uint64_t)(uint32_t)(lo) << 32) | (uint32_t)(hi))
+#define LO(w) ((int)((w) >> 32))
+#define HI(w) ((int)((w) & 0xffffffff))
+
+
+/*
+ * Take a task from the high end of our own list.
+ * Returns task number or -1 if empty.
+ */
+
+static int take_own (int p)
+{
+	uint64_t w = __atomic_load_n (&task_list[p], __ATOMIC_ACQUIRE);
+
+	while (LO(w) < HI(w)) {
+	  if (__atomic_compare_exchange_n (&task_list[p], &w, PACK(LO(w), HI(w) - 1), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	    return (HI(w) - 1);
+	  }
+	  // w now has the latest value.  Try again.
+	}
+	return (-1);
+}
+
+
+/*
+ * Steal a task from the low end of someone else's list.
+ */
+
+static int steal (int q)
+{
+	uint64_t w = __atomic_load_n (&task_list[q], __ATOMIC_ACQUIRE);
+
+	while (LO(w) < HI(w)) {
+	  if (__atomic_compare_exchange_n (&task_list[q], &w, PACK(LO(w) + 1, HI(w)), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	    return (LO(w));
+	  }
+	}
+	return (-1);
+}
+
+
+static void run_task (int task)
+{
+	demod_pool_fn_t fn = __atomic_load_n (&job_fn, __ATOMIC_ACQUIRE);
+	void *arg = __atomic_load_n (&job_arg, __ATOMIC_ACQUIRE);
+
+	(*fn) (arg, task);
+
+	if (__atomic_sub_fetch (&job_remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+	  pthread_mutex_lock (&wake_mutex);
+	  pthread_cond_signal (&done_cond);
+	  pthread_mutex_unlock (&wake_mutex);
+	}
+}
+
+
+/*
+ * Do our own tasks then help the others.
+ */
+
+static void participate (int p)
+{
+	int task;
+	int nparticipants = num_workers + 1;
+
+	while ((task = take_own(p)) >= 0) {
+	  run_task (task);
+	}
+
+	int more = 1;
+	while (more) {
+	  more = 0;
+	  for (int k = 1; k < nparticipants; k++) {
+	    int q = (p + k) % nparticipants;
+	    if ((task = steal(q)) >= 0) {
+	      run_task (task);
+	      more = 1;
+	    }
+	  }
+	}
+}
+
+
+static void * worker_thread (void *arg)
+{
+	int p = (int)(ptrdiff_t)arg;
+	unsigned int my_gen = 0;
+
+	while (1) {
+	  pthread_mutex_lock (&wake_mutex);
+	  while (job_gen == my_gen) {
+	    pthread_cond_wait (&wake_cond, &wake_mutex);
+	  }
+	  my_gen = job_gen;
+	  pthread_mutex_unlock (&wake_mutex);
+
+	  participate (p);
+	}
+
+	return (NULL);
+}
+
+#endif	/* ! __WIN32__ */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        demod_pool_init
+ *
+ * Purpose:     Start up the worker threads.
+ *
+ * Inputs:	num_threads	- Total number of threads to use, including
+ *				  the caller.  0 or 1 means don't use the pool.
+ *
+ * Description:	Can be called more than once, e.g. by atest for each file.
+ *		Threads are started only the first time.
+ *
+ *--------------------------------------------------------------------*/
+
+void demod_pool_init (int num_threads)
+{
+#if __WIN32__
+
+	if (num_threads > 1) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Multiple demodulator threads are not available for Windows yet.\n");
+	}
+
+#else
+	static int was_init = 0;
+
+	if (was_init) return;
+
+	if (num_threads > MAX_PARTICIPANTS) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Number of demodulator threads limited to %d.\n", MAX_PARTICIPANTS);
+	  num_threads = MAX_PARTICIPANTS;
+	}
+
+	if (num_threads <= 1) return;
+
+	was_init = 1;
+
+	dw_mutex_init (&owner_mutex);
+	pthread_mutex_init (&wake_mutex, NULL);
+	pthread_cond_init (&wake_cond, NULL);
+	pthread_cond_init (&done_cond, NULL);
+
+	for (int p = 1; p < num_threads; p++) {
+	  int e = pthread_create (&worker_tid[p-1], NULL, worker_thread, (void *)(ptrdiff_t)p);
+	  if (e != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Could not create demodulator thread %d.  Continuing with %d.\n", p, num_workers + 1);
+	    break;
+	  }
+	  num_workers++;
+	}
+#endif
+
+} /* end demod_pool_init */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        demod_pool_size
+ *
+ * Purpose:     Find how many threads can work on a job.
+ *
+ * Returns:	1 if the pool is not in use.
+ *
+ *--------------------------------------------------------------------*/
+
+int demod_pool_size (void)
+{
+#if __WIN32__
+	return (1);
+#else
+	return (num_workers + 1);
+#endif
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        demod_pool_run
+ *
+ * Purpose:     Run a number of independent tasks and wait for all to finish.
+ *
+ * Inputs:	num_tasks	- Number of tasks.
+ *		fn		- Function to call for each task.
+ *		arg		- Passed along to fn.
+ *
+ * Description:	fn (arg, task) is called once for each task from 0 thru
+ *		num_tasks-1.  The order and the thread are unpredictable.
+ *		Anything done by the tasks is visible to the caller
+ *		after this returns.
+ *
+ *--------------------------------------------------------------------*/
+
+void demod_pool_run (int num_tasks, demod_pool_fn_t fn, void *arg)
+{
+	int task;
+
+#if ! __WIN32__
+
+	if (num_workers > 0 && num_tasks > 1 && dw_mutex_try_lock (&owner_mutex)) {
+
+	  int nparticipants = num_workers + 1;
+
+	  __atomic_store_n (&job_fn, fn, __ATOMIC_RELEASE);
+	  __atomic_store_n (&job_arg, arg, __ATOMIC_RELEASE);
+	  __atomic_store_n (&job_remaining, num_tasks, __ATOMIC_RELEASE);
+
+	  // Divide up the tasks into a contiguous range for each.
+
+	  for (int p = 0; p < nparticipants; p++) {
+	    int lo = num_tasks * p / nparticipants;
+	    int hi = num_tasks * (p + 1) / nparticipants;
+	    __atomic_store_n (&task_list[p], PACK(lo,hi), __ATOMIC_RELEASE);
+	  }
+
+	  pthread_mutex_lock (&wake_mutex);
+	  job_gen++;
+	  pthread_cond_broadcast (&wake_cond);
+	  pthread_mutex_unlock (&wake_mutex);
+
+	  participate (0);
+
+	  pthread_mutex_lock (&wake_mutex);
+	  while (__atomic_load_n (&job_remaining, __ATOMIC_ACQUIRE) != 0) {
+	    pthread_cond_wait (&done_cond, &wake_mutex);
+	  }
+	  pthread_mutex_unlock (&wake_mutex);
+
+	  dw_mutex_unlock (&owner_mutex);
+	  return;
+	}
+#endif
+
+	for (task = 0; task < num_tasks; task++) {
+	  (*fn) (arg, task);
+	}
+
+} /* end demod_pool_run */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Unit test.
+ *
+ * Tasks of very different sizes.  Make sure each is run exactly once.
+ *
+ *--------------------------------------------------------------------*/
+
+#if POOLTEST
+
+static int run_count[100];
+
+static void test_task (void *arg, int task)
+{
+	volatile double x = 0;
+	int n = (task % 7 == 0) ? 200000 : 1000;
+
+	assert (arg == (void *)run_count);
+	for (int j = 0; j < n; j++) {
+	  x += j * 0.5;
+	}
+	__atomic_add_fetch (&run_count[task], 1, __ATOMIC_RELAXED);
+}
+
+int main (int argc, char *argv[])
+{
+	int errors = 0;
+
+	demod_pool_init (4);
+
+	for (int ntasks = 1; ntasks <= 100; ntasks += 3) {
+	  for (int rep = 0; rep < 20; rep++) {
+	    memset (run_count, 0, sizeof(run_count));
+	    demod_pool_run (ntasks, test_task, run_count);
+	    for (int t = 0; t < 100; t++) {
+	      if (run_count[t] != (t < ntasks ? 1 : 0)) {
+	        errors++;
+	      }
+	    }
+	  }
+	}
+
+	if (errors) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("\nDemodulator thread pool test FAILED.  %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+	text_color_set(DW_COLOR_REC);
+	dw_printf ("\nDemodulator thread pool test - PASSED with %d threads.\n", demod_pool_size());
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
+/* end demod_pool.c */
@@ -0,0 +1,26 @@
+/* demod_pool.h */
+
+#ifndef DEMOD_POOL_H
+#define DEMOD_POOL_H 1
+
+
+/*
+ * Worker threads to run the demodulators for a channel in parallel.
+ * See demod_pool.c for details.
+ */
+
+#define DEMOD_POOL_MAX_THREADS 15	// Not including the caller.
+
+
+typedef void (*demod_pool_fn_t) (void *arg, int task);
+
+void demod_pool_init (int num_threads);
+
+int demod_pool_size (void);
+
+void demod_pool_run (int num_tasks, demod_pool_fn_t fn, void *arg);
+
+
+#endif
+
+/* end demod_pool.h */
@@ -100,6 +100,8 @@
 #include "textcolor.h"
 #include "demod_psk.h"
 #include "dsp.h"
+#include "convolve.h"
+#include "fft_filter.h"
 
 
 
@@ -121,24 +123,28 @@ static inline void push_sample (float val, float *buff, int size)
 }
 
 
-/* FIR filter kernel. */
 
-__attribute__((hot)) __attribute__((always_inline))
-static inline float convolve (const float *__restrict__ data, const float *__restrict__ filter, int filter_size)
+
+/* Same thing for a block of samples, oldest first. */
+
+static inline void push_block (const float *val, int n, float *buff, int size)
 {
-	float sum = 0.0;
-	int j;
+	int k;
 
-//Does pragma make any difference?  Annoying warning on Mac.
-//#pragma GCC ivdep
-	for (j=0; j<filter_size; j++) {
-	    sum += filter[j] * data[j];
+	if (n < size) {
+	  memmove(buff+n,buff,(size-n)*sizeof(float));
+	}
+	else {
+	  val += n - size;
+	  n = size;
+	}
+	for (k = 0; k < n; k++) {
+	  buff[k] = val[n-1-k];
 	}
-
-	return (sum);
 }
 
 
+
 /* Might replace this with faster, lower precision, approximation someday if it does not harm results. */
 
 static inline float my_atan2f (float y, float x)
@@ -194,6 +200,12 @@ void demod_psk_init (enum modem_t modem_type, enum v26_e v26_alt, int samples_pe
 	int j;
 
 
+	convolve_init ();
+
+	fft_filter_delete (D->pre_fft);		// In case this is not the first time.
+	fft_filter_delete (D->lp_fft[0]);
+	fft_filter_delete (D->lp_fft[1]);
+
 	memset (D, 0, sizeof(struct demodulator_state_s));
 
 	D->modem_type = modem_type;
@@ -503,6 +515,19 @@ void demod_psk_init (enum modem_t modem_type, enum v26_e v26_alt, int samples_pe
 	float fc = correct_baud * D->u.psk.lpf_baud / (float)samples_per_sec;
 	gen_lowpass (fc, D->u.psk.lp_filter, D->u.psk.lp_filter_taps, D->u.psk.lp_window);
 
+/*
+ * Use FFT for the filters if long enough to be worth it.
+ * Only with higher audio sample rates.
+ */
+	fft_filter_init ();
+
+	if (D->u.psk.use_prefilter && D->u.psk.pre_filter_taps >= fft_filter_min_taps) {
+	  D->pre_fft = fft_filter_new (D->u.psk.pre_filter, D->u.psk.pre_filter_taps);
+	}
+	if (D->u.psk.lp_filter_taps >= fft_filter_min_taps) {
+	  D->lp_fft[0] = fft_filter_new (D->u.psk.lp_filter, D->u.psk.lp_filter_taps);
+	}
+
 /*
  * No point in having multiple numbers for signal level.
  */
@@ -660,14 +685,64 @@ static inline int phase_shift_to_symbol (float phase_shift, int bits_per_symbol,
 
 inline static void nudge_pll (int chan, int subchan, int slice, int demod_bits, struct demodulator_state_s *D, int *bit_quality);
 
-__attribute__((hot))
-void demod_psk_process_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
+/*
+ * The rest of the demodulator, after the low pass filter.
+ * Shared by the sample at a time and the block versions.
+ * Only one slicer, number 0.
+ */
+
+__attribute__((hot)) __attribute__((always_inline))
+static inline void lo_detect (int chan, int subchan, float I, float Q, struct demodulator_state_s *D)
 {
-	int slice = 0;		// Would it make sense to have more than one?
+	float a = my_atan2f(I,Q);
+
+	// This is just a delay line of one symbol time.
+
+	push_sample (a, D->u.psk.delay_line, D->u.psk.delay_line_taps);
+	float delta = a - D->u.psk.delay_line[D->u.psk.boffs];
+
+	int gray;
+	int bit_quality[3];
+	if (D->modem_type == MODEM_QPSK) {
+	  if (D->u.psk.v26_alt == V26_B) {
+	    gray = phase_shift_to_symbol (delta + (float)(-M_PI/4), 2, bit_quality);;	// MFJ compatible
+	  }
+	  else {
+	    gray = phase_shift_to_symbol (delta, 2, bit_quality);	// Classic
+	  }
+	}
+	else {
+	    gray = phase_shift_to_symbol (delta, 3, bit_quality);;	// 8-PSK
+	}
+	nudge_pll (chan, subchan, 0, gray, D, bit_quality);
+}
+
+
+__attribute__((hot)) __attribute__((always_inline))
+static inline void delay_detect (int chan, int subchan, float I, float Q, struct demodulator_state_s *D)
+{
+	int gray;
+	int bit_quality[3];
+	float delta = my_atan2f(I,Q);
+
+	if (D->modem_type == MODEM_QPSK) {
+	  if (D->u.psk.v26_alt == V26_B) {
+	    gray = phase_shift_to_symbol (delta + (float)(M_PI/2), 2, bit_quality);	// MFJ compatible
+	  }
+	  else {
+	    gray = phase_shift_to_symbol (delta + (float)(3*M_PI/4), 2, bit_quality);	// Classic
+	  }
+	}
+	else {
+	  gray = phase_shift_to_symbol (delta + (float)(3*M_PI/2), 3, bit_quality);
+	}
+	nudge_pll (chan, subchan, 0, gray, D, bit_quality);
+}
 
-	assert (chan >= 0 && chan < MAX_CHANS);
-	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
 
+__attribute__((hot)) __attribute__((always_inline))
+static inline void process_one_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
+{
 	/* Scale to nice number for plotting during debug. */
 
 	float fsam = sam / 16384.0f;
@@ -690,33 +765,14 @@ void demod_psk_process_sample (int chan, int subchan, int sam, struct demodulato
 
 	  float sam_x_cos = fsam * D->u.psk.sin_table256[((D->u.psk.lo_phase >> 24) + 64) & 0xff];
 	  push_sample (sam_x_cos, D->u.psk.I_raw, D->u.psk.lp_filter_taps);
-	  float I = convolve (D->u.psk.I_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps);
 
 	  float sam_x_sin = fsam * D->u.psk.sin_table256[(D->u.psk.lo_phase >> 24) & 0xff];
 	  push_sample (sam_x_sin, D->u.psk.Q_raw, D->u.psk.lp_filter_taps);
-	  float Q = convolve (D->u.psk.Q_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps);
 
-	  float a = my_atan2f(I,Q);
+	  float I, Q;
+	  convolve_iq (D->u.psk.I_raw, D->u.psk.Q_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps, &I, &Q);
 
-	  // This is just a delay line of one symbol time.
-
-	  push_sample (a, D->u.psk.delay_line, D->u.psk.delay_line_taps);
-	  float delta = a - D->u.psk.delay_line[D->u.psk.boffs];
-
-	  int gray;
-	  int bit_quality[3];
-	  if (D->modem_type == MODEM_QPSK) {
-	    if (D->u.psk.v26_alt == V26_B) {
-	      gray = phase_shift_to_symbol (delta + (float)(-M_PI/4), 2, bit_quality);;	// MFJ compatible
-	    }
-	    else {
-	      gray = phase_shift_to_symbol (delta, 2, bit_quality);	// Classic
-	    }
-	  }
-	  else {
-	      gray = phase_shift_to_symbol (delta, 3, bit_quality);;	// 8-PSK
-	  }
-	  nudge_pll (chan, subchan, slice, gray, D, bit_quality);
+	  lo_detect (chan, subchan, I, Q, D);
 
 	  D->u.psk.lo_phase += D->u.psk.lo_step;
 	}
@@ -728,31 +784,147 @@ void demod_psk_process_sample (int chan, int subchan, int sam, struct demodulato
 
 	  float sam_x_cos = fsam *  D->u.psk.delay_line[D->u.psk.coffs];
 	  push_sample (sam_x_cos, D->u.psk.I_raw, D->u.psk.lp_filter_taps);
-	  float I = convolve (D->u.psk.I_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps);
 
 	  float sam_x_sin = fsam *  D->u.psk.delay_line[D->u.psk.soffs];
 	  push_sample (sam_x_sin, D->u.psk.Q_raw, D->u.psk.lp_filter_taps);
-	  float Q = convolve (D->u.psk.Q_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps);
 
-	  int gray;
-	  int bit_quality[3];
-	  float delta = my_atan2f(I,Q);
+	  float I, Q;
+	  convolve_iq (D->u.psk.I_raw, D->u.psk.Q_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps, &I, &Q);
 
-	  if (D->modem_type == MODEM_QPSK) {
-	    if (D->u.psk.v26_alt == V26_B) {
-	      gray = phase_shift_to_symbol (delta + (float)(M_PI/2), 2, bit_quality);	// MFJ compatible
+	  delay_detect (chan, subchan, I, Q, D);
+	}
+
+} /* end process_one_sample */
+
+
+__attribute__((hot))
+void demod_psk_process_sample (int chan, int subchan, int sam, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+	if (D->pre_fft != NULL || D->lp_fft[0] != NULL) {
+	  D->fft_stale = 1;
+	}
+
+	process_one_sample (chan, subchan, sam, D);
+
+} /* end demod_psk_process_sample */
+
+
+static void process_block_fft (int chan, int subchan, const int16_t *samples, int n, struct demodulator_state_s *D);
+
+__attribute__((hot))
+void demod_psk_process_block (int chan, int subchan, const int16_t *samples, int n, struct demodulator_state_s *D)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+	if (D->pre_fft != NULL || D->lp_fft[0] != NULL) {
+	  process_block_fft (chan, subchan, samples, n, D);
+	  return;
+	}
+
+	for (int k = 0; k < n; k++) {
+	  D->block_pos = k;
+	  alevel_rec_sample (D, samples[k] / 16384.0f);
+	  process_one_sample (chan, subchan, samples[k], D);
+	}
+
+} /* end demod_psk_process_block */
+
+
+/*
+ * Block version when a filter uses FFT.
+ * Each step is done for a chunk of samples.  See demod_afsk.c.
+ * The history buffers are kept up to date in case we
+ * switch back to a sample at a time.
+ */
+
+#define FFT_CHUNK 256
+
+__attribute__((hot))
+static void process_block_fft (int chan, int subchan, const int16_t *samples, int n, struct demodulator_state_s *D)
+{
+	float x[FFT_CHUNK];
+	float I[FFT_CHUNK], Q[FFT_CHUNK];
+	int off, len, k;
+
+	if (D->fft_stale) {
+	  if (D->pre_fft != NULL) {
+	    fft_filter_set_history (D->pre_fft, D->u.psk.audio_in, NULL);
+	  }
+	  if (D->lp_fft[0] != NULL) {
+	    fft_filter_set_history (D->lp_fft[0], D->u.psk.I_raw, D->u.psk.Q_raw);
+	  }
+	  D->fft_stale = 0;
+	}
+
+	for (off = 0; off < n; off += len) {
+	  len = n - off < FFT_CHUNK ? n - off : FFT_CHUNK;
+
+	  for (k = 0; k < len; k++) {
+	    x[k] = samples[off + k] / 16384.0f;
+	  }
+
+	  if (D->u.psk.use_prefilter) {
+	    if (D->pre_fft != NULL) {
+	      push_block (x, len, D->u.psk.audio_in, D->u.psk.pre_filter_taps);
+	      fft_filter_real (D->pre_fft, x, len, x);
 	    }
 	    else {
-	      gray = phase_shift_to_symbol (delta + (float)(3*M_PI/4), 2, bit_quality);	// Classic
+	      for (k = 0; k < len; k++) {
+	        push_sample (x[k], D->u.psk.audio_in, D->u.psk.pre_filter_taps);
+	        x[k] = convolve (D->u.psk.audio_in, D->u.psk.pre_filter, D->u.psk.pre_filter_taps);
+	      }
+	    }
+	  }
+
+	  // Mixer.
+
+	  if (D->u.psk.psk_use_lo) {
+	    for (k = 0; k < len; k++) {
+	      I[k] = x[k] * D->u.psk.sin_table256[((D->u.psk.lo_phase >> 24) + 64) & 0xff];
+	      Q[k] = x[k] * D->u.psk.sin_table256[(D->u.psk.lo_phase >> 24) & 0xff];
+	      D->u.psk.lo_phase += D->u.psk.lo_step;
 	    }
 	  }
 	  else {
-	    gray = phase_shift_to_symbol (delta + (float)(3*M_PI/2), 3, bit_quality);
+	    for (k = 0; k < len; k++) {
+	      push_sample (x[k], D->u.psk.delay_line, D->u.psk.delay_line_taps);
+	      I[k] = x[k] * D->u.psk.delay_line[D->u.psk.coffs];
+	      Q[k] = x[k] * D->u.psk.delay_line[D->u.psk.soffs];
+	    }
+	  }
+
+	  // Low pass filter.
+
+	  if (D->lp_fft[0] != NULL) {
+	    push_block (I, len, D->u.psk.I_raw, D->u.psk.lp_filter_taps);
+	    push_block (Q, len, D->u.psk.Q_raw, D->u.psk.lp_filter_taps);
+	    fft_filter_iq (D->lp_fft[0], I, Q, len, I, Q);
+	  }
+	  else {
+	    for (k = 0; k < len; k++) {
+	      push_sample (I[k], D->u.psk.I_raw, D->u.psk.lp_filter_taps);
+	      push_sample (Q[k], D->u.psk.Q_raw, D->u.psk.lp_filter_taps);
+	      convolve_iq (D->u.psk.I_raw, D->u.psk.Q_raw, D->u.psk.lp_filter, D->u.psk.lp_filter_taps, &I[k], &Q[k]);
+	    }
+	  }
+
+	  for (k = 0; k < len; k++) {
+	    D->block_pos = off + k;
+	    alevel_rec_sample (D, samples[off + k] / 16384.0f);
+	    if (D->u.psk.psk_use_lo) {
+	      lo_detect (chan, subchan, I[k], Q[k], D);
+	    }
+	    else {
+	      delay_detect (chan, subchan, I[k], Q[k], D);
+	    }
 	  }
-	  nudge_pll (chan, subchan, slice, gray, D, bit_quality);
 	}
 
-} /* end demod_psk_process_sample */
+} /* end process_block_fft */
 
 
 
@@ -0,0 +1,645 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        demodbench.c
+ *
+ * Purpose:     Measure the speed of the demodulators and HDLC decoder.
+ *
+ * Description:	atest tells us how long it takes to decode a whole
+ *		recording but mixes everything together.  Here we time
+ *		the individual pieces, each on its own, so the effect
+ *		of a change can be seen clearly.
+ *
+ *		Test signals are made in memory with the same transmit
+ *		code used by gen_packets.  Each demodulator is then run
+ *		over the signal for every profile and number of slicers.
+ *		The sample at a time and block interfaces are timed separately.
+ *
+ *		hdlc_rec_bit and fx25_rec_bit are timed with a stream of bits
+ *		containing AX.25 frames and then FX.25 frames.  The bits
+ *		also come from gen_tone, using baseband at two samples per bit.
+ *		Note that hdlc_rec_bit also calls fx25_rec_bit and
+ *		il2p_rec_bit so its time includes those.
+ *
+ *		Everything below the demodulators is real but the
+ *		decoded frames go no further than being counted here.
+ *		The frame count is reported as a sanity check.  There is
+ *		nothing to pick the best of the slicers so each slicer
+ *		adds its own copies to the count.
+ *
+ *		Results are written as JSON so they can be compared
+ *		by a script.  Each one has the time per audio sample
+ *		(or per bit) and how many times faster than real time.
+ *
+ * Usage:	demodbench [ -n packets ] [ -r repeat ] [ -o file.json ]
+ *
+ *		-n	Number of packets in each test signal.  Default 10.
+ *		-r	Run each test this many times and keep the fastest.  Default 3.
+ *		-o	Write the results here rather than stdout.
+ *
+ *--------------------------------------------------------------------*/
+
+
+#include "direwolf.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "audio.h"
+#include "ax25_pad.h"
+#include "textcolor.h"
+#include "gen_tone.h"
+#include "hdlc_send.h"
+#include "hdlc_rec.h"
+#include "fsk_demod_state.h"
+#include "demod_afsk.h"
+#include "demod_psk.h"
+#include "demod_9600.h"
+#include "multi_modem.h"
+#include "convolve.h"
+#include "fft_filter.h"
+#include "dtime_now.h"
+#include "fx25.h"
+#include "il2p.h"
+#include "ptt.h"
+
+
+#define BENCH_BLOCK_SIZE 256		/* Same as atest. */
+
+#define BIT_RATE 9600			/* For real time factor of the bit level tests. */
+
+
+/*
+ * The different demodulators to try.
+ */
+
+struct bench_s {
+	enum modem_t modem_type;
+	int baud;
+	int mark_freq;
+	int space_freq;
+	int samples_per_sec;
+	char *profiles;			/* One test for each letter. */
+	int multi_slicer;		/* Try each number of slicers. */
+};
+
+static const struct bench_s bench[] = {
+	{ MODEM_AFSK,     1200, 1200, 2200, 44100, "AB",   1 },
+	{ MODEM_AFSK,      300, 1600, 1800, 44100, "AB",   1 },
+	{ MODEM_QPSK,     2400,    0,    0, 44100, "PQRS", 0 },
+	{ MODEM_8PSK,     4800,    0,    0, 44100, "TUVW", 0 },
+	{ MODEM_SCRAMBLE, 9600,    0,    0, 48000, " ",    1 },
+};
+
+#define NUM_BENCH ((int)(sizeof(bench) / sizeof(bench[0])))
+
+
+static struct audio_s gen_config;	/* For generating signals. */
+static struct audio_s rec_config;	/* For the receive side. */
+
+static struct demodulator_state_s demod_state;
+
+static int num_frames;			/* Frames decoded by the current test. */
+
+static FILE *json_fp;
+static int json_count = 0;
+
+
+/*
+ * Generated audio, collected by audio_put.
+ */
+
+static int16_t *sig = NULL;
+static int sig_len = 0;
+static int sig_alloc = 0;
+
+static int add_noise = 0;
+static int byte_count = 0;
+static int16_t sample16;
+
+
+/* Own copy of random number generator so we get the same */
+/* signal every time, on every operating system. */
+
+#define MY_RAND_MAX 0x7fffffff
+static int seed = 1;
+
+static int my_rand (void) {
+	// Perform the calculation as unsigned to avoid signed overflow error.
+	seed = (int)(((unsigned)seed * 1103515245) + 12345) & MY_RAND_MAX;
+	return (seed);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        audio_put
+ *
+ * Purpose:     Called by gen_tone to send one byte of audio.
+ *
+ * Description:	Our config is 16 bit mono, little endian.
+ *		Put the bytes back together and keep in memory.
+ *
+ *--------------------------------------------------------------------*/
+
+int audio_put (int a, int c)
+{
+	int s;
+
+	if ((byte_count++ & 1) == 0) {
+	  sample16 = c & 0xff;			/* save lower byte. */
+	  return (c);
+	}
+
+	sample16 |= (c << 8) & 0xff00;		/* insert upper byte. */
+	s = sample16;				/* sign extend. */
+
+	if (add_noise) {
+	  float r = (my_rand() - MY_RAND_MAX/2.0) / (MY_RAND_MAX/2.0);
+	  s += r * 1000;
+	  if (s > 32767) s = 32767;
+	  if (s < -32767) s = -32767;
+	}
+
+	if (sig_len >= sig_alloc) {
+	  sig_alloc = sig_alloc ? sig_alloc * 2 : 1000000;
+	  sig = realloc (sig, sig_alloc * sizeof(int16_t));
+	  assert (sig != NULL);
+	}
+	sig[sig_len++] = s;
+	return (c);
+}
+
+int audio_write (int a, const unsigned char *buf, int len)
+{
+	for (int n = 0; n < len; n++) {
+	  audio_put (a, buf[n]);
+	}
+	return (0);
+}
+
+int audio_flush (int a)
+{
+	return (0);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        gen_signal
+ *
+ * Purpose:     Generate test packets, the same way as gen_packets.
+ *
+ * Inputs:	modem_type, baud, ...	- As in the config file.
+ *
+ *		layer2_xmit	- AX.25 or FX.25.
+ *
+ *		npackets	- How many.
+ *
+ * Outputs:	sig, sig_len	- Audio samples.
+ *
+ *--------------------------------------------------------------------*/
+
+static void gen_signal (enum modem_t modem_type, int baud, int mark_freq, int space_freq, int samples_per_sec,
+			enum layer2_t layer2_xmit, int npackets)
+{
+	int n;
+
+	memset (&gen_config, 0, sizeof(gen_config));
+	gen_config.adev[0].defined = 1;
+	gen_config.adev[0].num_channels = 1;
+	gen_config.adev[0].samples_per_sec = samples_per_sec;
+	gen_config.adev[0].bits_per_sample = 16;
+	gen_config.chan_medium[0] = MEDIUM_RADIO;
+	gen_config.achan[0].modem_type = modem_type;
+	gen_config.achan[0].baud = baud;
+	gen_config.achan[0].mark_freq = mark_freq;
+	gen_config.achan[0].space_freq = space_freq;
+	gen_config.achan[0].v26_alternative = V26_B;
+	gen_config.achan[0].layer2_xmit = layer2_xmit;
+	gen_config.achan[0].fx25_strength = 16;
+
+	gen_tone_init (&gen_config, 25, 1);
+
+	sig_len = 0;
+	byte_count = 0;
+	seed = 1;
+
+	for (n = 1; n <= npackets; n++) {
+	  char text[200];
+	  packet_t pp;
+
+	  snprintf (text, sizeof(text), "WB2OSZ-15>TEST:,The quick brown fox jumps over the lazy dog!  %04d of %04d", n, npackets);
+	  pp = ax25_from_text (text, 1);
+	  assert (pp != NULL);
+
+	  // Enough quiet for the DCD to drop.
+
+	  gen_tone_put_quiet_ms (0, 100);
+
+	  layer2_preamble_postamble (0, 32, 0, &gen_config);
+	  layer2_send_frame (0, pp, 0, &gen_config);
+	  layer2_preamble_postamble (0, 2, 1, &gen_config);
+	  ax25_delete (pp);
+	}
+	gen_tone_put_quiet_ms (0, 100);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rec_init
+ *
+ * Purpose:     Set up the HDLC decoder, and the demodulator, for one test.
+ *
+ * Inputs:	b		- Demodulator type.
+ *		profile		- Letter for demodulator variation.
+ *		slicers		- Number of slicers.
+ *
+ * Returns:	upsample factor for 9600.
+ *
+ *--------------------------------------------------------------------*/
+
+static int rec_init (const struct bench_s *b, char profile, int slicers)
+{
+	struct demodulator_state_s *D = &demod_state;
+	int upsample = 0;
+
+	memset (&rec_config, 0, sizeof(rec_config));
+	rec_config.adev[0].defined = 1;
+	rec_config.adev[0].num_channels = 1;
+	rec_config.adev[0].samples_per_sec = b->samples_per_sec;
+	rec_config.adev[0].bits_per_sample = 16;
+	rec_config.chan_medium[0] = MEDIUM_RADIO;
+	rec_config.achan[0].modem_type = b->modem_type;
+	rec_config.achan[0].baud = b->baud;
+	rec_config.achan[0].mark_freq = b->mark_freq;
+	rec_config.achan[0].space_freq = b->space_freq;
+	rec_config.achan[0].v26_alternative = V26_B;
+	rec_config.achan[0].num_freq = 1;
+	rec_config.achan[0].num_subchan = 1;
+	rec_config.achan[0].num_slicers = slicers;
+	rec_config.achan[0].decimate = 1;
+	rec_config.achan[0].fix_bits = RETRY_NONE;
+	rec_config.achan[0].sanity_test = SANITY_APRS;
+
+// Only once.  Otherwise it would allocate new rrbb for every test.
+// It keeps a pointer to rec_config so later changes are seen.
+
+	static int hdlc_rec_was_init = 0;
+	if ( ! hdlc_rec_was_init) {
+	  hdlc_rec_init (&rec_config);
+	  hdlc_rec_was_init = 1;
+	}
+
+// Start from scratch each time.  The FFT filters are the only thing allocated.
+
+	fft_filter_delete (D->pre_fft);
+	fft_filter_delete (D->lp_fft[0]);
+	fft_filter_delete (D->lp_fft[1]);
+	memset (D, 0, sizeof(struct demodulator_state_s));
+
+	switch (b->modem_type) {
+
+	  case MODEM_AFSK:
+	    demod_afsk_init (b->samples_per_sec, b->baud, b->mark_freq, b->space_freq, profile, D);
+	    D->num_slicers = slicers;
+	    D->quick_attack = D->agc_fast_attack * 0.2f;
+	    D->sluggish_decay = D->agc_slow_decay * 0.2f;
+	    break;
+
+	  case MODEM_QPSK:
+	  case MODEM_8PSK:
+	    demod_psk_init (b->modem_type, V26_B, b->samples_per_sec, b->baud, profile, D);
+	    D->quick_attack = 0.080 * 0.2;
+	    D->sluggish_decay = 0.00012 * 0.2;
+	    break;
+
+	  case MODEM_SCRAMBLE:
+	  default:
+	    upsample = 3;		// Same as demod.c would pick for 48000 / 9600.
+	    demod_9600_init (b->modem_type, b->samples_per_sec, upsample, b->baud, D);
+	    D->num_slicers = slicers;
+	    D->quick_attack = D->agc_fast_attack * 0.2f;
+	    D->sluggish_decay = D->agc_slow_decay * 0.2f;
+	    break;
+	}
+
+	num_frames = 0;
+	return (upsample);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        report
+ *
+ * Purpose:     Write one result as JSON.
+ *
+ *--------------------------------------------------------------------*/
+
+static void report (const char *function, const struct bench_s *b, char profile, int slicers,
+			const char *unit, int count, double rate, double seconds)
+{
+	char modem[16];
+
+	switch (b->modem_type) {
+	  case MODEM_AFSK:	strlcpy (modem, "AFSK", sizeof(modem));		break;
+	  case MODEM_QPSK:	strlcpy (modem, "QPSK", sizeof(modem));		break;
+	  case MODEM_8PSK:	strlcpy (modem, "8PSK", sizeof(modem));		break;
+	  case MODEM_SCRAMBLE:	strlcpy (modem, "G3RUH", sizeof(modem));	break;
+	  default:		strlcpy (modem, "baseband", sizeof(modem));	break;
+	}
+
+	fprintf (json_fp, "%s\n    { \"function\": \"%s\", \"modem\": \"%s\", \"baud\": %d, \"profile\": \"%c\", \"slicers\": %d,"
+			" \"%ss\": %d, \"seconds\": %.6f, \"ns_per_%s\": %.2f, \"realtime\": %.1f, \"frames\": %d }",
+			json_count ? "," : "",
+			function, modem, b->baud, profile, slicers,
+			unit, count, seconds, unit, seconds * 1e9 / count, (count / rate) / seconds, num_frames);
+	json_count++;
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        time_demod
+ *
+ * Purpose:     Time one demodulator over the whole test signal.
+ *
+ * Inputs:	b, profile, slicers	- Which one.
+ *		block		- 0 for sample at a time, 1 for blocks.
+ *		repeat		- Keep the fastest of this many tries.
+ *
+ *--------------------------------------------------------------------*/
+
+static void time_demod (const struct bench_s *b, char profile, int slicers, int block, int repeat)
+{
+	struct demodulator_state_s *D = &demod_state;
+	double best = 0;
+	char *function = "";
+	int r, k;
+
+	for (r = 0; r < repeat; r++) {
+
+	  int upsample = rec_init (b, profile, slicers);
+	  double start = dtime_monotonic ();
+
+	  switch (b->modem_type) {
+
+	    case MODEM_AFSK:
+	      if (block) {
+	        function = "demod_afsk_process_block";
+	        for (k = 0; k < sig_len; k += BENCH_BLOCK_SIZE) {
+	          demod_afsk_process_block (0, 0, sig + k, sig_len - k < BENCH_BLOCK_SIZE ? sig_len - k : BENCH_BLOCK_SIZE, D);
+	        }
+	      }
+	      else {
+	        function = "demod_afsk_process_sample";
+	        for (k = 0; k < sig_len; k++) {
+	          demod_afsk_process_sample (0, 0, sig[k], D);
+	        }
+	      }
+	      break;
+
+	    case MODEM_QPSK:
+	    case MODEM_8PSK:
+	      if (block) {
+	        function = "demod_psk_process_block";
+	        for (k = 0; k < sig_len; k += BENCH_BLOCK_SIZE) {
+	          demod_psk_process_block (0, 0, sig + k, sig_len - k < BENCH_BLOCK_SIZE ? sig_len - k : BENCH_BLOCK_SIZE, D);
+	        }
+	      }
+	      else {
+	        function = "demod_psk_process_sample";
+	        for (k = 0; k < sig_len; k++) {
+	          demod_psk_process_sample (0, 0, sig[k], D);
+	        }
+	      }
+	      break;
+
+	    case MODEM_SCRAMBLE:
+	    default:
+	      if (block) {
+	        function = "demod_9600_process_block";
+	        for (k = 0; k < sig_len; k += BENCH_BLOCK_SIZE) {
+	          demod_9600_process_block (0, sig + k, sig_len - k < BENCH_BLOCK_SIZE ? sig_len - k : BENCH_BLOCK_SIZE, upsample, D);
+	        }
+	      }
+	      else {
+	        function = "demod_9600_process_sample";
+	        for (k = 0; k < sig_len; k++) {
+	          demod_9600_process_sample (0, sig[k], upsample, D);
+	        }
+	      }
+	      break;
+	  }
+
+	  double t = dtime_monotonic () - start;
+	  if (r == 0 || t < best) best = t;
+	}
+
+	report (function, b, profile, slicers, "sample", sig_len, b->samples_per_sec, best);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        time_bits
+ *
+ * Purpose:     Time the HDLC and FX.25 decoders with the bits
+ *		that a demodulator would deliver.
+ *
+ * Inputs:	layer2_xmit	- Generate AX.25 or FX.25 frames.
+ *		npackets, repeat - As above.
+ *
+ *--------------------------------------------------------------------*/
+
+static void time_bits (enum layer2_t layer2_xmit, int npackets, int repeat)
+{
+	static const struct bench_s bits_bench = { MODEM_BASEBAND, BIT_RATE, 0, 0, BIT_RATE * 2, " ", 0 };
+	unsigned char *raw;
+	unsigned char *dbit;
+	int nbits;
+	double best;
+	int r, k;
+
+// Baseband at two samples per bit.  The second one is at the full level.
+
+	add_noise = 0;
+	gen_signal (MODEM_BASEBAND, BIT_RATE, 0, 0, BIT_RATE * 2, layer2_xmit, npackets);
+
+	nbits = sig_len / 2;
+	raw = malloc (nbits);
+	dbit = malloc (nbits);
+	assert (raw != NULL && dbit != NULL);
+	for (k = 0; k < nbits; k++) {
+	  raw[k] = sig[2 * k + 1] > 0;
+	  dbit[k] = (k > 0 && raw[k] == raw[k-1]);	// NRZI decoded, as hdlc_rec does.
+	}
+
+	best = 0;
+	for (r = 0; r < repeat; r++) {
+	  rec_init (&bits_bench, ' ', 1);
+	  double start = dtime_monotonic ();
+	  for (k = 0; k < nbits; k++) {
+	    hdlc_rec_bit (0, 0, 0, raw[k], 0, 100);
+	  }
+	  double t = dtime_monotonic () - start;
+	  if (r == 0 || t < best) best = t;
+	}
+	report (layer2_xmit == LAYER2_FX25 ? "hdlc_rec_bit (FX.25 frames)" : "hdlc_rec_bit (AX.25 frames)",
+			&bits_bench, ' ', 1, "bit", nbits, BIT_RATE, best);
+
+	best = 0;
+	for (r = 0; r < repeat; r++) {
+	  rec_init (&bits_bench, ' ', 1);
+	  double start = dtime_monotonic ();
+	  for (k = 0; k < nbits; k++) {
+	    fx25_rec_bit (0, 0, 0, dbit[k], 100);
+	  }
+	  double t = dtime_monotonic () - start;
+	  if (r == 0 || t < best) best = t;
+	}
+	report (layer2_xmit == LAYER2_FX25 ? "fx25_rec_bit (FX.25 frames)" : "fx25_rec_bit (AX.25 frames)",
+			&bits_bench, ' ', 1, "bit", nbits, BIT_RATE, best);
+
+	free (raw);
+	free (dbit);
+}
+
+
+int main (int argc, char *argv[])
+{
+	int npackets = 10;
+	int repeat = 3;
+	char *json_file = NULL;
+	int c, j, slicers;
+	const char *p;
+
+	while ((c = getopt (argc, argv, "n:r:o:")) != -1) {
+	  switch (c) {
+	    case 'n':
+	      npackets = atoi(optarg);
+	      break;
+	    case 'r':
+	      repeat = atoi(optarg);
+	      break;
+	    case 'o':
+	      json_file = optarg;
+	      break;
+	    default:
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Usage: demodbench [ -n packets ] [ -r repeat ] [ -o file.json ]\n");
+	      exit (EXIT_FAILURE);
+	  }
+	}
+	if (npackets < 1) npackets = 1;
+	if (repeat < 1) repeat = 1;
+
+	json_fp = stdout;
+	if (json_file != NULL) {
+	  json_fp = fopen (json_file, "w");
+	  if (json_fp == NULL) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Can't open %s for write.\n", json_file);
+	    exit (EXIT_FAILURE);
+	  }
+	}
+
+	convolve_init ();
+	fft_filter_init ();
+	fx25_init (0);
+	il2p_init (0);
+
+	fprintf (json_fp, "{\n  \"convolve\": \"%s\",\n  \"fft_filter_min_taps\": %d,\n  \"block_size\": %d,\n  \"packets\": %d,\n  \"results\": [",
+			convolve_impl_name(), fft_filter_min_taps, BENCH_BLOCK_SIZE, npackets);
+
+	for (j = 0; j < NUM_BENCH; j++) {
+	  const struct bench_s *b = &bench[j];
+
+	  add_noise = 1;
+	  gen_signal (b->modem_type, b->baud, b->mark_freq, b->space_freq, b->samples_per_sec, LAYER2_AX25, npackets);
+
+	  for (p = b->profiles; *p != '\0'; p++) {
+	    for (slicers = 1; slicers <= (b->multi_slicer ? MAX_SLICERS : 1); slicers++) {
+	      time_demod (b, *p, slicers, 0, repeat);
+	      time_demod (b, *p, slicers, 1, repeat);
+	    }
+	  }
+	}
+
+	time_bits (LAYER2_AX25, npackets, repeat);
+	time_bits (LAYER2_FX25, npackets, repeat);
+
+	fprintf (json_fp, "\n  ]\n}\n");
+
+	if (json_fp != stdout) {
+	  fclose (json_fp);
+	}
+	free (sig);
+	exit (EXIT_SUCCESS);
+}
+
+
+/*
+ * Everything above the demodulators and HDLC decoder is replaced
+ * by these.  Decoded frames are only counted.
+ */
+
+void multi_modem_process_rec_frame (int chan, int subchan, int slice, unsigned char *fbuf, int flen, alevel_t alevel, retry_t retries, fec_type_t fec_type)
+{
+	num_frames++;
+}
+
+void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t pp, alevel_t alevel, retry_t retries, fec_type_t fec_type)
+{
+	num_frames++;
+	ax25_delete (pp);
+}
+
+int64_t multi_modem_clock (int chan, int subchan)
+{
+	return (0);
+}
+
+alevel_t demod_get_audio_level (int chan, int subchan)
+{
+	alevel_t alevel;
+	memset (&alevel, 0, sizeof(alevel));
+	return (alevel);
+}
+
+void ptt_set (int ot, int chan, int ptt_signal)
+{
+	return;
+}
+
+int get_input (int it, int chan)
+{
+	return -1;
+}
+
+/* end demodbench.c */
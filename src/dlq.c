@@ -35,6 +35,15 @@
  *		In version 1.4, other types of events also go into this
  *		queue and we use it to drive the data link state machine.
  *
+ *		Many threads add to the queue: receive threads, KISS and
+ *		AGW clients, the transmit threads for channel busy, etc.
+ *		Only recv_process takes things out.  Adding used to take
+ *		a mutex and walk to the end of the list, so it got slower
+ *		just when the queue was backed up.  Now adding is an atomic
+ *		exchange of the tail pointer with no lock.  The mutex and
+ *		condition variable are only used to wake up the reader
+ *		when it is sleeping.
+ *
  *---------------------------------------------------------------*/
 
 #include "direwolf.h"
@@ -57,27 +66,48 @@
 #include "dtime_now.h"
 
 
-/* The queue is a linked list of these. */
+/*
+ * The queue is a linked list of these.
+ *
+ * There is always at least one item in the list, possibly the stub,
+ * so adding never needs to look at the head.  A writer swaps its item
+ * into queue_tail then links the previous tail to it.  Between those
+ * two steps the reader can't see the new item yet and acts as if the
+ * queue were empty.  queue_length is already counting it, so the
+ * reader won't go to sleep, it just looks again.
+ */
 
-static struct dlq_item_s *queue_head = NULL;	/* Head of linked list for queue. */
+static struct dlq_item_s stub;			/* Placeholder so list is never empty. */
 
-#if __WIN32__
+static struct dlq_item_s *queue_head = &stub;	/* Only used by the reader. */
 
-// TODO1.2: use dw_mutex_t
+static struct dlq_item_s *queue_tail = &stub;	/* Writers atomically exchange this. */
 
-static CRITICAL_SECTION dlq_cs;			/* Critical section for updating queues. */
+static int queue_length = 0;			/* Items added but not removed yet. */
+
+
+/* For dlq_get_stats. */
+/* s_max_length is atomic because writers update it.  The rest are */
+/* written by recv_process and read or reset by other threads, */
+/* so they are kept under s_stats_mutex. */
+
+static int s_max_length = 0;
+static dw_mutex_t s_stats_mutex;
+static int s_num_removed = 0;
+static double s_total_wait = 0;			/* Seconds waiting in queue. */
+static double s_max_wait = 0;
+
+#if __WIN32__
 
 static HANDLE wake_up_event;			/* Notify received packet processing thread when queue not empty. */
 
 #else
 
-static pthread_mutex_t dlq_mutex;		/* Critical section for updating queues. */
-
 static pthread_cond_t wake_up_cond;		/* Notify received packet processing thread when queue not empty. */
 
 static pthread_mutex_t wake_up_mutex;		/* Required by cond_wait. */
 
-static volatile int recv_thread_is_waiting = 0;
+static int recv_thread_is_waiting = 0;
 
 #endif
 
@@ -117,8 +147,12 @@ void dlq_init (void)
 	dw_printf ("dlq_init ( )\n");
 #endif
 
-	queue_head = NULL;
+	stub.nextp = NULL;
+	queue_head = &stub;
+	queue_tail = &stub;
+	queue_length = 0;
 
+	dw_mutex_init (&s_stats_mutex);
 
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
@@ -126,7 +160,6 @@ void dlq_init (void)
 #endif
 
 #if __WIN32__
-	InitializeCriticalSection (&dlq_cs);
 #else
 	int err;
 	err = pthread_mutex_init (&wake_up_mutex, NULL);
@@ -136,13 +169,6 @@ void dlq_init (void)
 	  perror ("");
 	  exit (EXIT_FAILURE);
 	}
-	err = pthread_mutex_init (&dlq_mutex, NULL);
-	if (err != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("dlq_init: pthread_mutex_init err=%d", err);
-	  perror ("");
-	  exit (EXIT_FAILURE);
-	}
 #endif
 
 
@@ -307,68 +333,43 @@ void dlq_rec_frame (int chan, int subchan, int slice, packet_t pp, alevel_t alev
  *
  * Outputs:	Information is appended to queue.
  *
- * Description:	Add item to end of linked list.
- *		Signal the receive processing thread if the queue was formerly empty.
+ * Description:	Add item to end of linked list, without locking.
+ *		Signal the receive processing thread if it is waiting.
  *
  *--------------------------------------------------------------------*/
 
-static void append_to_queue (struct dlq_item_s *pnew)
+static void link_to_tail (struct dlq_item_s *pnew)
 {
 	struct dlq_item_s *plast;
-	int queue_length = 0;
+
+	pnew->nextp = NULL;
+	plast = __atomic_exchange_n (&queue_tail, pnew, __ATOMIC_ACQ_REL);
+	__atomic_store_n (&plast->nextp, pnew, __ATOMIC_RELEASE);
+}
+
+static void append_to_queue (struct dlq_item_s *pnew)
+{
+	int new_length;
+	int old_max;
 
 	if ( ! was_init) {
 	  dlq_init ();
 	}
 
-	pnew->nextp = NULL;
-
-#if DEBUG1
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("dlq append_to_queue: enter critical section\n");
-#endif
-#if __WIN32__
-	EnterCriticalSection (&dlq_cs);
-#else
-	int err;
-	err = pthread_mutex_lock (&dlq_mutex);
-	if (err != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("dlq append_to_queue: pthread_mutex_lock err=%d", err);
-	  perror ("");
-	  exit (1);
-	}
-#endif
+	pnew->queued_time = dtime_monotonic ();
 
-	if (queue_head == NULL) {
-	  queue_head = pnew;
-	  queue_length = 1;
-	}
-	else {
-	  queue_length = 2;	/* head + new one */
-	  plast = queue_head;
-	  while (plast->nextp != NULL) {
-	    plast = plast->nextp;
-	    queue_length++;
-	  }
-	  plast->nextp = pnew;
-	}
+	link_to_tail (pnew);
 
+	new_length = __atomic_add_fetch (&queue_length, 1, __ATOMIC_SEQ_CST);
 
-#if __WIN32__ 
-	LeaveCriticalSection (&dlq_cs);
-#else
-	err = pthread_mutex_unlock (&dlq_mutex);
-	if (err != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("dlq append_to_queue: pthread_mutex_unlock err=%d", err);
-	  perror ("");
-	  exit (1);
+	old_max = __atomic_load_n (&s_max_length, __ATOMIC_RELAXED);
+	while (new_length > old_max &&
+		! __atomic_compare_exchange_n (&s_max_length, &old_max, new_length, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	  ;
 	}
-#endif
+
 #if DEBUG1
 	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("dlq append_to_queue: left critical section\n");
 	dw_printf ("dlq append_to_queue (): about to wake up recv processing thread.\n");
 #endif
 
@@ -416,9 +417,9 @@ static void append_to_queue (struct dlq_item_s *pnew)
  * and blocking on a write.
  */
 
-	if (queue_length > 10) {
+	if (new_length > 10) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Received frame queue is out of control. Length=%d.\n", queue_length);
+	  dw_printf ("Received frame queue is out of control. Length=%d.\n", new_length);
 	  dw_printf ("Reader thread is probably frozen.\n");
 	  dw_printf ("This can be caused by using a pseudo terminal (direwolf -p) where another\n");
 	  dw_printf ("application is not reading the frames from the other side.\n");
@@ -429,7 +430,15 @@ static void append_to_queue (struct dlq_item_s *pnew)
 #if __WIN32__
 	SetEvent (wake_up_event);
 #else
-	if (recv_thread_is_waiting) {
+
+/*
+ * The reader sets recv_thread_is_waiting, then checks queue_length, both
+ * while holding wake_up_mutex.  We did it the other way around, so at
+ * least one of us sees what the other did.  If the reader is waiting,
+ * taking the mutex here means it is really in pthread_cond_wait.
+ */
+	if (__atomic_load_n (&recv_thread_is_waiting, __ATOMIC_SEQ_CST)) {
+	  int err;
 
 	  err = pthread_mutex_lock (&wake_up_mutex);
 	  if (err != 0) {
@@ -1012,7 +1021,7 @@ int dlq_wait_while_empty (double timeout)
 	}
 
 
-	if (queue_head == NULL) {
+	if (__atomic_load_n (&queue_length, __ATOMIC_SEQ_CST) == 0) {
 
 #if DEBUG
 	  text_color_set(DW_COLOR_DEBUG);
@@ -1049,8 +1058,12 @@ int dlq_wait_while_empty (double timeout)
 	    exit (1);
 	  }
 
-	  recv_thread_is_waiting = 1;
-	  if (timeout != 0.0) {
+	  __atomic_store_n (&recv_thread_is_waiting, 1, __ATOMIC_SEQ_CST);
+
+	  if (__atomic_load_n (&queue_length, __ATOMIC_SEQ_CST) != 0) {
+	    ;	// Something showed up in the meantime.
+	  }
+	  else if (timeout != 0.0) {
 	    struct timespec abstime;
 
 	    abstime.tv_sec = (time_t)(long)timeout;
@@ -1064,7 +1077,7 @@ int dlq_wait_while_empty (double timeout)
 	  else {
 	    err = pthread_cond_wait (&wake_up_cond, &wake_up_mutex);
 	  }
-	  recv_thread_is_waiting = 0;
+	  __atomic_store_n (&recv_thread_is_waiting, 0, __ATOMIC_SEQ_CST);
 
 	  err = pthread_mutex_unlock (&wake_up_mutex);
 	  if (err != 0) {
@@ -1098,54 +1111,76 @@ int dlq_wait_while_empty (double timeout)
  * Returns:	Pointer to a queue item.  Caller is responsible for deleting it.
  *		NULL if queue is empty.
  *
+ * Description:	Must be called only from the one thread which processes
+ *		the queue, recv_process.
+ *
+ *		Could return NULL while something is in the middle of
+ *		being added.  dlq_wait_while_empty will return right
+ *		away and we try again.
+ *
  *--------------------------------------------------------------------*/
 
 
+static struct dlq_item_s *take_from_head (void)
+{
+	struct dlq_item_s *head = queue_head;
+	struct dlq_item_s *next = __atomic_load_n (&head->nextp, __ATOMIC_ACQUIRE);
+
+	if (head == &stub) {		// Skip over the stub.
+	  if (next == NULL) {
+	    return (NULL);
+	  }
+	  queue_head = next;
+	  head = next;
+	  next = __atomic_load_n (&head->nextp, __ATOMIC_ACQUIRE);
+	}
+
+	if (next != NULL) {
+	  queue_head = next;
+	  return (head);
+	}
+
+	// head is the last item we can see.  Put the stub back after it so
+	// it can be removed, unless something else is being added.
+
+	if (head != __atomic_load_n (&queue_tail, __ATOMIC_ACQUIRE)) {
+	  return (NULL);
+	}
+
+	link_to_tail (&stub);
+
+	next = __atomic_load_n (&head->nextp, __ATOMIC_ACQUIRE);
+	if (next != NULL) {
+	  queue_head = next;
+	  return (head);
+	}
+	return (NULL);
+}
+
+
 struct dlq_item_s *dlq_remove (void)
 {
 
 	struct dlq_item_s *result = NULL;
-	//int err;
-
-#if DEBUG1
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("dlq_remove() enter critical section\n");
-#endif
 
 	if ( ! was_init) {
 	  dlq_init ();
 	}
 
-#if __WIN32__
-	EnterCriticalSection (&dlq_cs);
-#else
-	int err;
+	result = take_from_head ();
 
-	err = pthread_mutex_lock (&dlq_mutex);
-	if (err != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("dlq_remove: pthread_mutex_lock err=%d", err);
-	  perror ("");
-	  exit (1);
-	}
-#endif
+	if (result != NULL) {
+	  double wait = dtime_monotonic() - result->queued_time;
 
-	if (queue_head != NULL) {
-	  result = queue_head;
-	  queue_head = queue_head->nextp;
-	}
-	 
-#if __WIN32__
-	LeaveCriticalSection (&dlq_cs);
-#else
-	err = pthread_mutex_unlock (&dlq_mutex);
-	if (err != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("dlq_remove: pthread_mutex_unlock err=%d", err);
-	  perror ("");
-	  exit (1);
+	  __atomic_sub_fetch (&queue_length, 1, __ATOMIC_SEQ_CST);
+	  result->nextp = NULL;
+
+	  dw_mutex_lock (&s_stats_mutex);
+	  s_num_removed++;
+	  s_total_wait += wait;
+	  if (wait > s_max_wait) s_max_wait = wait;
+	  dw_mutex_unlock (&s_stats_mutex);
 	}
-#endif
 
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
@@ -1170,6 +1205,54 @@ struct dlq_item_s *dlq_remove (void)
 }
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        dlq_get_stats
+ *
+ * Purpose:     Find out how well recv_process is keeping up.
+ *
+ * Outputs:	length		- Number of items in the queue now.
+ *
+ *		max_length	- Largest it has been.
+ *
+ *		removed		- Number of items taken out.
+ *
+ *		avg_wait	- Average time, in seconds, items spent in the queue.
+ *
+ *		max_wait	- Longest time.
+ *
+ * Description:	Could be slightly out of date if called from a different
+ *		thread than recv_process.  Good enough for a status display.
+ *		The count and wait times are read together under a mutex
+ *		so the average is always consistent.
+ *
+ *--------------------------------------------------------------------*/
+
+void dlq_get_stats (int *length, int *max_length, int *removed, double *avg_wait, double *max_wait)
+{
+	*length = __atomic_load_n (&queue_length, __ATOMIC_RELAXED);
+	*max_length = __atomic_load_n (&s_max_length, __ATOMIC_RELAXED);
+
+	dw_mutex_lock (&s_stats_mutex);
+	*removed = s_num_removed;
+	*avg_wait = s_num_removed > 0 ? s_total_wait / s_num_removed : 0;
+	*max_wait = s_max_wait;
+	dw_mutex_unlock (&s_stats_mutex);
+}
+
+
+void dlq_reset_stats (void)
+{
+	__atomic_store_n (&s_max_length, __atomic_load_n (&queue_length, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+
+	dw_mutex_lock (&s_stats_mutex);
+	s_num_removed = 0;
+	s_total_wait = 0;
+	s_max_wait = 0;
+	dw_mutex_unlock (&s_stats_mutex);
+}
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        dlq_delete
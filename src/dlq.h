@@ -50,6 +50,8 @@ typedef struct dlq_item_s {
 
 	struct dlq_item_s *nextp;	/* Next item in queue. */
 
+	double queued_time;		/* dtime_monotonic when added, for dlq_get_stats. */
+
 	dlq_type_t type;		/* Type of item. */
 					/* See enum definition above. */
 
@@ -137,6 +139,10 @@ struct dlq_item_s *dlq_remove (void);
 
 void dlq_delete (struct dlq_item_s *pitem);
 
+void dlq_get_stats (int *length, int *max_length, int *removed, double *avg_wait, double *max_wait);
+
+void dlq_reset_stats (void);
+
 
 
 cdata_t *cdata_new (int pid, char *data, int len);
@@ -0,0 +1,602 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      fft_filter.c
+ *
+ * Purpose:   	FIR filtering with FFT fast convolution.
+ *
+ * Description:	The direct form of an FIR filter takes 'taps' multiplies
+ *		for every sample.  Some of ours are several hundred taps
+ *		long, e.g. the AFSK pre filter for 1200 baud.
+ *
+ *		When we have a block of audio, the filter can be applied
+ *		in the frequency domain instead.  This is the "overlap-save"
+ *		method:
+ *
+ *		  - Take the last taps-1 input samples followed by the
+ *		    new ones, up to N - (taps-1) of them, with zero fill
+ *		    to make N, a power of 2.
+ *		  - FFT.
+ *		  - Multiply by the FFT of the filter, worked out ahead of time.
+ *		  - Inverse FFT.
+ *		  - The first taps-1 results are garbage from the circular
+ *		    wrap around.  The rest are the filter outputs for the
+ *		    new samples.
+ *
+ *		The cost, per sample, grows with log(N) rather than taps.
+ *		There is a fixed overhead though, so it only wins for long
+ *		filters and reasonably large blocks.
+ *
+ *		Nothing is held back so there is no added delay.  The output
+ *		matches the direct form, other than the usual rounding
+ *		differences, no matter how the input is broken up.
+ *
+ *		A real filter applied to a complex signal (I + jQ) is
+ *		the same as applying it to I and Q separately.  The FFT is
+ *		complex anyway so we get the second one for free.
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#include "textcolor.h"
+#include "convolve.h"
+#include "fft_filter.h"
+
+
+/*
+ * Typical size of a block given to the demodulators.
+ * The FFT size is chosen so one of these fits in a single pass
+ * for real input, or two passes for I and Q.
+ */
+
+#define TYPICAL_BLOCK 256
+
+
+struct fft_filter_s {
+
+	int taps;		// Filter length.
+	int hist;		// taps - 1.  Previous input needed for next output.
+	int n;			// FFT size.  Power of 2.
+	int step;		// Most new samples we can handle in one pass:  n - hist.
+				// Twice that for real input.
+
+	float *h_re;		// FFT of filter, scaled by 1/n to undo the
+	float *h_im;		// scaling of the inverse transform.
+
+	float *w_re;		// Twiddle factors.  Stage with butterfly span 'half'
+	float *w_im;		// uses half of them starting at [half-1].
+
+	int *rev;		// Bit reversal permutation.
+
+	float *x_re;		// Work area, n each.
+	float *x_im;
+
+	float *old_re;		// Last 'hist' samples of input, oldest first.
+	float *old_im;
+};
+
+
+int fft_filter_min_taps = 200;
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fft_filter_init
+ *
+ * Purpose:     Decide when the FFT is worth using.
+ *
+ * Description:	The direct form gets much faster with wider vector
+ *		instructions.  Our FFT doesn't benefit nearly as much
+ *		so the break even point moves up.
+ *		These are from measurements with the demodulator
+ *		block size, on a few different machines.
+ *
+ *--------------------------------------------------------------------*/
+
+void fft_filter_init (void)
+{
+	convolve_init ();
+
+	const char *impl = convolve_impl_name ();
+
+	if (strstr(impl, "AVX-512") != NULL) {
+	  fft_filter_min_taps = 320;
+	}
+	else if (strstr(impl, "AVX2") != NULL) {
+	  fft_filter_min_taps = 256;
+	}
+	else {
+	  fft_filter_min_taps = 128;
+	}
+}
+
+
+
+/*
+ * Complex FFT, in place, radix 2.
+ * For the inverse, swap re and im on the way in.  It comes out swapped
+ * back and not scaled.
+ */
+
+__attribute__((hot))
+static void fft (fft_filter_t *F, float *__restrict__ re, float *__restrict__ im)
+{
+	int n = F->n;
+	int i;
+
+	for (i = 0; i < n; i++) {
+	  int j = F->rev[i];
+	  if (j > i) {
+	    float t = re[i]; re[i] = re[j]; re[j] = t;
+	    t = im[i]; im[i] = im[j]; im[j] = t;
+	  }
+	}
+
+	// First two stages have no real multiplies.  Twiddles are 1 and -j.
+	// Do them together because the inner loops would be too short.
+
+	assert (n >= 4);
+
+	for (i = 0; i < n; i += 4) {
+	  float b0r = re[i] + re[i+1],    b0i = im[i] + im[i+1];
+	  float b1r = re[i] - re[i+1],    b1i = im[i] - im[i+1];
+	  float b2r = re[i+2] + re[i+3],  b2i = im[i+2] + im[i+3];
+	  float b3r = re[i+2] - re[i+3],  b3i = im[i+2] - im[i+3];
+
+	  re[i] = b0r + b2r;    im[i] = b0i + b2i;
+	  re[i+2] = b0r - b2r;  im[i+2] = b0i - b2i;
+	  re[i+1] = b1r + b3i;  im[i+1] = b1i - b3r;
+	  re[i+3] = b1r - b3i;  im[i+3] = b1i + b3r;
+	}
+
+	for (int half = 4; half < n; half <<= 1) {
+	  const float *__restrict__ wr = F->w_re + half - 1;
+	  const float *__restrict__ wi = F->w_im + half - 1;
+
+	  for (i = 0; i < n; i += 2 * half) {
+	    float *__restrict__ ar = re + i;
+	    float *__restrict__ ai = im + i;
+	    float *__restrict__ br = re + i + half;
+	    float *__restrict__ bi = im + i + half;
+
+	    for (int k = 0; k < half; k++) {
+	      float tr = br[k] * wr[k] - bi[k] * wi[k];
+	      float ti = br[k] * wi[k] + bi[k] * wr[k];
+	      br[k] = ar[k] - tr;
+	      bi[k] = ai[k] - ti;
+	      ar[k] = ar[k] + tr;
+	      ai[k] = ai[k] + ti;
+	    }
+	  }
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fft_filter_new
+ *
+ * Purpose:     Set up a filter.
+ *
+ * Inputs:	filter	- Coefficients, same as for convolve.
+ *		taps	- Number of them.
+ *
+ * Returns:	Pointer to be used for the other functions.
+ *		Free with fft_filter_delete.
+ *
+ *--------------------------------------------------------------------*/
+
+fft_filter_t *fft_filter_new (const float *filter, int taps)
+{
+	fft_filter_t *F;
+	int n, log2n, i;
+
+	assert (taps >= 1);
+
+	n = 4;
+	log2n = 2;
+	while (n < taps - 1 + TYPICAL_BLOCK / 2) {
+	  n <<= 1;
+	  log2n++;
+	}
+
+	F = calloc (1, sizeof(fft_filter_t));
+	assert (F != NULL);
+
+	F->taps = taps;
+	F->hist = taps - 1;
+	F->n = n;
+	F->step = n - F->hist;
+
+	F->h_re = calloc (n, sizeof(float));
+	F->h_im = calloc (n, sizeof(float));
+	F->w_re = calloc (n, sizeof(float));
+	F->w_im = calloc (n, sizeof(float));
+	F->rev = calloc (n, sizeof(int));
+	F->x_re = calloc (n, sizeof(float));
+	F->x_im = calloc (n, sizeof(float));
+	F->old_re = calloc (taps, sizeof(float));
+	F->old_im = calloc (taps, sizeof(float));
+	assert (F->h_re != NULL && F->h_im != NULL && F->w_re != NULL && F->w_im != NULL && F->rev != NULL);
+	assert (F->x_re != NULL && F->x_im != NULL && F->old_re != NULL && F->old_im != NULL);
+
+	for (i = 0; i < n; i++) {
+	  int r = 0;
+	  for (int b = 0; b < log2n; b++) {
+	    if (i & (1 << b)) r |= 1 << (log2n - 1 - b);
+	  }
+	  F->rev[i] = r;
+	}
+
+	for (int half = 1; half < n; half <<= 1) {
+	  for (int k = 0; k < half; k++) {
+	    double a = - M_PI * k / half;
+	    F->w_re[half - 1 + k] = cos(a);
+	    F->w_im[half - 1 + k] = sin(a);
+	  }
+	}
+
+	// Filter, padded with zeros, to the frequency domain.
+
+	for (i = 0; i < taps; i++) {
+	  F->h_re[i] = filter[i] / n;
+	}
+	fft (F, F->h_re, F->h_im);
+
+	return (F);
+}
+
+
+void fft_filter_delete (fft_filter_t *F)
+{
+	if (F == NULL) return;
+
+	free (F->h_re);
+	free (F->h_im);
+	free (F->w_re);
+	free (F->w_im);
+	free (F->rev);
+	free (F->x_re);
+	free (F->x_im);
+	free (F->old_re);
+	free (F->old_im);
+	free (F);
+}
+
+
+/* Forget previous input, as if it had all been zero. */
+
+void fft_filter_reset (fft_filter_t *F)
+{
+	memset (F->old_re, 0, F->taps * sizeof(float));
+	memset (F->old_im, 0, F->taps * sizeof(float));
+}
+
+
+
+/*
+ * Switching over from the direct form.
+ * Take the previous input from its history buffer.
+ */
+
+void fft_filter_set_history (fft_filter_t *F, const float *recent_re, const float *recent_im)
+{
+	int h = F->hist;
+
+	for (int k = 0; k < h; k++) {
+	  F->old_re[h - 1 - k] = recent_re[k];
+	  F->old_im[h - 1 - k] = recent_im != NULL ? recent_im[k] : 0.0f;
+	}
+}
+
+
+
+/*
+ * One pass of overlap-save.
+ *
+ * For complex input, in_re and in_im are up to 'step' new samples.
+ *
+ * For real input, in_im is NULL.  Since the filter is real, the
+ * real and imaginary parts don't interact.  We can put the next
+ * piece of the same input in the imaginary part and do up to
+ * 2 * step samples for the same cost.
+ */
+
+__attribute__((hot))
+static void one_pass (fft_filter_t *F, const float *in_re, const float *in_im, int len, float *out_re, float *out_im)
+{
+	int n = F->n;
+	int h = F->hist;
+	float *__restrict__ xr = F->x_re;
+	float *__restrict__ xi = F->x_im;
+	int len1, len2, k;
+
+	if (in_im != NULL) {
+	  assert (len >= 1 && len <= F->step);
+
+	  memcpy (xr, F->old_re, h * sizeof(float));
+	  memcpy (xr + h, in_re, len * sizeof(float));
+	  memset (xr + h + len, 0, (n - h - len) * sizeof(float));
+
+	  memcpy (xi, F->old_im, h * sizeof(float));
+	  memcpy (xi + h, in_im, len * sizeof(float));
+	  memset (xi + h + len, 0, (n - h - len) * sizeof(float));
+
+	  // Save history for next time before the input might be overwritten.
+
+	  memcpy (F->old_re, xr + len, h * sizeof(float));
+	  memcpy (F->old_im, xi + len, h * sizeof(float));
+	  len1 = len;
+	  len2 = len;
+	}
+	else {
+	  assert (len >= 1 && len <= 2 * F->step);
+
+	  len1 = len < F->step ? len : F->step;
+	  len2 = len - len1;
+
+	  memcpy (xr, F->old_re, h * sizeof(float));
+	  memcpy (xr + h, in_re, len1 * sizeof(float));
+	  memset (xr + h + len1, 0, (n - h - len1) * sizeof(float));
+
+	  // Second piece follows on from the first.
+
+	  memcpy (xi, xr + len1, h * sizeof(float));
+	  memcpy (xi + h, in_re + len1, len2 * sizeof(float));
+	  memset (xi + h + len2, 0, (n - h - len2) * sizeof(float));
+
+	  memcpy (F->old_re, xi + len2, h * sizeof(float));
+	}
+
+	fft (F, xr, xi);
+
+	for (k = 0; k < n; k++) {
+	  float r = xr[k] * F->h_re[k] - xi[k] * F->h_im[k];
+	  float i = xr[k] * F->h_im[k] + xi[k] * F->h_re[k];
+	  xr[k] = r;
+	  xi[k] = i;
+	}
+
+	fft (F, xi, xr);		// Inverse.  See comment on fft.
+
+	if (in_im != NULL) {
+	  memcpy (out_re, xr + h, len * sizeof(float));
+	  memcpy (out_im, xi + h, len * sizeof(float));
+	}
+	else {
+	  memcpy (out_re, xr + h, len1 * sizeof(float));
+	  memcpy (out_re + len1, xi + h, len2 * sizeof(float));
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fft_filter_real
+ *
+ * Purpose:     Filter a block of real samples.
+ *
+ * Inputs:	F	- From fft_filter_new.
+ *		in	- Input samples, oldest first.
+ *		n	- Number of samples.  Any size.
+ *
+ * Outputs:	out	- Filter output for each input.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((hot))
+void fft_filter_real (fft_filter_t *F, const float *in, int n, float *out)
+{
+	int off, len;
+
+	for (off = 0; off < n; off += len) {
+	  len = n - off < 2 * F->step ? n - off : 2 * F->step;
+	  one_pass (F, in + off, NULL, len, out + off, NULL);
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fft_filter_iq
+ *
+ * Purpose:     Same filter applied to two real inputs.
+ *
+ *--------------------------------------------------------------------*/
+
+__attribute__((hot))
+void fft_filter_iq (fft_filter_t *F, const float *in_i, const float *in_q, int n, float *out_i, float *out_q)
+{
+	int off, len;
+
+	for (off = 0; off < n; off += len) {
+	  len = n - off < F->step ? n - off : F->step;
+	  one_pass (F, in_i + off, in_q + off, len, out_i + off, out_q + off);
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ *	Unit test.  Compare with the direct form for different
+ *	filter lengths and block sizes.  Also report the speed of
+ *	each to help pick fft_filter_min_taps.
+ *
+ *--------------------------------------------------------------------*/
+
+#if FFTFILTERTEST
+
+#include <time.h>
+
+#define TOTAL 20000
+
+static double now_sec (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+
+int main (int argc, char *argv[])
+{
+	static float in_i[TOTAL], in_q[TOTAL];
+	static float ring_i[2*TOTAL], ring_q[2*TOTAL];
+	static float direct_i[TOTAL], direct_q[TOTAL];
+	static float out_i[TOTAL], out_q[TOTAL];
+	static float filter[500];
+	static const int tap_list[] = { 1, 7, 31, 103, 200, 383, 480 };
+	static const int block_list[] = { 1, 37, 256, 1000 };
+	int errors = 0;
+
+	fft_filter_init ();
+	text_color_set (DW_COLOR_INFO);
+	dw_printf ("Direct form uses %s.  FFT for %d taps or more.\n", convolve_impl_name(), fft_filter_min_taps);
+
+	srand (1);
+	for (int k = 0; k < TOTAL; k++) {
+	  in_i[k] = (float)rand() / RAND_MAX - 0.5f;
+	  in_q[k] = (float)rand() / RAND_MAX - 0.5f;
+	}
+
+	for (size_t t = 0; t < sizeof(tap_list) / sizeof(tap_list[0]); t++) {
+	  int taps = tap_list[t];
+
+	  for (int j = 0; j < taps; j++) {
+	    filter[j] = sinf(j * 0.1f) / (1 + j);
+	  }
+
+	  // Direct form, newest first like the demodulators.
+	  // Earlier input is zero like a fresh filter.
+
+	  memset (ring_i, 0, sizeof(ring_i));
+	  memset (ring_q, 0, sizeof(ring_q));
+	  for (int k = 0; k < TOTAL; k++) {
+	    ring_i[TOTAL - 1 - k + taps] = in_i[k];
+	  }
+	  for (int k = 0; k < TOTAL; k++) {
+	    ring_q[TOTAL - 1 - k + taps] = in_q[k];
+	  }
+
+	  double t0 = now_sec ();
+	  for (int k = 0; k < TOTAL; k++) {
+	    convolve_iq (ring_i + TOTAL - 1 - k + taps, ring_q + TOTAL - 1 - k + taps, filter, taps, &direct_i[k], &direct_q[k]);
+	  }
+	  double t_direct = now_sec() - t0;
+
+	  t0 = now_sec ();
+	  volatile float sink = 0;
+	  for (int k = 0; k < TOTAL; k++) {
+	    sink += convolve (ring_i + TOTAL - 1 - k + taps, filter, taps);
+	  }
+	  double t_direct_real = now_sec() - t0;
+
+	  for (size_t b = 0; b < sizeof(block_list) / sizeof(block_list[0]); b++) {
+	    int bsize = block_list[b];
+	    fft_filter_t *F = fft_filter_new (filter, taps);
+
+	    t0 = now_sec ();
+	    for (int off = 0; off < TOTAL; off += bsize) {
+	      int len = TOTAL - off < bsize ? TOTAL - off : bsize;
+	      fft_filter_iq (F, in_i + off, in_q + off, len, out_i + off, out_q + off);
+	    }
+	    double t_fft = now_sec() - t0;
+
+	    float max_err = 0;
+	    for (int k = 0; k < TOTAL; k++) {
+	      float e = fabsf(out_i[k] - direct_i[k]);
+	      if (e > max_err) max_err = e;
+	      e = fabsf(out_q[k] - direct_q[k]);
+	      if (e > max_err) max_err = e;
+	    }
+
+	    // Real version, in place.
+
+	    memcpy (out_q, in_i, sizeof(out_q));
+	    fft_filter_reset (F);
+	    t0 = now_sec ();
+	    for (int off = 0; off < TOTAL; off += bsize) {
+	      int len = TOTAL - off < bsize ? TOTAL - off : bsize;
+	      fft_filter_real (F, out_q + off, len, out_q + off);
+	    }
+	    double t_fft_real = now_sec() - t0;
+	    for (int k = 0; k < TOTAL; k++) {
+	      float e = fabsf(out_q[k] - direct_i[k]);
+	      if (e > max_err) max_err = e;
+	    }
+
+	    // Start with the direct form and switch over part way.
+
+	    int m = TOTAL / 3;
+	    fft_filter_set_history (F, ring_i + TOTAL - m + taps, ring_q + TOTAL - m + taps);
+	    for (int off = m; off < TOTAL; off += bsize) {
+	      int len = TOTAL - off < bsize ? TOTAL - off : bsize;
+	      fft_filter_iq (F, in_i + off, in_q + off, len, out_i + off, out_q + off);
+	    }
+	    for (int k = m; k < TOTAL; k++) {
+	      float e = fabsf(out_i[k] - direct_i[k]);
+	      if (e > max_err) max_err = e;
+	      e = fabsf(out_q[k] - direct_q[k]);
+	      if (e > max_err) max_err = e;
+	    }
+
+	    fft_filter_delete (F);
+
+	    if (bsize == TYPICAL_BLOCK) {
+	      dw_printf ("%4d taps:  real direct %6.1f  fft %6.1f    I/Q direct %6.1f  fft %6.1f    ns/sample\n", taps,
+			t_direct_real * 1e9 / TOTAL, t_fft_real * 1e9 / TOTAL, t_direct * 1e9 / TOTAL, t_fft * 1e9 / TOTAL);
+	    }
+
+	    if (max_err > 1e-4f) {
+	      text_color_set (DW_COLOR_ERROR);
+	      dw_printf ("%d taps, block %d, max error %g\n", taps, bsize, max_err);
+	      text_color_set (DW_COLOR_INFO);
+	      errors++;
+	    }
+	  }
+	}
+
+	if (errors) {
+	  text_color_set (DW_COLOR_ERROR);
+	  dw_printf ("\nFFT filter test FAILED.  %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+	text_color_set (DW_COLOR_REC);
+	dw_printf ("\nFFT filter test - PASSED.\n");
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
+/* end fft_filter.c */
@@ -0,0 +1,55 @@
+/* fft_filter.h */
+
+#ifndef FFT_FILTER_H
+#define FFT_FILTER_H 1
+
+
+/*
+ * Long FIR filters using FFT fast convolution (overlap-save).
+ * See fft_filter.c for details.
+ *
+ * Output is the same as the direct form, using convolve, with
+ * the same filter:  out[k] = sum of filter[j] * in[k-j].
+ * No delay is added so the two can be swapped freely.
+ */
+
+
+/*
+ * Filters with fewer taps are faster done directly.
+ * Depends on the processor.  Set by fft_filter_init.
+ */
+
+extern int fft_filter_min_taps;
+
+void fft_filter_init (void);
+
+
+typedef struct fft_filter_s fft_filter_t;
+
+fft_filter_t *fft_filter_new (const float *filter, int taps);
+
+void fft_filter_delete (fft_filter_t *F);
+
+void fft_filter_reset (fft_filter_t *F);
+
+
+/* Replace previous input with taps-1 values, most recent first, */
+/* like the circular buffers used with convolve.  im can be NULL. */
+
+void fft_filter_set_history (fft_filter_t *F, const float *recent_re, const float *recent_im);
+
+
+/* Real input and output.  in and out may be the same. */
+
+void fft_filter_real (fft_filter_t *F, const float *in, int n, float *out);
+
+
+/* Same real filter applied to two inputs, such as I and Q from a mixer. */
+/* These are treated as one complex signal so it costs no more than one. */
+
+void fft_filter_iq (fft_filter_t *F, const float *in_i, const float *in_q, int n, float *out_i, float *out_q);
+
+
+#endif
+
+/* end fft_filter.h */
@@ -0,0 +1,426 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      fix_pool.c
+ *
+ * Purpose:   	Try to fix frames with a bad CRC in the background.
+ *
+ * Description:	With FIX_BITS, hdlc_rec2_block tries inverting bits to
+ *		get a good CRC.  That was done right away, by the audio
+ *		receive thread, or the demodulator thread pool.  A badly
+ *		damaged frame, with the higher levels, could take long enough
+ *		to hold up demodulation of the following audio and cause
+ *		overruns.
+ *
+ *		Here we have a few worker threads and a small fixed table of
+ *		jobs.  hdlc_rec2_block hands over the raw bits and returns.
+ *		If the table is full, it does the work itself as before.
+ *
+ *		multi_modem waits a few bit times before picking the best of
+ *		the candidates from different demodulators and slicers.
+ *		It now also waits for fix up jobs for the same time period.
+ *		A frame recovered by a worker becomes a candidate with the
+ *		time stamp of when the frame was received, not when the
+ *		work finished, so it lands in the right group.
+ *
+ *		There is a deadline, measured in audio samples after the
+ *		frame was received.  After that, multi_modem cancels the job
+ *		and carries on.  A worker checks for cancellation between
+ *		the different fix up attempts and gives up.
+ *
+ *		atest runs much faster than real time so the deadline
+ *		would come too soon.  It asks to wait for the jobs instead.
+ *
+ *		Not available for Windows yet.  The work is done right
+ *		away, as before.
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#if ! __WIN32__
+#include <pthread.h>
+#endif
+
+#include "textcolor.h"
+#include "ax25_pad.h"
+#include "rrbb.h"
+#include "hdlc_rec2.h"
+#include "fix_pool.h"
+
+
+#define JOB_FREE 0
+#define JOB_QUEUED 1		// Waiting for a worker.
+#define JOB_RUNNING 2
+#define JOB_DONE 3		// Results waiting to be collected.
+#define JOB_COLLECTING 4	// Results being passed along.
+
+
+#if ! __WIN32__
+
+static int num_workers = 0;		// Number of worker threads.  0 if pool not in use.
+
+static int wait_for_jobs = 0;		// Wait rather than cancel.  For atest.
+
+static pthread_t worker_tid[FIX_POOL_MAX_THREADS];
+
+static pthread_mutex_t pool_mutex;	// Protects everything in job table except results.
+static pthread_cond_t work_cond;	// Workers wait here for a new job.
+static pthread_cond_t done_cond;	// Waiting for a job to finish.
+
+static struct fix_job_s job[FIX_POOL_MAX_JOBS];
+
+static unsigned int next_seq = 0;	// Oldest first.
+
+
+static void * worker_thread (void *arg)
+{
+	pthread_mutex_lock (&pool_mutex);
+
+	while (1) {
+	  struct fix_job_s *j = NULL;
+
+	  for (int n = 0; n < FIX_POOL_MAX_JOBS; n++) {
+	    if (job[n].state == JOB_QUEUED && (j == NULL || (int)(job[n].seq - j->seq) < 0)) {
+	      j = &job[n];
+	    }
+	  }
+
+	  if (j == NULL) {
+	    pthread_cond_wait (&work_cond, &pool_mutex);
+	    continue;
+	  }
+
+	  j->state = JOB_RUNNING;
+	  pthread_mutex_unlock (&pool_mutex);
+
+	  hdlc_rec2_fix_job (j);
+	  rrbb_delete (j->block);
+	  j->block = NULL;
+
+	  pthread_mutex_lock (&pool_mutex);
+	  j->state = JOB_DONE;
+	  pthread_cond_broadcast (&done_cond);
+	}
+
+	return (NULL);
+}
+
+#endif	/* ! __WIN32__ */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_init
+ *
+ * Purpose:     Start up the worker threads.
+ *
+ * Inputs:	num_threads	- Number of worker threads.  0 means don't
+ *				  use the pool and fix frames right away.
+ *
+ *		wait		- Wait for jobs to finish instead of
+ *				  cancelling them at the deadline.
+ *
+ * Description:	Can be called more than once, e.g. by atest for each file.
+ *		Threads are started only the first time.
+ *
+ *--------------------------------------------------------------------*/
+
+void fix_pool_init (int num_threads, int wait)
+{
+#if __WIN32__
+
+	if (num_threads > 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Fixing frames in the background is not available for Windows yet.\n");
+	}
+
+#else
+	static int was_init = 0;
+
+	if (was_init) return;
+
+	if (num_threads > FIX_POOL_MAX_THREADS) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Number of bit fixing threads limited to %d.\n", FIX_POOL_MAX_THREADS);
+	  num_threads = FIX_POOL_MAX_THREADS;
+	}
+
+	if (num_threads <= 0) return;
+
+	was_init = 1;
+	wait_for_jobs = wait;
+
+	memset (job, 0, sizeof(job));
+	pthread_mutex_init (&pool_mutex, NULL);
+	pthread_cond_init (&work_cond, NULL);
+	pthread_cond_init (&done_cond, NULL);
+
+	for (int p = 0; p < num_threads; p++) {
+	  int e = pthread_create (&worker_tid[p], NULL, worker_thread, NULL);
+	  if (e != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Could not create bit fixing thread %d.  Continuing with %d.\n", p, num_workers);
+	    break;
+	  }
+	  num_workers++;
+	}
+#endif
+
+} /* end fix_pool_init */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_size
+ *
+ * Purpose:     Find number of worker threads.
+ *
+ * Returns:	0 if the pool is not in use.
+ *
+ *--------------------------------------------------------------------*/
+
+int fix_pool_size (void)
+{
+#if __WIN32__
+	return (0);
+#else
+	return (num_workers);
+#endif
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_submit
+ *
+ * Purpose:     Queue up a frame to be fixed.
+ *
+ * Inputs:	block	- Raw bits from the HDLC decoder.
+ *
+ *		born	- Sample clock for the channel when it was found.
+ *			  See multi_modem_clock.
+ *
+ * Returns:	1 if accepted.  The pool now owns block and will delete it.
+ *		0 if the pool is not in use or full.
+ *
+ *--------------------------------------------------------------------*/
+
+int fix_pool_submit (rrbb_t block, int64_t born)
+{
+#if ! __WIN32__
+
+	if (num_workers == 0) return (0);
+
+	pthread_mutex_lock (&pool_mutex);
+
+	for (int n = 0; n < FIX_POOL_MAX_JOBS; n++) {
+	  if (job[n].state == JOB_FREE) {
+	    job[n].block = block;
+	    job[n].chan = rrbb_get_chan (block);
+	    job[n].born = born;
+	    job[n].cancel = 0;
+	    job[n].found = 0;
+	    job[n].seq = next_seq++;
+	    job[n].state = JOB_QUEUED;
+	    pthread_cond_signal (&work_cond);
+	    pthread_mutex_unlock (&pool_mutex);
+	    return (1);
+	  }
+	}
+
+	pthread_mutex_unlock (&pool_mutex);
+#endif
+	return (0);
+
+} /* end fix_pool_submit */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_busy
+ *
+ * Purpose:     Find whether anything is still being worked on.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		before	- Only those found at or before this sample clock.
+ *
+ * Returns:	1 if results might still show up.
+ *
+ *--------------------------------------------------------------------*/
+
+int fix_pool_busy (int chan, int64_t before)
+{
+	int busy = 0;
+
+#if ! __WIN32__
+
+	if (num_workers == 0) return (0);
+
+	pthread_mutex_lock (&pool_mutex);
+
+	for (int n = 0; n < FIX_POOL_MAX_JOBS; n++) {
+	  if ((job[n].state == JOB_QUEUED || job[n].state == JOB_RUNNING || job[n].state == JOB_DONE) &&
+		job[n].chan == chan && ! job[n].cancel && job[n].born <= before) {
+	    busy = 1;
+	    break;
+	  }
+	}
+
+	pthread_mutex_unlock (&pool_mutex);
+#endif
+	return (busy);
+
+} /* end fix_pool_busy */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_cancel
+ *
+ * Purpose:     Give up on jobs that have taken too long.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		before	- Those found at or before this sample clock.
+ *
+ * Description:	Jobs not started yet are thrown away.  Those in progress
+ *		are marked so the worker will stop and the result, if any,
+ *		is thrown away.
+ *
+ *		If we were asked to wait, we wait for them to finish instead.
+ *
+ *--------------------------------------------------------------------*/
+
+void fix_pool_cancel (int chan, int64_t before)
+{
+#if ! __WIN32__
+
+	if (num_workers == 0) return;
+
+	pthread_mutex_lock (&pool_mutex);
+
+	for (int n = 0; n < FIX_POOL_MAX_JOBS; n++) {
+	  if (job[n].chan != chan || job[n].cancel || job[n].born > before) continue;
+
+	  if (wait_for_jobs) {
+	    while (job[n].state == JOB_QUEUED || job[n].state == JOB_RUNNING) {
+	      pthread_cond_wait (&done_cond, &pool_mutex);
+	    }
+	  }
+	  else if (job[n].state == JOB_QUEUED) {
+	    rrbb_delete (job[n].block);
+	    job[n].block = NULL;
+	    job[n].state = JOB_FREE;
+	  }
+	  else if (job[n].state == JOB_RUNNING) {
+	    __atomic_store_n (&job[n].cancel, 1, __ATOMIC_RELAXED);
+	  }
+	}
+
+	pthread_mutex_unlock (&pool_mutex);
+#endif
+
+} /* end fix_pool_cancel */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_cancelled
+ *
+ * Purpose:     Called by a worker to find out if it should give up.
+ *
+ *--------------------------------------------------------------------*/
+
+int fix_pool_cancelled (struct fix_job_s *j)
+{
+	return (__atomic_load_n (&j->cancel, __ATOMIC_RELAXED));
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        fix_pool_collect
+ *
+ * Purpose:     Pass along results from finished jobs.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		fn	- Called for each job, in order received, where
+ *			  a frame was recovered.
+ *
+ * Description:	Should be called only by the thread which processes
+ *		audio for the channel.  fn can use the other functions here.
+ *
+ *--------------------------------------------------------------------*/
+
+void fix_pool_collect (int chan, fix_pool_result_fn_t fn)
+{
+#if ! __WIN32__
+
+	if (num_workers == 0) return;
+
+	while (1) {
+	  struct fix_job_s *j = NULL;
+
+	  pthread_mutex_lock (&pool_mutex);
+
+	  for (int n = 0; n < FIX_POOL_MAX_JOBS; n++) {
+	    if (job[n].state == JOB_DONE && job[n].chan == chan && (j == NULL || (int)(job[n].seq - j->seq) < 0)) {
+	      j = &job[n];
+	    }
+	  }
+	  if (j != NULL) {
+	    j->state = JOB_COLLECTING;
+	  }
+
+	  pthread_mutex_unlock (&pool_mutex);
+
+	  if (j == NULL) return;
+
+	  if (j->found && ! j->cancel) {
+	    (*fn) (j);
+	  }
+
+	  pthread_mutex_lock (&pool_mutex);
+	  j->state = JOB_FREE;
+	  pthread_mutex_unlock (&pool_mutex);
+	}
+#endif
+
+} /* end fix_pool_collect */
+
+/* end fix_pool.c */
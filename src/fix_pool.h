@@ -0,0 +1,64 @@
+/* fix_pool.h */
+
+#ifndef FIX_POOL_H
+#define FIX_POOL_H 1
+
+
+/*
+ * Worker threads to try fixing frames with a bad CRC
+ * without holding up the audio receive thread.
+ * See fix_pool.c for details.
+ */
+
+#include <stdint.h>
+
+#include "hdlc_rec2.h"		/* for rrbb_t, retry_t, alevel_t */
+
+
+#define FIX_POOL_MAX_THREADS 8
+
+#define FIX_POOL_MAX_JOBS 32	// Waiting or in progress.  When full, the
+				// caller does the work itself as before.
+
+struct fix_job_s {
+
+	int state;			/* Private to fix_pool.c */
+	unsigned int seq;
+
+	rrbb_t block;			/* Raw bits of frame with bad CRC. */
+	int chan;
+	int64_t born;			/* Sample clock, from multi_modem, when frame was found. */
+	int cancel;			/* Set when time runs out.  Worker should give up. */
+
+	/* Filled in by hdlc_rec2_fix_job. */
+
+	int found;
+	int subchan;
+	int slice;
+	unsigned char frame[MAX_FRAME_LEN];
+	int flen;			/* Excluding the FCS. */
+	alevel_t alevel;
+	retry_t retries;
+};
+
+
+typedef void (*fix_pool_result_fn_t) (struct fix_job_s *job);
+
+void fix_pool_init (int num_threads, int wait);
+
+int fix_pool_size (void);
+
+int fix_pool_submit (rrbb_t block, int64_t born);
+
+int fix_pool_busy (int chan, int64_t before);
+
+void fix_pool_cancel (int chan, int64_t before);
+
+int fix_pool_cancelled (struct fix_job_s *job);
+
+void fix_pool_collect (int chan, fix_pool_result_fn_t fn);
+
+
+#endif
+
+/* end fix_pool.h */
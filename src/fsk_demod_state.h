@@ -115,6 +115,9 @@ struct demodulator_state_s
 	float hysteresis;
 	int num_slicers;		/* >1 for multiple slicers. */
 
+	int block_pos;			/* Index of sample being processed within the */
+					/* current block.  For time stamping frames. */
+
 /* 
  * Phase Locked Loop (PLL) inertia.
  * Larger number means less influence by signal transitions.
@@ -147,7 +150,22 @@ struct demodulator_state_s
 
 	float pre_filter[MAX_FILTER_SIZE] __attribute__((aligned(16)));
 
-	float raw_cb[MAX_FILTER_SIZE] __attribute__((aligned(16)));	// audio in,  need better name.
+	float raw_cb[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));	// audio in,  need better name.
+									// Circular history, see raw_cb_ix.
+
+	int raw_cb_ix;			// Position of most recent sample in raw_cb.
+
+/*
+ * FFT versions of the pre and low pass filters, when they are long
+ * enough for it to be faster.  NULL to use the direct form.
+ * Only used when processing blocks of samples.  See fft_filter.c.
+ */
+	struct fft_filter_s *pre_fft;
+	struct fft_filter_s *lp_fft[2];		// Mark and space.  Only [0] for profile B and PSK.
+
+	int fft_stale;			// Samples were processed one at a time, with the
+					// direct form.  Reload FFT filter history from the
+					// circular buffers before the next block.
 
 /*
  * The rest are continuously updated.
@@ -279,18 +297,27 @@ struct demodulator_state_s
 
 	    // Need two mixers for profile "A".
 
-	    float m_I_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
-	    float m_Q_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    // Mixer outputs are kept in circular buffers
+	    // rather than shifting everything down for each new sample.
+	    // Each is twice the filter size and every sample is stored twice,
+	    // at index i and i + lp_filter_taps, so the most recent
+	    // lp_filter_taps samples are always contiguous starting at raw_ix.
+	    // All of them are the same length so they can share one index.
+
+	    int raw_ix;				// Position of most recent sample in *_raw.
+
+	    float m_I_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    float m_Q_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
 
-	    float s_I_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
-	    float s_Q_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    float s_I_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    float s_Q_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
 
 	    // Only need one mixer for profile "B".  Reuse the same storage?
 
 //#define c_I_raw m_I_raw
 //#define c_Q_raw m_Q_raw
-	    float c_I_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
-	    float c_Q_raw[MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    float c_I_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
+	    float c_Q_raw[2*MAX_FILTER_SIZE] __attribute__((aligned(16)));
 
 	    int use_rrc;		// Use RRC rather than generic low pass.
 
@@ -302,6 +329,25 @@ struct demodulator_state_s
 
 	    float normalize_rpsam;	// Normalize to -1 to +1 for expected tones.
 
+	    // Multiple slicers.
+	    // The DPLL for each slicer is kept here as a struct of arrays,
+	    // one lane per slicer, so they can all be advanced together
+	    // for each audio sample.  Lanes beyond num_slicers are ignored.
+	    // The rest of D->slicer[] is only needed at a symbol boundary.
+
+#define SLICER_LANES 16			// MAX_SLICERS rounded up to a whole number of vectors.
+
+	    int ms_num_slicers;		// num_slicers when ms_gain and ms_offset were set.
+
+	    float ms_gain[SLICER_LANES] __attribute__((aligned(16)));		// Space gain for profile "A".
+	    float ms_offset[SLICER_LANES] __attribute__((aligned(16)));	// Threshold offset for profile "B".
+
+	    int32_t ms_pll[SLICER_LANES] __attribute__((aligned(16)));		// data_clock_pll for each slicer.
+	    int32_t ms_prev_data[SLICER_LANES] __attribute__((aligned(16)));	// prev_demod_data.
+	    int32_t ms_locked[SLICER_LANES] __attribute__((aligned(16)));	// Copy of data_detect.
+	    int32_t ms_good[SLICER_LANES] __attribute__((aligned(16)));	// good_flag and bad_flag, moved
+	    int32_t ms_bad[SLICER_LANES] __attribute__((aligned(16)));		// to D->slicer[] for each symbol.
+
 	  } afsk;
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -554,5 +600,35 @@ inline static void pll_dcd_each_symbol2 (struct demodulator_state_s *D, int chan
 }
 
 
+
+/*
+ * Version 1.2: Try new approach to capturing the amplitude.
+ * This is same as the later AGC without the normalization step.
+ * We want decay to be substantially slower to get a longer
+ * range idea of the received audio.
+ *
+ * Called for every input sample, before decimation, from
+ * demod_process_sample or the block version of each demodulator.
+ */
+
+__attribute__((always_inline))
+inline static void alevel_rec_sample (struct demodulator_state_s *D, float fsam)
+{
+	if (fsam >= D->alevel_rec_peak) {
+	  D->alevel_rec_peak = fsam * D->quick_attack + D->alevel_rec_peak * (1.0f - D->quick_attack);
+	}
+	else {
+	  D->alevel_rec_peak = fsam * D->sluggish_decay + D->alevel_rec_peak * (1.0f - D->sluggish_decay);
+	}
+
+	if (fsam <= D->alevel_rec_valley) {
+	  D->alevel_rec_valley = fsam * D->quick_attack + D->alevel_rec_valley * (1.0f - D->quick_attack);
+	}
+	else  {
+	  D->alevel_rec_valley = fsam * D->sluggish_decay + D->alevel_rec_valley * (1.0f - D->sluggish_decay);
+	}
+}
+
+
 #define FSK_DEMOD_STATE_H 1
 #endif
@@ -15,6 +15,8 @@ struct rs {
   unsigned char fcr;        /* First consecutive root, index form */
   unsigned char prim;       /* Primitive element, index form */
   unsigned char iprim;      /* prim-th root of 1, index form */
+  unsigned char *syn_mul;   /* Tables for multiplying 16 symbols at a time, */
+  unsigned char *chien_mul; /* 32 bytes for each root.  See fx25_extract.c. */
 };
 
 #define MM (rs->mm)
@@ -53,9 +55,15 @@ void ENCODE_RS(struct rs *rs, DTYPE *data, DTYPE *bb);
 
 int DECODE_RS(struct rs *rs, DTYPE *data, int *eras_pos, int no_eras);
 
+int rs_decode_erasures (struct rs *rs, DTYPE *data, const unsigned char *conf, int *eras_pos);
+
 struct rs *INIT_RS(unsigned int symsize, unsigned int gfpoly,
 		   unsigned int fcr, unsigned int prim, unsigned int nroots);
 
+void rs_decode_init (struct rs *rs);
+
+const char *rs_decode_impl_name (void);
+
 void FREE_RS(struct rs *rs);
 
 
@@ -65,7 +73,7 @@ void FREE_RS(struct rs *rs);
 
 void fx25_init ( int debug_level );
 int fx25_send_frame (int chan, unsigned char *fbuf, int flen, int fx_mode);
-void fx25_rec_bit (int chan, int subchan, int slice, int dbit);
+void fx25_rec_bit (int chan, int subchan, int slice, int dbit, int quality);
 int fx25_rec_busy (int chan);
 
 
@@ -60,12 +60,25 @@
    *
    */
 
+#include "direwolf.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "textcolor.h"
 #include "fx25.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define RS_NEON 1
+#include <arm_neon.h>
+#endif
+
 
 //#define DEBUG 5    
                
@@ -80,26 +93,87 @@
 //  
 //-----------------------------------------------------------------------
 // 0.0.2  - 
+//
+//  Dire Wolf 1.8 - Syndromes and Chien search 16 symbols at a time
+//          with SIMD instructions when available.  See below.
+//-----------------------------------------------------------------------
 
 
 #define	min(a,b)	((a) < (b) ? (a) : (b))
 
 
 
-int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int no_eras) {
+/*-------------------------------------------------------------------
+ *
+ * Most blocks received have no errors, or a few.  The time goes into
+ * computing the syndromes, NN * NROOTS multiplies, and when there are
+ * errors, the Chien search, NN * deg(lambda) multiplies.
+ *
+ * Both are done 16 symbols at a time here, using the SSSE3 PSHUFB or
+ * ARM TBL instruction as 16 table lookups at once.  A product with a
+ * constant c is  c*(v & 0x0f) ^ c*(v & 0xf0)  so two 16 entry tables
+ * do it.  The tables for each constant needed are built at init time.
+ *
+ * Syndromes:  The block is padded to 256 with a leading zero, which
+ * doesn't change the polynomial's value.  Lane l gets symbols l, l+16,
+ * l+32 ... and Horner's rule is done on each lane with x**16.  That is
+ * the same constant for all lanes.  At the end, the lanes are combined
+ * with x**(15-l).
+ *
+ * Chien search:  Lane l of term j starts out as lambda[j] * alpha**(j*(l+1))
+ * and is multiplied by alpha**(16*j) for each step of 16 positions.
+ *
+ * Only for 8 bit symbols and prim = 1, which covers both FX.25 and IL2P.
+ * Otherwise the original one at a time code is used.
+ *
+ *--------------------------------------------------------------------*/
 
-  int deg_lambda, el, deg_omega;
-  int i, j, r,k;
-  DTYPE u,q,tmp,num1,num2,den,discr_r;
-//  DTYPE lambda[NROOTS+1], s[NROOTS];	/* Err+Eras Locator poly and syndrome poly */
-//  DTYPE b[NROOTS+1], t[NROOTS+1], omega[NROOTS+1];
-//  DTYPE root[NROOTS], reg[NROOTS+1], loc[NROOTS];
-  DTYPE lambda[FX25_MAX_CHECK+1], s[FX25_MAX_CHECK];	/* Err+Eras Locator poly and syndrome poly */
-  DTYPE b[FX25_MAX_CHECK+1], t[FX25_MAX_CHECK+1], omega[FX25_MAX_CHECK+1];
-  DTYPE root[FX25_MAX_CHECK], reg[FX25_MAX_CHECK+1], loc[FX25_MAX_CHECK];
-  int syn_error, count;
 
-  /* form the syndromes; i.e., evaluate data(x) at roots of g(x) */
+/* Scalar multiply in poly form. */
+
+static inline DTYPE gf_mul (struct rs *rs, DTYPE a, DTYPE b)
+{
+  if (a == 0 || b == 0) return (0);
+  return (ALPHA_TO[MODNN(INDEX_OF[a] + INDEX_OF[b])]);
+}
+
+
+/* Combine the 16 lanes after Horner's rule on each.  r is the root in index form. */
+
+static inline DTYPE combine_lanes (struct rs *rs, const DTYPE *lane, int r)
+{
+  DTYPE sum = 0;
+  DTYPE x = ALPHA_TO[MODNN(r)];
+
+  for (int l = 0; l < 16; l++) {
+    sum = gf_mul (rs, sum, x) ^ lane[l];
+  }
+  return (sum);
+}
+
+
+/* Starting value for each lane of Chien search term j.  lambda_j is index form. */
+
+static inline void chien_start (struct rs *rs, int lambda_j, int j, DTYPE *lane)
+{
+  for (int l = 0; l < 16; l++) {
+    lane[l] = ALPHA_TO[MODNN(lambda_j + j * (l + 1))];
+  }
+}
+
+
+/*
+ * Original code.
+ *
+ * Syndromes are left in poly form.
+ * Chien search takes lambda in index form and returns number of roots found,
+ * stopping after deg_lambda.
+ */
+
+static void syndromes_generic (struct rs *rs, const DTYPE *data, DTYPE *s)
+{
+  int i, j;
+
   for(i=0;i<NROOTS;i++)
     s[i] = data[0];
 
@@ -112,13 +186,323 @@ int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int
       }
     }
   }
+}
+
+static int chien_generic (struct rs *rs, const DTYPE *lambda, int deg_lambda, DTYPE *root, DTYPE *loc)
+{
+  int i, j, k, count;
+  DTYPE q;
+  DTYPE reg[FX25_MAX_CHECK+1];
+
+  memcpy(&reg[1],&lambda[1],NROOTS*sizeof(reg[0]));
+  count = 0;		/* Number of roots of lambda(x) */
+  for (i = 1,k=IPRIM-1; i <= NN; i++,k = MODNN(k+IPRIM)) {
+    q = 1; /* lambda[0] is always 0 */
+    for (j = deg_lambda; j > 0; j--){
+      if (reg[j] != A0) {
+	reg[j] = MODNN(reg[j] + j);
+	q ^= ALPHA_TO[reg[j]];
+      }
+    }
+    if (q != 0)
+      continue; /* Not a root */
+    /* store root (index-form) and error location number */
+#if DEBUG>=2
+    fprintf(stderr,"count %d root %d loc %d\n",count,i,k);
+#endif
+    root[count] = i;
+    loc[count] = k;
+    /* If we've already found max possible roots,
+     * abort the search to save time
+     */
+    if(++count == deg_lambda)
+      break;
+  }
+  return (count);
+}
+
+
+#if RS_X86
+
+__attribute__((target("ssse3"))) __attribute__((always_inline))
+static inline __m128i gf_mul_ssse3 (__m128i v, const unsigned char *tab)
+{
+	const __m128i mask = _mm_set1_epi8 (0x0f);
+	__m128i lo = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)tab), _mm_and_si128 (v, mask));
+	__m128i hi = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(tab + 16)), _mm_and_si128 (_mm_srli_epi16 (v, 4), mask));
+	return (_mm_xor_si128 (lo, hi));
+}
+
+__attribute__((target("ssse3")))
+static void syndromes_ssse3 (struct rs *rs, const DTYPE *data, DTYPE *s)
+{
+	DTYPE buf[256];
+	DTYPE lane[16];
+
+	buf[0] = 0;
+	memcpy (buf + 1, data, 255);
+
+	for (int i = 0; i < NROOTS; i++) {
+	  const unsigned char *tab = rs->syn_mul + 32 * i;
+	  __m128i acc = _mm_loadu_si128 ((const __m128i *)buf);
+
+	  for (int b = 16; b < 256; b += 16) {
+	    acc = _mm_xor_si128 (gf_mul_ssse3 (acc, tab), _mm_loadu_si128 ((const __m128i *)(buf + b)));
+	  }
+	  _mm_storeu_si128 ((__m128i *)lane, acc);
+	  s[i] = combine_lanes (rs, lane, (FCR + i) * PRIM);
+	}
+}
+
+__attribute__((target("ssse3")))
+static int chien_ssse3 (struct rs *rs, const DTYPE *lambda, int deg_lambda, DTYPE *root, DTYPE *loc)
+{
+	__m128i term[FX25_MAX_CHECK+1];
+	int used[FX25_MAX_CHECK+1];
+	int nused = 0;
+	int count = 0;
+	DTYPE lane[16];
+
+	for (int j = 1; j <= deg_lambda; j++) {
+	  if (lambda[j] != A0) {
+	    chien_start (rs, lambda[j], j, lane);
+	    term[nused] = _mm_loadu_si128 ((const __m128i *)lane);
+	    used[nused] = j;
+	    nused++;
+	  }
+	}
+
+	for (int i0 = 1; i0 <= NN; i0 += 16) {
+	  __m128i q = _mm_set1_epi8 (1);
+
+	  for (int n = 0; n < nused; n++) {
+	    q = _mm_xor_si128 (q, term[n]);
+	    term[n] = gf_mul_ssse3 (term[n], rs->chien_mul + 32 * (used[n] - 1));
+	  }
+
+	  unsigned int zero = _mm_movemask_epi8 (_mm_cmpeq_epi8 (q, _mm_setzero_si128()));
+	  while (zero != 0) {
+	    int i = i0 + __builtin_ctz (zero);
+	    if (i > NN) return (count);
+	    root[count] = i;
+	    loc[count] = i - 1;
+	    if (++count == deg_lambda) return (count);
+	    zero &= zero - 1;
+	  }
+	}
+	return (count);
+}
+
+#endif	/* RS_X86 */
+
+
+#if RS_NEON
+
+static inline uint8x16_t gf_mul_neon (uint8x16_t v, const unsigned char *tab)
+{
+	uint8x16_t lo = vqtbl1q_u8 (vld1q_u8 (tab), vandq_u8 (v, vdupq_n_u8 (0x0f)));
+	uint8x16_t hi = vqtbl1q_u8 (vld1q_u8 (tab + 16), vshrq_n_u8 (v, 4));
+	return (veorq_u8 (lo, hi));
+}
+
+static void syndromes_neon (struct rs *rs, const DTYPE *data, DTYPE *s)
+{
+	DTYPE buf[256];
+	DTYPE lane[16];
+
+	buf[0] = 0;
+	memcpy (buf + 1, data, 255);
+
+	for (int i = 0; i < NROOTS; i++) {
+	  const unsigned char *tab = rs->syn_mul + 32 * i;
+	  uint8x16_t acc = vld1q_u8 (buf);
+
+	  for (int b = 16; b < 256; b += 16) {
+	    acc = veorq_u8 (gf_mul_neon (acc, tab), vld1q_u8 (buf + b));
+	  }
+	  vst1q_u8 (lane, acc);
+	  s[i] = combine_lanes (rs, lane, (FCR + i) * PRIM);
+	}
+}
+
+static int chien_neon (struct rs *rs, const DTYPE *lambda, int deg_lambda, DTYPE *root, DTYPE *loc)
+{
+	uint8x16_t term[FX25_MAX_CHECK+1];
+	int used[FX25_MAX_CHECK+1];
+	int nused = 0;
+	int count = 0;
+	DTYPE lane[16];
+
+	for (int j = 1; j <= deg_lambda; j++) {
+	  if (lambda[j] != A0) {
+	    chien_start (rs, lambda[j], j, lane);
+	    term[nused] = vld1q_u8 (lane);
+	    used[nused] = j;
+	    nused++;
+	  }
+	}
+
+	for (int i0 = 1; i0 <= NN; i0 += 16) {
+	  uint8x16_t q = vdupq_n_u8 (1);
+
+	  for (int n = 0; n < nused; n++) {
+	    q = veorq_u8 (q, term[n]);
+	    term[n] = gf_mul_neon (term[n], rs->chien_mul + 32 * (used[n] - 1));
+	  }
+
+	  if (vmaxvq_u8 (vceqzq_u8 (q)) == 0) continue;
+
+	  vst1q_u8 (lane, q);
+	  for (int l = 0; l < 16; l++) {
+	    if (lane[l] != 0) continue;
+	    int i = i0 + l;
+	    if (i > NN) return (count);
+	    root[count] = i;
+	    loc[count] = i - 1;
+	    if (++count == deg_lambda) return (count);
+	  }
+	}
+	return (count);
+}
+
+#endif	/* RS_NEON */
+
+
+struct rs_impl_s {
+	const char *name;
+	int (*supported) (void);
+	void (*syndromes) (struct rs *rs, const DTYPE *data, DTYPE *s);
+	int (*chien) (struct rs *rs, const DTYPE *lambda, int deg_lambda, DTYPE *root, DTYPE *loc);
+};
+
+#if RS_X86
+static int have_ssse3 (void) { return (__builtin_cpu_supports("ssse3")); }
+#endif
+static int have_always (void) { return (1); }
+
+static const struct rs_impl_s impl_table[] = {
+#if RS_X86
+	{ "SSSE3",	have_ssse3,	syndromes_ssse3,	chien_ssse3 },
+#endif
+#if RS_NEON
+	{ "NEON",	have_always,	syndromes_neon,		chien_neon },
+#endif
+	{ "generic",	have_always,	syndromes_generic,	chien_generic }
+};
+
+#define NUM_IMPL ((int)(sizeof(impl_table) / sizeof(impl_table[0])))
+
+static const struct rs_impl_s *impl = &impl_table[NUM_IMPL-1];
+
 
-  /* Convert syndromes to index form, checking for nonzero condition */
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rs_decode_init
+ *
+ * Purpose:     Build the tables for multiplying 16 symbols at a time.
+ *
+ * Inputs:	rs	- Codec from INIT_RS, which calls this.
+ *			  NULL to only select the implementation.
+ *
+ * Description:	Also select the best implementation for this CPU.
+ *		If this codec can't use it, syn_mul stays NULL and
+ *		the generic code is used.
+ *
+ *--------------------------------------------------------------------*/
+
+static void nibble_table (struct rs *rs, DTYPE c, unsigned char *tab)
+{
+	for (int n = 0; n < 16; n++) {
+	  tab[n] = gf_mul (rs, c, n);
+	  tab[n+16] = gf_mul (rs, c, n << 4);
+	}
+}
+
+void rs_decode_init (struct rs *rs)
+{
+	static int done = 0;
+
+	if ( ! done) {
+	  done = 1;
+#if RS_X86
+	  __builtin_cpu_init ();
+#endif
+	  for (int n = 0; n < NUM_IMPL; n++) {
+	    if (impl_table[n].supported()) {
+	      impl = &impl_table[n];
+	      break;
+	    }
+	  }
+	}
+
+	if (rs == NULL) return;
+
+	rs->syn_mul = NULL;
+	rs->chien_mul = NULL;
+
+	if (MM != 8 || PRIM != 1) return;
+
+	rs->syn_mul = malloc (32 * NROOTS);
+	rs->chien_mul = malloc (32 * NROOTS);
+	if (rs->syn_mul == NULL || rs->chien_mul == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("FATAL ERROR: Out of memory.\n");
+	  exit (EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < NROOTS; i++) {
+	  nibble_table (rs, ALPHA_TO[MODNN(16 * (FCR + i) * PRIM)], rs->syn_mul + 32 * i);
+	  nibble_table (rs, ALPHA_TO[MODNN(16 * (i + 1))], rs->chien_mul + 32 * i);
+	}
+
+} /* end rs_decode_init */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rs_decode_impl_name
+ *
+ * Purpose:     Which implementation was selected, for informational
+ *		or debugging purposes.
+ *
+ *--------------------------------------------------------------------*/
+
+const char *rs_decode_impl_name (void)
+{
+	return (impl->name);
+}
+
+
+
+
+int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int no_eras) {
+
+  int deg_lambda, el, deg_omega;
+  int i, j, r;
+  DTYPE u,tmp,num1,num2,den,discr_r;
+//  DTYPE lambda[NROOTS+1], s[NROOTS];	/* Err+Eras Locator poly and syndrome poly */
+//  DTYPE b[NROOTS+1], t[NROOTS+1], omega[NROOTS+1];
+//  DTYPE root[NROOTS], reg[NROOTS+1], loc[NROOTS];
+  DTYPE lambda[FX25_MAX_CHECK+1], s[FX25_MAX_CHECK];	/* Err+Eras Locator poly and syndrome poly */
+  DTYPE b[FX25_MAX_CHECK+1], t[FX25_MAX_CHECK+1], omega[FX25_MAX_CHECK+1];
+  DTYPE root[FX25_MAX_CHECK], loc[FX25_MAX_CHECK];
+#if DEBUG >= 1
+  int k;
+  DTYPE q, reg[FX25_MAX_CHECK+1];
+#endif
+  int syn_error, count;
+
+  /* form the syndromes; i.e., evaluate data(x) at roots of g(x) */
+  if (rs->syn_mul != NULL)
+    impl->syndromes(rs, data, s);
+  else
+    syndromes_generic(rs, data, s);
+
+  /* Nonzero check first; the usual case is a good block. */
   syn_error = 0;
-  for(i=0;i<NROOTS;i++){
+  for(i=0;i<NROOTS;i++)
     syn_error |= s[i];
-    s[i] = INDEX_OF[s[i]];
-  }
 
   // fprintf(stderr,"syn_error = %4x\n",syn_error);
   if (!syn_error) {
@@ -128,6 +512,11 @@ int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int
     count = 0;
     goto finish;
   }
+
+  /* Convert syndromes to index form */
+  for(i=0;i<NROOTS;i++)
+    s[i] = INDEX_OF[s[i]];
+
   memset(&lambda[1],0,NROOTS*sizeof(lambda[0]));
   lambda[0] = 1;
 
@@ -235,30 +624,10 @@ int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int
       deg_lambda = i;
   }
   /* Find roots of the error+erasure locator polynomial by Chien search */
-  memcpy(&reg[1],&lambda[1],NROOTS*sizeof(reg[0]));
-  count = 0;		/* Number of roots of lambda(x) */
-  for (i = 1,k=IPRIM-1; i <= NN; i++,k = MODNN(k+IPRIM)) {
-    q = 1; /* lambda[0] is always 0 */
-    for (j = deg_lambda; j > 0; j--){
-      if (reg[j] != A0) {
-	reg[j] = MODNN(reg[j] + j);
-	q ^= ALPHA_TO[reg[j]];
-      }
-    }
-    if (q != 0)
-      continue; /* Not a root */
-    /* store root (index-form) and error location number */
-#if DEBUG>=2
-    fprintf(stderr,"count %d root %d loc %d\n",count,i,k);
-#endif
-    root[count] = i;
-    loc[count] = k;
-    /* If we've already found max possible roots,
-     * abort the search to save time
-     */
-    if(++count == deg_lambda)
-      break;
-  }
+  if (rs->syn_mul != NULL)
+    count = impl->chien(rs, lambda, deg_lambda, root, loc);
+  else
+    count = chien_generic(rs, lambda, deg_lambda, root, loc);
   if (deg_lambda != count) {
     /*
      * deg(lambda) unequal to number of roots => uncorrectable
@@ -323,4 +692,206 @@ int DECODE_RS(struct rs * restrict rs, DTYPE * restrict data, int *eras_pos, int
   return count;
 }
 
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rs_decode_erasures
+ *
+ * Purpose:     Try again, after DECODE_RS failed, with the least
+ *		confident symbols marked as erasures.
+ *
+ * Inputs:	rs	- Reed-Solomon codec.
+ *
+ *		data	- Codeblock as received, NN symbols.
+ *
+ *		conf	- How sure the demodulator was about each symbol,
+ *			  0 to 100.  This is the lowest quality of its bits.
+ *			  Use 100 for anything known, such as zero fill.
+ *
+ * Outputs:	data	- Corrected if successful.
+ *
+ *		eras_pos - Positions corrected, as for DECODE_RS.
+ *
+ * Returns:	Number of symbols corrected or -1 for failure.
+ *
+ * Description:	An error at an unknown place uses up 2 check symbols.
+ *		An erasure, where we know the place, uses only 1.  If the
+ *		demodulator was unsure about the bad symbols, marking
+ *		them as erasures lets us fix more of them.
+ *
+ *		Marking a good symbol as an erasure wastes a check symbol
+ *		and leaves less to catch a bad decode.  Only symbols below
+ *		RS_ERASE_BELOW are considered, no more than half of the
+ *		check symbols, and not at all for the tiny IL2P header
+ *		blocks.
+ *
+ *--------------------------------------------------------------------*/
+
+#define RS_ERASE_BELOW 50
+
+int rs_decode_erasures (struct rs *rs, DTYPE *data, const unsigned char *conf, int *eras_pos)
+{
+  int cand[FX25_BLOCK_SIZE];
+  int ncand = 0;
+  DTYPE trial[FX25_BLOCK_SIZE];
+
+  if (NROOTS < 4) return (-1);
+
+  /* Least confident first.  Insertion sort is fine for a few. */
+  for (int i = 0; i < NN; i++) {
+    if (conf[i] < RS_ERASE_BELOW) {
+      int j = ncand++;
+      while (j > 0 && conf[cand[j-1]] > conf[i]) {
+	cand[j] = cand[j-1];
+	j--;
+      }
+      cand[j] = i;
+    }
+  }
+
+  int no_eras = min(ncand, NROOTS / 2);
+  if (no_eras == 0) return (-1);
+
+  int pos[FX25_MAX_CHECK];
+  memcpy (pos, cand, no_eras * sizeof(int));
+  memcpy (trial, data, NN);
+  int count = DECODE_RS (rs, trial, pos, no_eras);
+
+  /* The decoder can find a code word further away than it should, */
+  /* so make sure it didn't need more than the check symbols allow. */
+  if (count < 0 || 2 * (count - no_eras) + no_eras > NROOTS) {
+    return (-1);
+  }
+
+  memcpy (data, trial, NN);
+  if (eras_pos != NULL) {
+    memcpy (eras_pos, pos, count * sizeof(int));
+  }
+  return (count);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ *	Unit test.  Random code words with random errors.
+ *	Each implementation this CPU can run must give the same
+ *	result as the original code, and fix what it should.
+ *
+ *--------------------------------------------------------------------*/
+
+#if RSTEST
+
+int main (int argc, char *argv[])
+{
+	static const struct { int fcr; int nroots; } codec[] = {
+		{ 1, 16 }, { 1, 32 }, { 1, 64 },		// FX.25
+		{ 0, 2 }, { 0, 4 }, { 0, 6 }, { 0, 8 }, { 0, 16 }	// IL2P
+	};
+	DTYPE orig[FX25_BLOCK_SIZE], bad[FX25_BLOCK_SIZE], expect[FX25_BLOCK_SIZE], got[FX25_BLOCK_SIZE];
+	int errors = 0;
+	int tested = 0;
+
+	srand (1);
+	rs_decode_init (NULL);
+	const struct rs_impl_s *best = impl;
+
+	text_color_set (DW_COLOR_INFO);
+	dw_printf ("Selected implementation: %s\n", rs_decode_impl_name());
+
+	for (int c = 0; c < (int)(sizeof(codec) / sizeof(codec[0])); c++) {
+	  struct rs *rs = INIT_RS (8, 0x11d, codec[c].fcr, 1, codec[c].nroots);
+
+	  for (int trial = 0; trial < 2000; trial++) {
+	    int k = NN - NROOTS;
+	    for (int j = 0; j < k; j++) {
+	      orig[j] = rand() & 0xff;
+	    }
+	    ENCODE_RS (rs, orig, orig + k);
+
+	    // Sometimes more errors than it can fix.
+	    int nerr = rand() % (NROOTS / 2 + 3);
+	    memcpy (bad, orig, NN);
+	    for (int e = 0; e < nerr; e++) {
+	      bad[rand() % NN] ^= 1 + rand() % 255;
+	    }
+
+	    memcpy (expect, bad, NN);
+	    impl = &impl_table[NUM_IMPL-1];
+	    int n_expect = DECODE_RS (rs, expect, NULL, 0);
+
+	    if (nerr <= NROOTS / 2 && memcmp (expect, orig, NN) != 0) {
+	      errors++;
+	    }
+
+	    for (int n = 0; n < NUM_IMPL; n++) {
+	      if ( ! impl_table[n].supported()) continue;
+	      impl = &impl_table[n];
+	      memcpy (got, bad, NN);
+	      int n_got = DECODE_RS (rs, got, NULL, 0);
+	      if (n_got != n_expect || memcmp (got, expect, NN) != 0) {
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("%s, RS(255,%d), %d errors: returned %d, expected %d\n",
+			impl->name, k, nerr, n_got, n_expect);
+	        errors++;
+	      }
+	      tested++;
+	    }
+	  }
+
+	  // More errors than it could fix without knowing where, but the
+	  // demodulator was unsure about those bytes.  Up to 3/4 of NROOTS
+	  // can be fixed when half are erasures.
+
+	  for (int trial = 0; NROOTS >= 4 && trial < 500; trial++) {
+	    unsigned char conf[FX25_BLOCK_SIZE];
+	    int k = NN - NROOTS;
+	    for (int j = 0; j < k; j++) {
+	      orig[j] = rand() & 0xff;
+	    }
+	    ENCODE_RS (rs, orig, orig + k);
+
+	    int nerr = NROOTS / 2 + 1 + rand() % (NROOTS / 4);
+	    memcpy (bad, orig, NN);
+	    memset (conf, 100, sizeof(conf));
+	    for (int e = 0; e < nerr; ) {
+	      int p = rand() % NN;
+	      if (conf[p] < 100) continue;
+	      bad[p] ^= 1 + rand() % 255;
+	      conf[p] = rand() % RS_ERASE_BELOW;
+	      e++;
+	    }
+
+	    memcpy (got, bad, NN);
+	    if (DECODE_RS (rs, got, NULL, 0) >= 0 && memcmp (got, orig, NN) == 0) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("RS(255,%d), %d errors: fixed without erasures?\n", k, nerr);
+	      errors++;
+	    }
+	    memcpy (got, bad, NN);
+	    int n_got = rs_decode_erasures (rs, got, conf, NULL);
+	    if (n_got < 0 || memcmp (got, orig, NN) != 0) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("RS(255,%d), %d errors: not fixed with erasures, returned %d\n", k, nerr, n_got);
+	      errors++;
+	    }
+	    tested++;
+	  }
+	  FREE_RS (rs);
+	}
+	impl = best;
+
+	if (errors) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("\nReed-Solomon decode test FAILED.  %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+	text_color_set(DW_COLOR_REC);
+	dw_printf ("\nReed-Solomon decode test - PASSED.  %d decodes.\n", tested);
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
 // end fx25_extract.c
\ No newline at end of file
@@ -141,15 +141,47 @@ static const struct correlation_tag_s tags[16] = {
 // in an integer.  This can result in a single machine instruction.  You might need
 // to supply your own popcount function if using a different compiler.
 
-int fx25_tag_find_match (uint64_t t)
+// This is done for every bit, from every slicer of every demodulator,
+// so we don't want to compare against all of the tags each time.
+// Split the 64 bits into 9 pieces.  With no more than 8 bits wrong,
+// at least one piece must be exactly the same as in the matching tag.
+// A table for each piece gives the tags with that value there.
+// Random bits are ruled out most of the time without any popcount.
+
+#define NUM_PIECES 9
+#define PIECE_BITS 7		// Last one gets the extra bit.
+
+static uint16_t piece_tags[NUM_PIECES][256];	// Bit mask of tags, bit 0 = CTAG_MIN.
+
+static void piece_tags_init (void)
 {
+	memset (piece_tags, 0, sizeof(piece_tags));
 	for (int c = CTAG_MIN; c <= CTAG_MAX; c++) {
+	  for (int p = 0; p < NUM_PIECES; p++) {
+	    int mask = (p == NUM_PIECES - 1) ? 0xff : 0x7f;
+	    piece_tags[p][(tags[c].value >> (p * PIECE_BITS)) & mask] |= 1 << (c - CTAG_MIN);
+	  }
+	}
+}
+
+int fx25_tag_find_match (uint64_t t)
+{
+	unsigned int maybe = 0;
+
+	for (int p = 0; p < NUM_PIECES - 1; p++) {
+	  maybe |= piece_tags[p][(t >> (p * PIECE_BITS)) & 0x7f];
+	}
+	maybe |= piece_tags[NUM_PIECES - 1][t >> ((NUM_PIECES - 1) * PIECE_BITS)];
+
+	while (maybe != 0) {
+	  int c = CTAG_MIN + __builtin_ctz(maybe);
 	  if (__builtin_popcountll(t ^ tags[c].value) <= CLOSE_ENOUGH) {
 	    //printf ("%016" PRIx64 " received\n", t);
 	    //printf ("%016" PRIx64 " tag %d\n", tags[c].value, c);
 	    //printf ("%016" PRIx64 " xor, popcount = %d\n", t ^ tags[c].value, __builtin_popcountll(t ^ tags[c].value));
 	    return (c);
 	  }
+	  maybe &= maybe - 1;
 	}
 	return (-1);
 }
@@ -160,6 +192,8 @@ void free_rs_char(struct rs *rs){
   free(rs->alpha_to);
   free(rs->index_of);
   free(rs->genpoly);
+  free(rs->syn_mul);
+  free(rs->chien_mul);
   free(rs);
 }
 
@@ -185,10 +219,20 @@ void free_rs_char(struct rs *rs){
 
 static int g_debug_level;
 
+// Guards the per-channel Reed-Solomon result cache in fx25_rec.c.
+// Defined here, rather than there, because some applications use
+// this file without the receive side.
+
+dw_mutex_t fx25_rs_cache_lock[MAX_CHANS];
+
 void fx25_init ( int debug_level )
 {
 	g_debug_level = debug_level;
 
+	for (int chan = 0; chan < MAX_CHANS; chan++) {
+	  dw_mutex_init (&fx25_rs_cache_lock[chan]);
+	}
+
 	for (int i = 0 ; i < NTAB ; i++) {
 	  Tab[i].rs = INIT_RS(Tab[i].symsize, Tab[i].genpoly, Tab[i].fcs,  Tab[i].prim, Tab[i].nroots);
 	  if (Tab[i].rs == NULL) {
@@ -198,6 +242,8 @@ void fx25_init ( int debug_level )
 	  }
 	}
 
+	piece_tags_init ();
+
 	// Verify integrity of tables and assumptions.
 	// This also does a quick check for the popcount function.
 
@@ -486,6 +532,9 @@ struct rs *INIT_RS(unsigned int symsize,unsigned int gfpoly,unsigned fcr,unsigne
   for (i = 0; i <= nroots; i++) {
     rs->genpoly[i] = rs->index_of[rs->genpoly[i]];
   }
+
+  /* Tables for faster decoding. */
+  rs_decode_init(rs);
   
 // diagnostic prints
 #if 0
@@ -44,6 +44,7 @@
 #include "textcolor.h"
 #include "multi_modem.h"
 #include "demod.h"
+#include "rx_stats.h"
 
 struct fx_context_s {
 
@@ -57,10 +58,38 @@ struct fx_context_s {
 	int clen;		// Accumulated length in "check" below.
 	unsigned char imask;	// Mask for storing a bit.
 	unsigned char block[FX25_BLOCK_SIZE+1];
+	unsigned char conf[FX25_BLOCK_SIZE];	// Lowest bit quality for each byte of block.
+						// 100 for zero fill so it is never an erasure.
 };
 
 static struct fx_context_s *fx_context[MAX_CHANS][MAX_SUBCHANS][MAX_SLICERS];
 
+
+// With multiple slicers, or demodulators with different filters,
+// we often get the very same codeblock more than once.
+// The Reed-Solomon decoder always gives the same result for the same
+// input so remember a few recent results rather than doing it again.
+// Demodulators for one channel could be running in different threads
+// so a mutex for each channel keeps them from stepping on each other.
+// It is held only while comparing and copying, never around DECODE_RS.
+// The mutexes live in fx25_init.c so fx25_init can initialize them.
+
+#define RS_CACHE_SIZE 8
+
+struct rs_cache_s {
+	struct rs *rs;				// NULL for unused entry.
+	unsigned char rec[FX25_BLOCK_SIZE];	// As received.
+	unsigned char fixed[FX25_BLOCK_SIZE];	// After decoding.
+	int derrors;
+	int derrlocs[FX25_MAX_CHECK];
+};
+
+static struct rs_cache_s rs_cache[MAX_CHANS][RS_CACHE_SIZE];
+static int rs_cache_next[MAX_CHANS];
+extern dw_mutex_t fx25_rs_cache_lock[MAX_CHANS];
+
+static int cached_decode_rs (int chan, struct rs *rs, unsigned char *block, int *derrlocs);
+
 static void process_rs_block (int chan, int subchan, int slice, struct fx_context_s *F);
 
 static int my_unstuff (int chan, int subchan, int slice, unsigned char * restrict pin, int ilen, unsigned char * restrict frame_buf);
@@ -98,7 +127,7 @@ int main ()
 	  unsigned char ch;
 	  while (fread(&ch, 1, 1, fp) == 1) {
 	    for (unsigned char imask = 0x01; imask != 0; imask <<=1) {
-	      fx25_rec_bit (0, 0, 0, ch & imask);
+	      fx25_rec_bit (0, 0, 0, ch & imask, 100);
 	    }
 	  }
 	  fclose (fp);
@@ -141,6 +170,10 @@ int main ()
  *              dbit	- Data bit after NRZI and any descrambling.
  *			  Any non-zero value is logic '1'.
  *
+ *		quality	- How sure the demodulator is about the bit, 0 to 100.
+ *			  Unsure bytes can be marked as erasures if
+ *			  there are too many errors to fix otherwise.
+ *
  * Description: This is called once for each received bit.
  *              For each valid frame, process_rec_frame() is called for further processing.
  *		It can gather multiple candidates from different parallel demodulators
@@ -150,7 +183,7 @@ int main ()
 
 #define FENCE 0x55		// to detect buffer overflow.
 
-void fx25_rec_bit (int chan, int subchan, int slice, int dbit)
+void fx25_rec_bit (int chan, int subchan, int slice, int dbit, int quality)
 {
 
 // Allocate context blocks only as needed.
@@ -194,12 +227,14 @@ void fx25_rec_bit (int chan, int subchan, int slice, int dbit)
 	      F->clen = 0;
 	      memset (F->block, 0, sizeof(F->block));
 	      F->block[FX25_BLOCK_SIZE] = FENCE;
+	      memset (F->conf, 100, sizeof(F->conf));
 	      F->state = FX_DATA;
 	    }
 	    break;
 
 	  case FX_DATA:
 	    if (dbit) F->block[F->dlen] |= F->imask;
+	    if (quality < F->conf[F->dlen]) F->conf[F->dlen] = quality;
 	    F->imask <<= 1;
 	    if (F->imask == 0) {
 	      F->imask = 0x01;
@@ -212,6 +247,7 @@ void fx25_rec_bit (int chan, int subchan, int slice, int dbit)
 
 	  case FX_CHECK:
 	    if (dbit) F->block[F->coffs + F->clen] |= F->imask;
+	    if (quality < F->conf[F->coffs + F->clen]) F->conf[F->coffs + F->clen] = quality;
 	    F->imask <<= 1;
 	    if (F->imask == 0) {
 	      F->imask = 0x01;
@@ -291,6 +327,8 @@ int fx25_rec_busy (int chan)
  *
  *		F->clen		- Number of "check" bytes"
  *
+ *		F->conf		- Confidence for each byte of the codeblock.
+ *
  *		F->block	- Codeblock.  Always 255 total bytes.
  *				  Anything left over after data and check
  *				  bytes is filled with zeros.
@@ -301,6 +339,8 @@ int fx25_rec_busy (int chan)
  *		+-----------------------+---------------+---------------+
  *
  * Description:	Use Reed-Solomon decoder to fix up any errors.
+ *		If there are too many, try again with the least
+ *		confident bytes marked as erasures.
  *		Extract the AX.25 frame from the corrected data.
  *
  ***********************************************************************************/
@@ -316,8 +356,27 @@ static void process_rs_block (int chan, int subchan, int slice, struct fx_contex
 
 	int derrlocs[FX25_MAX_CHECK];	// Half would probably be OK.
 	struct rs *rs = fx25_get_rs(F->ctag_num);
+	struct rx_slice_stats_s *stats = rx_stats_slice (chan, subchan, slice);
+	uint64_t start = rx_stats_clock();
 
-	int derrors = DECODE_RS(rs, F->block, derrlocs, 0);
+	int derrors = cached_decode_rs (chan, rs, F->block, derrlocs);
+
+	if (derrors < 0) {
+	  derrors = rs_decode_erasures (rs, F->block, F->conf, derrlocs);
+	  if (derrors >= 0 && fx25_get_debug() >= 2) {
+	    text_color_set(DW_COLOR_INFO);
+	    dw_printf ("FX.25[%d.%d]: Too many errors but fixed with erasures.\n", chan, slice);
+	  }
+	}
+
+	rx_stats_time (chan, RX_STAGE_FX25, start);
+	rx_stats_add (&stats->fx25_blocks, 1);
+	if (derrors < 0) {
+	  rx_stats_add (&stats->fx25_failed, 1);
+	}
+	else {
+	  rx_stats_add (&stats->fx25_corrected, derrors);
+	}
 
 	if (derrors >= 0) {		// -1 for failure.  >= 0 for success, number of bytes corrected.
 
@@ -382,6 +441,70 @@ static void process_rs_block (int chan, int subchan, int slice, struct fx_contex
 } // process_rs_block
 
 
+
+/***********************************************************************************
+ *
+ * Name:	cached_decode_rs
+ *
+ * Purpose:     Same as DECODE_RS but reuse the result if we just saw the same codeblock.
+ *
+ * Inputs:	chan	- Radio channel, for selecting the cache.
+ *
+ *		rs	- Reed-Solomon codec.
+ *
+ *		block	- Codeblock, 255 bytes, corrected in place.
+ *
+ * Outputs:	derrlocs - Positions of bytes corrected.
+ *
+ * Returns:	Number of bytes corrected or -1 for failure.
+ *
+ ***********************************************************************************/
+
+static int cached_decode_rs (int chan, struct rs *rs, unsigned char *block, int *derrlocs)
+{
+	unsigned char rec[FX25_BLOCK_SIZE];
+	int derrors;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	dw_mutex_lock (&fx25_rs_cache_lock[chan]);
+
+	for (int n = 0; n < RS_CACHE_SIZE; n++) {
+	  struct rs_cache_s *e = &rs_cache[chan][n];
+	  if (e->rs == rs && memcmp (e->rec, block, FX25_BLOCK_SIZE) == 0) {
+	    memcpy (block, e->fixed, FX25_BLOCK_SIZE);
+	    derrors = e->derrors;
+	    if (derrors > 0) {
+	      memcpy (derrlocs, e->derrlocs, derrors * sizeof(int));
+	    }
+	    dw_mutex_unlock (&fx25_rs_cache_lock[chan]);
+	    return (derrors);
+	  }
+	}
+
+	dw_mutex_unlock (&fx25_rs_cache_lock[chan]);
+
+	memcpy (rec, block, FX25_BLOCK_SIZE);
+	derrors = DECODE_RS(rs, block, derrlocs, 0);
+
+	dw_mutex_lock (&fx25_rs_cache_lock[chan]);
+
+	struct rs_cache_s *e = &rs_cache[chan][rs_cache_next[chan]];
+	rs_cache_next[chan] = (rs_cache_next[chan] + 1) % RS_CACHE_SIZE;
+	e->rs = rs;
+	memcpy (e->rec, rec, FX25_BLOCK_SIZE);
+	memcpy (e->fixed, block, FX25_BLOCK_SIZE);
+	e->derrors = derrors;
+	if (derrors > 0) {
+	  memcpy (e->derrlocs, derrlocs, derrors * sizeof(int));
+	}
+
+	dw_mutex_unlock (&fx25_rs_cache_lock[chan]);
+	return (derrors);
+
+} // cached_decode_rs
+
+
 /***********************************************************************************
  *
  * Name:	my_unstuff  
@@ -1058,6 +1058,19 @@ int audio_put (int a, int c)
 } /* end audio_put */
 
 
+/* Noise is added a sample at a time so there is nothing to gain here. */
+
+int audio_write (int a, const unsigned char *buf, int len)
+{
+	for (int n = 0; n < len; n++) {
+	  if (audio_put (a, buf[n]) < 0) {
+	    return (-1);
+	  }
+	}
+	return (0);
+}
+
+
 int audio_flush (int a)
 {
 	return 0;
@@ -107,6 +107,42 @@ static int save_bit[MAX_CHANS];
 static int prev_dat[MAX_CHANS];		// Previous data bit.  Used for G3RUH style.
 
 
+/*
+ * The audio for the start of a transmission can be generated before
+ * PTT is turned on.  See gen_tone_render_start.
+ * This holds the bytes which would have gone to audio_put.
+ */
+
+#define RENDER_KEEP (1024 * 1024)	// Free a buffer bigger than this after use.
+
+static int rendering[MAX_CHANS];
+static unsigned char *render_buf[MAX_CHANS];
+static int render_len[MAX_CHANS];
+static int render_size[MAX_CHANS];
+
+
+static void put_byte (int chan, int a, int c)
+{
+	if ( ! rendering[chan]) {
+	  audio_put (a, c);
+	  return;
+	}
+
+	if (render_len[chan] >= render_size[chan]) {
+	  int new_size = render_size[chan] > 0 ? render_size[chan] * 2 : 64 * 1024;
+	  unsigned char *p = realloc (render_buf[chan], new_size);
+	  if (p == NULL) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("FATAL ERROR: Out of memory.\n");
+	    exit (EXIT_FAILURE);
+	  }
+	  render_buf[chan] = p;
+	  render_size[chan] = new_size;
+	}
+	render_buf[chan][render_len[chan]++] = c;
+}
+
+
 
 
 /*------------------------------------------------------------------
@@ -614,11 +650,11 @@ void gen_tone_put_sample (int chan, int a, int sam) {
 	  /* Mono */
 
 	  if (save_audio_config_p->adev[a].bits_per_sample == 8) {
-            audio_put (a, ((sam+32768) >> 8) & 0xff);
+            put_byte (chan, a, ((sam+32768) >> 8) & 0xff);
 	  }
 	  else {
-            audio_put (a, sam & 0xff);
-            audio_put (a, (sam >> 8) & 0xff);
+            put_byte (chan, a, sam & 0xff);
+            put_byte (chan, a, (sam >> 8) & 0xff);
 	  }
  	}
 	else {
@@ -628,15 +664,15 @@ void gen_tone_put_sample (int chan, int a, int sam) {
 	    /* Stereo, left channel. */
 
 	    if (save_audio_config_p->adev[a].bits_per_sample == 8) {
-              audio_put (a, ((sam+32768) >> 8) & 0xff);
-              audio_put (a, 0);
+              put_byte (chan, a, ((sam+32768) >> 8) & 0xff);
+              put_byte (chan, a, 0);
 	    }
 	    else {
-              audio_put (a, sam & 0xff);
-              audio_put (a, (sam >> 8) & 0xff);
+              put_byte (chan, a, sam & 0xff);
+              put_byte (chan, a, (sam >> 8) & 0xff);
  
-              audio_put (a, 0);
-              audio_put (a, 0);
+              put_byte (chan, a, 0);
+              put_byte (chan, a, 0);
 	    }
 	  }
 	  else { 
@@ -644,20 +680,78 @@ void gen_tone_put_sample (int chan, int a, int sam) {
 	    /* Stereo, right channel. */
 	  
 	    if (save_audio_config_p->adev[a].bits_per_sample == 8) {
-              audio_put (a, 0);
-              audio_put (a, ((sam+32768) >> 8) & 0xff);
+              put_byte (chan, a, 0);
+              put_byte (chan, a, ((sam+32768) >> 8) & 0xff);
 	    }
 	    else {
-              audio_put (a, 0);
-              audio_put (a, 0);
+              put_byte (chan, a, 0);
+              put_byte (chan, a, 0);
 
-              audio_put (a, sam & 0xff);
-              audio_put (a, (sam >> 8) & 0xff);
+              put_byte (chan, a, sam & 0xff);
+              put_byte (chan, a, (sam >> 8) & 0xff);
 	    }
 	  }
 	}
 }
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        gen_tone_render_start
+ *
+ * Purpose:     Start holding the audio for a channel rather than sending
+ *		it to the audio device.
+ *
+ * Description:	Turning on the transmitter, then generating the preamble
+ *		and frame while it is on, meant the first audio waited
+ *		for however long that took.  Usually fast, but it could
+ *		get held up when the CPU is busy demodulating.  Now the
+ *		start of a transmission can be generated first, then
+ *		sent all at once by gen_tone_render_end right after PTT.
+ *
+ *		Everything is generated in the same order as before.
+ *		Phase and scrambler state carry over from one frame to
+ *		the next so audio can't be saved and reused for a later
+ *		frame with the same contents.
+ *
+ *--------------------------------------------------------------------*/
+
+void gen_tone_render_start (int chan)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	rendering[chan] = 1;
+	render_len[chan] = 0;
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        gen_tone_render_end
+ *
+ * Purpose:     Send audio held since gen_tone_render_start to the
+ *		audio device and go back to sending it right away.
+ *
+ *--------------------------------------------------------------------*/
+
+void gen_tone_render_end (int chan)
+{
+	int a = ACHAN2ADEV(chan);
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	rendering[chan] = 0;
+
+	audio_write (a, render_buf[chan], render_len[chan]);
+	render_len[chan] = 0;
+
+	if (render_size[chan] > RENDER_KEEP) {
+	  free (render_buf[chan]);
+	  render_buf[chan] = NULL;
+	  render_size[chan] = 0;
+	}
+}
+
+
 void gen_tone_put_quiet_ms (int chan, int time_ms) {
 
 	int a = ACHAN2ADEV(chan);	/* device for channel. */
@@ -16,4 +16,8 @@ void tone_gen_put_bit (int chan, int dat);
 
 void gen_tone_put_sample (int chan, int a, int sam);
 
-void gen_tone_put_quiet_ms (int chan, int time_ms);
\ No newline at end of file
+void gen_tone_put_quiet_ms (int chan, int time_ms);
+
+void gen_tone_render_start (int chan);
+
+void gen_tone_render_end (int chan);
\ No newline at end of file
@@ -0,0 +1,352 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      hdlc_deframe.c
+ *
+ * Purpose:   	Remove HDLC bit stuffing and collect octets, 8 bits at a time.
+ *
+ * Description:	hdlc_rec2 tries decoding the same block of bits many
+ *		times, with different bits inverted, when FIX_BITS is used.
+ *		It undoes NRZI and scrambling a word at a time.  That leaves
+ *		the part going one bit at a time:
+ *
+ *		  - After five 1 bits in a row, a 0 bit is discarded.
+ *		  - 01111110 is a flag.  Shouldn't be in the middle of a frame.
+ *		  - Seven 1 bits in a row is an abort, or loss of signal.
+ *		  - Other bits are collected into octets, LSB first.
+ *
+ *		The only thing we need to remember between bits is how many
+ *		1 bits were in a row, 0 to 6.  For each of those, and each
+ *		possible next 8 data bits, a table gives the bits kept, how
+ *		many, the new count, and whether a flag or abort was found.
+ *
+ *		The live receive path, hdlc_rec_bit, still goes a bit at a
+ *		time because every demodulator produces one bit at a time.
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "textcolor.h"
+#include "hdlc_deframe.h"
+
+
+struct step_s {
+	unsigned char data;		/* Data bits kept, first in lsb. */
+	unsigned char ndata;		/* Number of them, 0 to 8. */
+	unsigned char ones;		/* Number of 1 bits in a row at end. */
+	unsigned char event;		/* HDLC_DEFRAME_MORE, _FLAG, or _ABORT. */
+};
+
+static struct step_s step[7][256];
+
+static int was_init = 0;
+
+
+/*
+ * Process one bit.  Used for building the table and for
+ * any left over at the end.  Does not complete octets.
+ */
+
+static inline int one_bit (struct hdlc_deframe_s *D, int dbit)
+{
+	if (dbit) {
+	  D->ones++;
+	  if (D->ones == 7) {
+	    return (HDLC_DEFRAME_ABORT);
+	  }
+	  D->acc |= 1u << D->alen;
+	  D->alen++;
+	}
+	else {
+	  if (D->ones == 6) {
+	    return (HDLC_DEFRAME_FLAG);
+	  }
+	  if (D->ones != 5) {		/* Otherwise discard stuffed bit. */
+	    D->alen++;
+	  }
+	  D->ones = 0;
+	}
+	return (HDLC_DEFRAME_MORE);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        hdlc_deframe_init
+ *
+ * Purpose:     Build the table.
+ *
+ * Description:	Must be called before any other threads use it.
+ *		hdlc_rec2_init takes care of that.
+ *
+ *--------------------------------------------------------------------*/
+
+void hdlc_deframe_init (void)
+{
+	if (was_init) return;
+
+	for (int ones = 0; ones < 7; ones++) {
+	  for (int byte = 0; byte < 256; byte++) {
+	    struct hdlc_deframe_s D;
+	    int event = HDLC_DEFRAME_MORE;
+
+	    D.ones = ones;
+	    D.acc = 0;
+	    D.alen = 0;
+
+	    for (int b = 0; b < 8 && event == HDLC_DEFRAME_MORE; b++) {
+	      event = one_bit (&D, (byte >> b) & 1);
+	    }
+
+	    step[ones][byte].data = D.acc;
+	    step[ones][byte].ndata = D.alen;
+	    step[ones][byte].ones = D.ones;
+	    step[ones][byte].event = event;
+	  }
+	}
+	was_init = 1;
+
+} /* end hdlc_deframe_init */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        hdlc_deframe_start
+ *
+ * Purpose:     Get ready for a new frame.
+ *
+ * Description:	Starts out as if preceded by 0 bits, i.e. the end
+ *		of the opening flag.
+ *
+ *--------------------------------------------------------------------*/
+
+void hdlc_deframe_start (struct hdlc_deframe_s *D)
+{
+	D->ones = 0;
+	D->acc = 0;
+	D->alen = 0;
+	D->frame_len = 0;
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        hdlc_deframe_bits
+ *
+ * Purpose:     Process some more data bits.
+ *
+ * Inputs:	D	- State from hdlc_deframe_start.
+ *
+ *		dbits	- Data bits, after undoing NRZI, first in the lsb.
+ *
+ *		nbits	- Number of them, 0 to 32.
+ *
+ * Returns:	HDLC_DEFRAME_MORE if nothing unusual.
+ *		HDLC_DEFRAME_FLAG or HDLC_DEFRAME_ABORT if one of those
+ *		was found.  The state is not useful after that.
+ *
+ * Outputs:	D->frame_buf and D->frame_len get complete octets.
+ *		D->alen is 0 if the frame ends on an octet boundary.
+ *
+ *--------------------------------------------------------------------*/
+
+int hdlc_deframe_bits (struct hdlc_deframe_s *D, uint32_t dbits, int nbits)
+{
+	assert (was_init);
+
+	while (nbits >= 8) {
+	  const struct step_s *s = &step[D->ones][dbits & 0xff];
+
+	  if (s->event != HDLC_DEFRAME_MORE) {
+	    return (s->event);
+	  }
+	  D->acc |= (unsigned int)s->data << D->alen;
+	  D->alen += s->ndata;
+	  D->ones = s->ones;
+
+	  if (D->alen >= 8) {
+	    if (D->frame_len < MAX_FRAME_LEN) {
+	      D->frame_buf[D->frame_len] = D->acc & 0xff;
+	      D->frame_len++;
+	    }
+	    D->acc >>= 8;
+	    D->alen -= 8;
+	  }
+	  dbits >>= 8;
+	  nbits -= 8;
+	}
+
+	for ( ; nbits > 0; nbits--) {
+	  int event = one_bit (D, dbits & 1);
+
+	  if (event != HDLC_DEFRAME_MORE) {
+	    return (event);
+	  }
+	  if (D->alen == 8) {
+	    if (D->frame_len < MAX_FRAME_LEN) {
+	      D->frame_buf[D->frame_len] = D->acc & 0xff;
+	      D->frame_len++;
+	    }
+	    D->acc = 0;
+	    D->alen = 0;
+	  }
+	  dbits >>= 1;
+	}
+	return (HDLC_DEFRAME_MORE);
+
+} /* end hdlc_deframe_bits */
+
+
+
+#if DEFRAMETEST
+
+/*
+ * Compare against the original way of doing it, with an 8 bit
+ * pattern detector, on bits fed in random sized pieces.
+ * Lots of 1 bits so stuffing, flags and aborts show up often.
+ */
+
+#define NUM_BITS 3000
+
+static int reference (unsigned char *dbit, int n, unsigned char *frame_buf, int *frame_len, int *olen)
+{
+	unsigned char pat_det = 0;
+	unsigned char oacc = 0;
+
+	*olen = 0;
+	*frame_len = 0;
+
+	for (int i = 0; i < n; i++) {
+	  pat_det >>= 1;
+	  if (dbit[i]) {
+	    pat_det |= 0x80;
+	    if (pat_det == 0xfe) return (HDLC_DEFRAME_ABORT);
+	    oacc >>= 1;
+	    oacc |= 0x80;
+	  }
+	  else {
+	    if (pat_det == 0x7e) return (HDLC_DEFRAME_FLAG);
+	    if ((pat_det >> 2) == 0x1f) continue;
+	    oacc >>= 1;
+	  }
+	  (*olen)++;
+	  if (*olen & 8) {
+	    *olen = 0;
+	    if (*frame_len < MAX_FRAME_LEN) {
+	      frame_buf[*frame_len] = oacc;
+	      (*frame_len)++;
+	    }
+	  }
+	}
+	return (HDLC_DEFRAME_MORE);
+}
+
+
+int main (int argc, char *argv[])
+{
+	static unsigned char dbit[NUM_BITS];
+	static unsigned char ref_buf[MAX_FRAME_LEN];
+	static struct hdlc_deframe_s D;
+	int errors = 0;
+	int count[3] = { 0, 0, 0 };
+
+	hdlc_deframe_init ();
+	srand (42);
+
+	for (int trial = 0; trial < 20000; trial++) {
+	  int ones_percent = 50 + rand() % 45;
+	  int n = 0;
+
+	  if (trial & 1) {
+	    // Properly stuffed octets, mostly 1 bits, maybe a flag on the end.
+	    int ones = 0;
+	    while (n < NUM_BITS - 20) {
+	      dbit[n++] = (rand() % 100) < ones_percent;
+	      ones = dbit[n-1] ? ones + 1 : 0;
+	      if (ones == 5) {
+	        dbit[n++] = 0;
+	        ones = 0;
+	      }
+	      if (rand() % 1000 == 0) break;
+	    }
+	    if (trial & 2) {
+	      static const unsigned char flag[8] = { 0, 1, 1, 1, 1, 1, 1, 0 };
+	      memcpy (dbit + n, flag, 8);
+	      n += 8;
+	    }
+	  }
+	  else {
+	    n = rand() % NUM_BITS;
+	    for (int i = 0; i < n; i++) {
+	      dbit[i] = (rand() % 100) < ones_percent;
+	    }
+	  }
+
+	  int ref_len, ref_olen;
+	  int ref_event = reference (dbit, n, ref_buf, &ref_len, &ref_olen);
+	  count[ref_event]++;
+
+	  hdlc_deframe_start (&D);
+	  int event = HDLC_DEFRAME_MORE;
+	  for (int i = 0; i < n && event == HDLC_DEFRAME_MORE; ) {
+	    int nbits = 1 + rand() % 32;
+	    uint32_t w = 0;
+	    if (nbits > n - i) nbits = n - i;
+	    for (int b = 0; b < nbits; b++) {
+	      w |= (uint32_t)dbit[i + b] << b;
+	    }
+	    event = hdlc_deframe_bits (&D, w, nbits);
+	    i += nbits;
+	  }
+
+	  if (event != ref_event) {
+	    errors++;
+	  }
+	  else if (event == HDLC_DEFRAME_MORE &&
+		(D.frame_len != ref_len || D.alen != ref_olen || memcmp (D.frame_buf, ref_buf, ref_len) != 0)) {
+	    errors++;
+	  }
+	}
+
+	if (errors) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("\nHDLC deframe test FAILED.  %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+	text_color_set(DW_COLOR_REC);
+	dw_printf ("\nHDLC deframe test - PASSED.  %d more, %d flag, %d abort.\n", count[0], count[1], count[2]);
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
+/* end hdlc_deframe.c */
@@ -0,0 +1,48 @@
+/* hdlc_deframe.h */
+
+#ifndef HDLC_DEFRAME_H
+#define HDLC_DEFRAME_H 1
+
+
+/*
+ * Remove bit stuffing and find flag / abort patterns, 8 data bits at a time.
+ * Input is after NRZI and any descrambling have been undone.
+ * See hdlc_deframe.c for details.
+ */
+
+#include <stdint.h>
+
+#include "ax25_pad.h"		/* for AX25_MAX_PACKET_LEN */
+#include "rrbb.h"		/* for MAX_FRAME_LEN */
+
+
+#define HDLC_DEFRAME_MORE 0	// Keep going.
+#define HDLC_DEFRAME_FLAG 1	// 01111110 found.
+#define HDLC_DEFRAME_ABORT 2	// Seven 1 bits in a row.
+
+struct hdlc_deframe_s {
+
+	int ones;			/* Number of 1 bits in a row, 0 to 6. */
+
+	unsigned int acc;		/* Data bits not yet making an octet. */
+					/* First received in the lsb. */
+
+	int alen;			/* Number of bits in acc, 0 to 7. */
+
+	unsigned char frame_buf[MAX_FRAME_LEN];
+
+	int frame_len;			/* Number of octets in frame_buf. */
+					/* Anything beyond MAX_FRAME_LEN is dropped. */
+};
+
+
+void hdlc_deframe_init (void);
+
+void hdlc_deframe_start (struct hdlc_deframe_s *D);
+
+int hdlc_deframe_bits (struct hdlc_deframe_s *D, uint32_t dbits, int nbits);
+
+
+#endif
+
+/* end hdlc_deframe.h */
@@ -30,6 +30,7 @@
 #include "direwolf.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <stdint.h>          // uint64_t
@@ -47,6 +48,7 @@
 #include "ptt.h"
 #include "fx25.h"
 #include "il2p.h"
+#include "rx_stats.h"
 
 
 //#define TEST 1				/* Define for unit testing. */
@@ -120,6 +122,9 @@ static int num_subchan[MAX_CHANS];		//TODO1.2 use ptr rather than copy.
 
 static int composite_dcd[MAX_CHANS][MAX_SUBCHANS+1];
 
+static dw_mutex_t dcd_mutex;		// Demodulators for a channel could be
+					// running in different threads.
+
 
 /***********************************************************************************
  *
@@ -148,6 +153,9 @@ void hdlc_rec_init (struct audio_s *pa)
 	g_audio_p = pa;
 
 	memset (composite_dcd, 0, sizeof(composite_dcd));
+	if ( ! was_init) {
+	  dw_mutex_init (&dcd_mutex);
+	}
 
 	for (ch = 0; ch < MAX_CHANS; ch++)
 	{
@@ -418,8 +426,9 @@ a good modem here and providing a result when it is received.
  *	
  *		is_scrambled - Is the data scrambled?
  *
- *		descram_state - Current descrambler state.  (not used - remove)
- *				Not so fast - plans to add new parameter.  PSK already provides it.
+ *		quality	- How sure the demodulator is about the bit, 0 to 100.
+ *			  Kept with the raw bits so fix up attempts can
+ *			  try the least confident ones first.
  *					
  *
  * Description:	This is called once for each received bit.
@@ -428,7 +437,7 @@ a good modem here and providing a result when it is received.
  *
  ***********************************************************************************/
 
-void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled, int not_used_remove)
+void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled, int quality)
 {
 
 	int dbit;			/* Data bit after undoing NRZI. */
@@ -460,7 +469,7 @@ void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled,
 // EAS does not use HDLC.
 
 	if (g_audio_p->achan[chan].modem_type == MODEM_EAS) {
-	  eas_rec_bit (chan, subchan, slice, raw, not_used_remove);
+	  eas_rec_bit (chan, subchan, slice, raw, quality);
 	  return;
 	}
 
@@ -496,8 +505,8 @@ void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled,
 // Don't waste time on this if AIS.  EAS does not get this far.
 
 	if (g_audio_p->achan[chan].modem_type != MODEM_AIS) {
-	  fx25_rec_bit (chan, subchan, slice, dbit);
-	  il2p_rec_bit (chan, subchan, slice, raw);	// Note: skip NRZI.
+	  fx25_rec_bit (chan, subchan, slice, dbit, quality);
+	  il2p_rec_bit (chan, subchan, slice, raw, quality);	// Note: skip NRZI.
 	}
 
 /*
@@ -514,11 +523,12 @@ void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled,
 	  H->flag4_det |= 0x80000000;
 	}
 
-	rrbb_append_bit (H->rrbb, raw);
+	rrbb_append_bit (H->rrbb, raw, quality);
 
 	if (H->pat_det == 0x7e) {
 
 	  rrbb_chop8 (H->rrbb);
+	  rx_stats_add (&(rx_stats_slice(chan, subchan, slice)->flags), 1);
 
 /*
  * The special pattern 01111110 indicates beginning and ending of a frame.  
@@ -592,6 +602,8 @@ void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled,
 		
 	    alevel_t alevel = demod_get_audio_level (chan, subchan);
 
+	    rx_stats_add (&(rx_stats_slice(chan, subchan, slice)->blocks), 1);
+
 	    rrbb_set_audio_level (H->rrbb, alevel);
 	    hdlc_rec2_block (H->rrbb);
 	    	/* Now owned by someone else who will free it. */
@@ -606,7 +618,7 @@ void hdlc_rec_bit (int chan, int subchan, int slice, int raw, int is_scrambled,
 	  H->frame_len = 0;
 
 
-	  rrbb_append_bit (H->rrbb, H->prev_raw); /* Last bit of flag.  Needed to get first data bit. */
+	  rrbb_append_bit (H->rrbb, H->prev_raw, 100); /* Last bit of flag.  Needed to get first data bit. */
 						/* Now that we are saving other initial state information, */
 						/* it would be sensible to do the same for this instead */
 						/* of lumping it in with the frame data bits. */
@@ -740,6 +752,8 @@ void dcd_change (int chan, int subchan, int slice, int state)
 	dw_printf ("DCD %d.%d.%d = %d \n", chan, subchan, slice, state);
 #endif
 
+	dw_mutex_lock (&dcd_mutex);
+
 	old = hdlc_rec_data_detect_any(chan);
 
 	if (state) {
@@ -754,6 +768,8 @@ void dcd_change (int chan, int subchan, int slice, int state)
 	if (new != old) {
 	  ptt_set (OCTYPE_DCD, chan, new);
 	}
+
+	dw_mutex_unlock (&dcd_mutex);
 }
 
 
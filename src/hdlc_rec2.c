@@ -88,6 +88,7 @@
 #include "direwolf.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <ctype.h>
 #include <string.h>
@@ -100,11 +101,14 @@
 #include "ax25_pad.h"
 #include "rrbb.h"
 #include "multi_modem.h"
+#include "fix_pool.h"
+#include "hdlc_deframe.h"
 #include "dtime_now.h"
 #include "demod_9600.h"		/* for descramble() */
 #include "audio.h"		/* for struct audio_s */
 //#include "ax25_pad.h"		/* for AX25_MAX_ADDR_LEN */
 #include "ais.h"
+#include "rx_stats.h"
 
 //#define DEBUG 1
 //#define DEBUGx 1
@@ -139,36 +143,18 @@ static struct audio_s          *save_audio_config_p;
 
 struct hdlc_state2_s {
 
-	int prev_raw;			/* Keep track of previous bit so */
-					/* we can look for transitions. */
-					/* Should be only 0 or 1. */
-
 	int is_scrambled;		/* Set for 9600 baud. */
 	int lfsr;			/* Descrambler shift register for 9600 baud. */
 	int prev_descram;		/* Previous unscrambled for 9600 baud. */
 
-
-	unsigned char pat_det; 		/* 8 bit pattern detector shift register. */
-					/* See below for more details. */
-
-	unsigned char oacc;		/* Accumulator for building up an octet. */
-
-	int olen;			/* Number of bits in oacc. */
-					/* When this reaches 8, oacc is copied */
-					/* to the frame buffer and olen is zeroed. */
-
-	unsigned char frame_buf[MAX_FRAME_LEN];
-					/* One frame is kept here. */
-
-	int frame_len;			/* Number of octets in frame_buf. */
-					/* Should be in range of 0 .. MAX_FRAME_LEN. */
+	struct hdlc_deframe_s D;	/* Bit unstuffing and the frame being built. */
 
 };
 
 
-static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, retry_conf_t retry_conf, int passall);
+static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, retry_conf_t retry_conf, int passall, struct fix_job_s *job);
 
-static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel);
+static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, struct fix_job_s *job);
 
 static int sanity_check (unsigned char *buf, int blen, retry_t bits_flipped, enum sanity_e sanity_test);
 
@@ -199,12 +185,14 @@ static int sanity_check (unsigned char *buf, int blen, retry_t bits_flipped, enu
  *					all fixup attempts.
  *
  * Description:	Save pointer to configuration for later use.
+ *		Build the table for removing bit stuffing.
  *
  ***********************************************************************************/
 
 void hdlc_rec2_init (struct audio_s *p_audio_config)
 {
 	save_audio_config_p = p_audio_config;
+	hdlc_deframe_init ();
 }
 
 
@@ -262,7 +250,7 @@ void hdlc_rec2_block (rrbb_t block)
 	retry_cfg.u_bits.contig.nr_bits = 0;
 	retry_cfg.u_bits.contig.bit_idx = 0;
 
-	ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, passall & (fix_bits == RETRY_NONE));
+	ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, passall & (fix_bits == RETRY_NONE), NULL);
 	if (ok) {
 #if DEBUG
 	  text_color_set(DW_COLOR_INFO);
@@ -275,8 +263,19 @@ void hdlc_rec2_block (rrbb_t block)
 /*
  * Not successful with frame in original form.
  * See if we can "fix" it.
+ * Let a worker thread do it, if available, so we don't hold up the audio.
  */
-	if (try_to_fix_quick_now (block, chan, subchan, slice, alevel)) {
+	rx_stats_add (&(rx_stats_slice(chan, subchan, slice)->fcs_fail), 1);
+
+	if (fix_bits >= RETRY_INVERT_SINGLE && fix_pool_submit (block, multi_modem_clock (chan, subchan))) {
+	  return;	/* Pool owns it now. */
+	}
+
+	uint64_t start = rx_stats_clock();
+	ok = try_to_fix_quick_now (block, chan, subchan, slice, alevel, NULL);
+	rx_stats_time (chan, RX_STAGE_FIX, start);
+
+	if (ok) {
 	  rrbb_delete (block);
 	  return;
 	}
@@ -286,7 +285,7 @@ void hdlc_rec2_block (rrbb_t block)
 	  /* Exhausted all desired fix up attempts. */
 	  /* Let thru even with bad CRC.  Of course, it still */
 	  /* needs to be a minimum number of whole octets. */
-	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 1);
+	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 1, NULL);
 	  rrbb_delete (block);
 	}
 	else {  
@@ -296,6 +295,387 @@ void hdlc_rec2_block (rrbb_t block)
 } /* end hdlc_rec2_block */
 
 
+/***********************************************************************************
+ *
+ * Quick screening of fix up attempts.
+ *
+ * try_decode goes thru the whole frame every time:  undo the NRZI
+ * (and scrambling), remove the stuffed bits, then calculate the FCS.
+ * Doing that once for each bit position is order N squared.
+ * For two separated bits it is order N cubed and gets very slow.
+ *
+ * Nearly all attempts fail and we can find that out much faster.
+ * The original frame is decoded once, and for each bit position we keep:
+ *
+ *	- the data bit, after NRZI and descrambling,
+ *	- whether it is kept, removed by bit stuffing, or completes a flag or abort,
+ *	- the CRC register before that position,
+ *	- the CRC register needed before that position to end up with a good FCS.
+ *
+ * The last one is found by running the CRC backwards from the value it
+ * has after a frame with a correct FCS.  This works because each step
+ * of the CRC calculation can be undone.
+ *
+ * Inverting one received bit changes only a few data bits:  two because of
+ * NRZI, six when descrambling is also involved.  The bit stuffing decision
+ * depends on the previous 7 data bits so we redo the part from the first
+ * change to 8 past the last change.  Everything before and after is the
+ * same as the original so we already have the CRC at both ends.
+ * That also takes care of the cases where bit stuffing changes and the
+ * rest of the frame is shifted by a bit.
+ *
+ * This is only a filter.  When the CRC comes out right, try_decode
+ * does the real thing, including the sanity checks, so the results
+ * are exactly the same as before.
+ *
+ ***********************************************************************************/
+
+#define FCS_GOOD 0xf0b8		/* CRC register after data and correct FCS. */
+#define CRC_POLY 0x8408		/* Same as table in fcs_calc.c, a bit at a time. */
+
+#define BIT_KEEP 0
+#define BIT_STUFF 1		/* Removed by bit stuffing. */
+#define BIT_FLAG 2		/* End of flag or abort.  try_decode gives up. */
+
+#define MAX_CHANGES 24		/* Data bits changed by inverting 3 received bits. */
+
+
+struct quick_s {
+	int blen;			/* Number of bits in block. */
+	int is_scrambled;
+
+	unsigned char dbit[MAX_NUM_BITS];	/* Data bit for each position from 1 to blen-1. */
+	unsigned char what[MAX_NUM_BITS];	/* BIT_KEEP, BIT_STUFF, or BIT_FLAG. */
+
+	/* Following are for the state before each position, 1 thru blen. */
+
+	unsigned short reg[MAX_NUM_BITS+1];	/* CRC register. */
+	unsigned short need[MAX_NUM_BITS+1];	/* CRC register needed for good FCS at end. */
+	short kept[MAX_NUM_BITS+1];		/* Number of data bits kept so far. */
+	short flags[MAX_NUM_BITS+1];		/* Number of flags or aborts so far. */
+};
+
+
+static inline unsigned short crc_bit (unsigned short reg, int bit)
+{
+	return (((reg ^ bit) & 1) ? (reg >> 1) ^ CRC_POLY : reg >> 1);
+}
+
+static inline unsigned short crc_bit_undo (unsigned short reg, int bit)
+{
+	// The shift right always clears the top bit and CRC_POLY has it set.
+	// That tells us which it was.
+
+	if (reg & 0x8000) {
+	  reg = ((reg ^ CRC_POLY) << 1) | 1;
+	}
+	else {
+	  reg = reg << 1;
+	}
+	return (reg ^ bit);
+}
+
+/* Same tests as try_decode.  pat has most recent data bit in the MSB. */
+
+static inline int bit_what (int pat)
+{
+	if (pat & 0x80) {
+	  return (pat == 0xfe ? BIT_FLAG : BIT_KEEP);
+	}
+	if (pat == 0x7e) return (BIT_FLAG);
+	if ((pat >> 2) == 0x1f) return (BIT_STUFF);
+	return (BIT_KEEP);
+}
+
+
+/*
+ * Decode the original block once.
+ */
+
+static void quick_init (struct quick_s *Q, rrbb_t block)
+{
+	int blen = rrbb_get_len(block);
+	int prev_raw = rrbb_get_bit (block, 0);
+	int lfsr = rrbb_get_descram_state (block);
+	int prev_descram = rrbb_get_prev_descram (block);
+	int pat = 0;
+	unsigned short reg = 0xffff;
+	int kept = 0;
+	int flags = 0;
+	int q;
+
+	Q->blen = blen;
+	Q->is_scrambled = rrbb_get_is_scrambled (block);
+
+	for (q = 1; q < blen; q++) {
+	  int raw = rrbb_get_bit (block, q);
+	  int dbit;
+
+	  if (Q->is_scrambled) {
+	    int descram = descramble(raw, &lfsr);
+	    dbit = (descram == prev_descram);
+	    prev_descram = descram;
+	  }
+	  else {
+	    dbit = (raw == prev_raw);
+	    prev_raw = raw;
+	  }
+
+	  Q->reg[q] = reg;
+	  Q->kept[q] = kept;
+	  Q->flags[q] = flags;
+
+	  pat = (pat >> 1) | (dbit << 7);
+	  Q->dbit[q] = dbit;
+	  Q->what[q] = bit_what(pat);
+
+	  if (Q->what[q] == BIT_KEEP) {
+	    reg = crc_bit (reg, dbit);
+	    kept++;
+	  }
+	  else if (Q->what[q] == BIT_FLAG) {
+	    flags++;
+	  }
+	}
+
+	Q->reg[blen] = reg;
+	Q->kept[blen] = kept;
+	Q->flags[blen] = flags;
+
+	Q->need[blen] = FCS_GOOD;
+	for (q = blen - 1; q >= 1; q--) {
+	  if (Q->what[q] == BIT_KEEP) {
+	    Q->need[q] = crc_bit_undo (Q->need[q+1], Q->dbit[q]);
+	  }
+	  else {
+	    Q->need[q] = Q->need[q+1];
+	  }
+	}
+}
+
+
+/*
+ * Add data bit position to list of changes.
+ * If already there, the two changes cancel out.
+ */
+
+static inline int toggle_change (int *list, int n, int pos)
+{
+	int k;
+
+	for (k = 0; k < n; k++) {
+	  if (list[k] == pos) {
+	    list[k] = list[n-1];
+	    return (n - 1);
+	  }
+	}
+	assert (n < MAX_CHANGES);
+	list[n] = pos;
+	return (n + 1);
+}
+
+
+/*
+ * Add the data bits which change when received bit r is inverted.
+ * Returns new number in list.
+ */
+
+static int quick_changes (struct quick_s *Q, int r, int *list, int n)
+{
+	if (Q->is_scrambled) {
+
+	  // Descrambler output depends on the input now, 12 bits ago, and 17 bits ago.
+	  // Bit 0 is used only for NRZI which doesn't apply here.
+
+	  static const int tap[3] = { 0, 12, 17 };
+	  int t;
+
+	  if (r == 0) return (n);
+
+	  for (t = 0; t < 3; t++) {
+	    int k = r + tap[t];
+	    if (k < Q->blen) n = toggle_change (list, n, k);
+	    if (k + 1 < Q->blen) n = toggle_change (list, n, k + 1);
+	  }
+	}
+	else {
+	  // With NRZI, the data bit depends on this and the previous received bit.
+
+	  if (r >= 1) n = toggle_change (list, n, r);
+	  if (r + 1 < Q->blen) n = toggle_change (list, n, r + 1);
+	}
+	return (n);
+}
+
+
+static void apply_changes (struct quick_s *Q, int *list, int n)
+{
+	int k;
+
+	for (k = 0; k < n; k++) {
+	  Q->dbit[list[k]] ^= 1;
+	}
+}
+
+
+/*
+ * Decode data bits from position a up to b, with changes applied,
+ * starting with the CRC register in *reg.
+ * Returns 0 if a flag or abort is found.  Otherwise the new CRC
+ * register and number of kept data bits are returned.
+ */
+
+static int quick_region (struct quick_s *Q, int a, int b, unsigned short *reg, int *kept)
+{
+	int pat = 0;
+	int q;
+
+	for (q = a - 7; q < a; q++) {
+	  pat >>= 1;
+	  if (q >= 1 && Q->dbit[q]) pat |= 0x80;
+	}
+
+	*kept = 0;
+	for (q = a; q < b; q++) {
+	  pat = (pat >> 1) | (Q->dbit[q] << 7);
+	  switch (bit_what(pat)) {
+	    case BIT_KEEP:
+	      *reg = crc_bit (*reg, Q->dbit[q]);
+	      (*kept)++;
+	      break;
+	    case BIT_FLAG:
+	      return (0);
+	    default:
+	      break;
+	  }
+	}
+	return (1);
+}
+
+
+/*
+ * Final checks after the last changed region has been redone.
+ *	total	- Number of data bits kept in the whole frame.
+ *	end	- Position after the last changed region.
+ *	miss	- CRC register at end of that region xor the one needed there.
+ * Returns 1 if try_decode might succeed.
+ */
+
+static int quick_result (struct quick_s *Q, int total, int end, unsigned short miss)
+{
+	if (Q->flags[Q->blen] - Q->flags[end] > 0) return (0);
+
+	if (total % 8 != 0 || total < MIN_FRAME_LEN * 8) return (0);
+
+	if (total > MAX_FRAME_LEN * 8) return (1);	// try_decode would chop it off.  Let it decide.
+
+	return (miss == 0);
+}
+
+
+/*
+ * Check one attempt with the data bits in list changed.
+ * The changes are all done as one region so they should be near each other.
+ * Returns 0 if it can't succeed.
+ */
+
+static int quick_check (struct quick_s *Q, int *list, int n)
+{
+	int first, last, end, kept, k, ok;
+	unsigned short reg;
+
+	if (n == 0) return (0);		// Same as original which failed.
+
+	first = last = list[0];
+	for (k = 1; k < n; k++) {
+	  if (list[k] < first) first = list[k];
+	  if (list[k] > last) last = list[k];
+	}
+	end = last + 8;
+	if (end > Q->blen) end = Q->blen;
+
+	if (Q->flags[first] > 0) return (0);
+
+	reg = Q->reg[first];
+	apply_changes (Q, list, n);
+	ok = quick_region (Q, first, end, &reg, &kept);
+	apply_changes (Q, list, n);
+	if ( ! ok) return (0);
+
+	return (quick_result (Q, Q->kept[first] + kept + Q->kept[Q->blen] - Q->kept[end], end, reg ^ Q->need[end]));
+}
+
+
+/*
+ * Order of fix up attempts.
+ *
+ * The demodulator tells us how sure it is about each bit.  An error is
+ * much more likely where the signal was close to the slicing threshold,
+ * so those are tried first.  score is the sum of the quality for the
+ * bits to be inverted.  A counting sort keeps the original order for
+ * equal scores, so we get the old left to right order when there is
+ * no useful quality information.
+ *
+ * Returns 1 if the scores were not all the same.
+ */
+
+#define MAX_SCORE 300		/* Three bits with quality of 100. */
+
+#define SOFT_CANDIDATES 16	/* For two separated bits, at least one of them */
+				/* must be among this many of the least confident. */
+
+static int order_by_score (int *score, int n, int *order)
+{
+	int count[MAX_SCORE+2];
+	int k, differ;
+
+	memset (count, 0, sizeof(count));
+	differ = 0;
+	for (k = 0; k < n; k++) {
+	  assert (score[k] >= 0 && score[k] <= MAX_SCORE);
+	  count[score[k]+1]++;
+	  if (k > 0 && score[k] != score[k-1]) differ = 1;
+	}
+	for (k = 1; k <= MAX_SCORE; k++) {
+	  count[k] += count[k-1];
+	}
+	for (k = 0; k < n; k++) {
+	  order[count[score[k]]++] = k;
+	}
+	return (differ);
+}
+
+
+/*
+ * Scratch space for try_to_fix_quick_now.  Several hundred KB, too
+ * much for the stack of a worker thread, which could be as small as
+ * 128 KB with musl.  Each thread which needs it gets its own, allocated
+ * the first time.  The threads last until the application exits.
+ */
+
+struct fix_scratch_s {
+	struct quick_s Q;
+	int score[MAX_NUM_BITS];
+	int order[MAX_NUM_BITS];
+	unsigned char done[MAX_NUM_BITS];
+};
+
+static __thread struct fix_scratch_s *fix_scratch = NULL;
+
+static struct fix_scratch_s *get_fix_scratch (void)
+{
+	if (fix_scratch == NULL) {
+	  fix_scratch = malloc (sizeof (struct fix_scratch_s));
+	  if (fix_scratch == NULL) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("FATAL ERROR: Out of memory.\n");
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	return (fix_scratch);
+}
+
+
 /***********************************************************************************
  *
  * Name:	try_to_fix_quick_now
@@ -306,6 +686,8 @@ void hdlc_rec2_block (rrbb_t block)
  *		chan	- Radio channel from which it was received.
  *		subchan	- Which demodulator when more than one per channel.
  *		alevel	- Audio level for later reporting.
+ *		job	- NULL, or where to put the result when running in
+ *			  a worker thread.  See fix_pool.c.
  *
  * Global In:	configuration fix_bits - Maximum level of fix up to attempt.
  *
@@ -331,14 +713,28 @@ void hdlc_rec2_block (rrbb_t block)
  *		The separated bit case is now handled immediately instead of
  *		being thrown in a queue for later processing.
  *
+ *		Bits are tried in order of increasing quality from the demodulator.
+ *		When quality is available, the two separated bit case is limited to
+ *		pairs from the least confident bits so the time is bounded.
+ *
  ***********************************************************************************/
 
-static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel)
+static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, struct fix_job_s *job)
 {
 	int ok;
 	int len, i;
 	retry_t fix_bits = save_audio_config_p->achan[chan].fix_bits;
 	//int passall = save_audio_config_p->achan[chan].passall;
+	struct fix_scratch_s *S = get_fix_scratch ();
+	struct quick_s *Q = &(S->Q);
+	int list[MAX_CHANGES];
+	int n;
+	int *score = S->score;
+	int *order = S->order;
+	int single[SOFT_CANDIDATES];
+	int nsingle;
+	int soft;
+	int k;
 
 
 	len = rrbb_get_len(block);
@@ -358,15 +754,32 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 
 	  return 0;	/* failure. */
 	}
+
+	quick_init (Q, block);
+
 	/* Try to swap one bit */
 	retry_cfg.type = RETRY_TYPE_SWAP;
 	retry_cfg.retry = RETRY_INVERT_SINGLE;
 	retry_cfg.u_bits.contig.nr_bits = 1;
 
 	for (i=0; i<len; i++) {
+	  score[i] = rrbb_get_quality (block, i);
+	}
+	soft = order_by_score (score, len, order);
+
+	// Remember the least confident for the separated bit case.
+
+	nsingle = len < SOFT_CANDIDATES ? len : SOFT_CANDIDATES;
+	memcpy (single, order, nsingle * sizeof(int));
+
+	for (k=0; k<len; k++) {
+	  i = order[k];
+	  n = quick_changes (Q, i, list, 0);
+	  if ( ! quick_check (Q, list, n)) continue;
+
 	  /* Set the index of the bit to swap */
 	  retry_cfg.u_bits.contig.bit_idx = i;
-	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0);
+	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0, job);
 	  if (ok) {
 #if DEBUG
 	    text_color_set(DW_COLOR_ERROR);
@@ -379,17 +792,26 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 /* 
  * Try inverting two adjacent bits.
  */
-	if (fix_bits < RETRY_INVERT_DOUBLE) {
+	if (fix_bits < RETRY_INVERT_DOUBLE || (job != NULL && fix_pool_cancelled(job))) {
 	  return 0;
 	}
 	/* Try to swap two contiguous bits */
 	retry_cfg.retry = RETRY_INVERT_DOUBLE;
 	retry_cfg.u_bits.contig.nr_bits = 2;
 
-
 	for (i=0; i<len-1; i++) {
+	  score[i] = rrbb_get_quality (block, i) + rrbb_get_quality (block, i+1);
+	}
+	order_by_score (score, len-1, order);
+
+	for (k=0; k<len-1; k++) {
+	  i = order[k];
+	  n = quick_changes (Q, i, list, 0);
+	  n = quick_changes (Q, i+1, list, n);
+	  if ( ! quick_check (Q, list, n)) continue;
+
 	  retry_cfg.u_bits.contig.bit_idx = i;
-	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0);
+	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0, job);
 	  if (ok) {
 #if DEBUG
 	    text_color_set(DW_COLOR_ERROR);
@@ -402,7 +824,7 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 /*
  * Try inverting adjacent three bits.
  */
-	if (fix_bits < RETRY_INVERT_TRIPLE) {
+	if (fix_bits < RETRY_INVERT_TRIPLE || (job != NULL && fix_pool_cancelled(job))) {
 	  return 0;
 	}
 	/* Try to swap three contiguous bits */
@@ -410,8 +832,19 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 	retry_cfg.u_bits.contig.nr_bits = 3;
 
 	for (i=0; i<len-2; i++) {
+	  score[i] = rrbb_get_quality (block, i) + rrbb_get_quality (block, i+1) + rrbb_get_quality (block, i+2);
+	}
+	order_by_score (score, len-2, order);
+
+	for (k=0; k<len-2; k++) {
+	  i = order[k];
+	  n = quick_changes (Q, i, list, 0);
+	  n = quick_changes (Q, i+1, list, n);
+	  n = quick_changes (Q, i+2, list, n);
+	  if ( ! quick_check (Q, list, n)) continue;
+
 	  retry_cfg.u_bits.contig.bit_idx = i;
-	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0);
+	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0, job);
 	  if (ok) {
 #if DEBUG
 	    text_color_set(DW_COLOR_ERROR);
@@ -427,8 +860,20 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
  * It chews up a lot of CPU time.  Usual test takes 4 times longer to run.
  *
  * Processing time is order N squared so time goes up rapidly with larger frames.
+ *
+ * When the two are far enough apart, the changed regions are done separately.
+ * The first one is done once for each i.  The CRC register is then off by
+ * some amount from the original.  That difference is carried along, thru the
+ * unchanged bits, as j advances.  It is linear so we don't care what the
+ * actual bits are, only how many are kept.
+ *
+ * With quality information from the demodulator, i is limited to the
+ * least confident bits, and it is paired with every other bit, before and
+ * after.  For those before, we work backwards from the difference needed
+ * at the start of the i region.  It is quite common for only one of the
+ * two bad bits to look doubtful so we don't restrict both of them.
  */
-	if (fix_bits < RETRY_INVERT_TWO_SEP) {
+	if (fix_bits < RETRY_INVERT_TWO_SEP || (job != NULL && fix_pool_cancelled(job))) {
 	  return 0;
 	}
 
@@ -442,26 +887,196 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 	dw_printf ("*** Try flipping TWO SEPARATED BITS %d bits\n", len);
 #endif
 	len = rrbb_get_len(block);
-	for (i=0; i<len-2; i++) {
-	  retry_cfg.u_bits.sep.bit_idx_a = i;
+
+	int nanchor = soft ? nsingle : len - 2;
+	unsigned char *done = S->done;
+
+	memset (done, 0, len);
+
+	for (k=0; k<nanchor; k++) {
+
+	  if (job != NULL && fix_pool_cancelled(job)) {
+	    return 0;		/* Out of time. */
+	  }
+
+	  i = soft ? single[k] : k;
 	  int j;
+	  int list_i[MAX_CHANGES];
+	  int n_i, first_i, end_i, kept_i, ok_i, m;
+	  unsigned short reg_i, diff;
+	  int q;
+
+	  /* Region changed by inverting bit i alone. */
+
+	  n_i = quick_changes (Q, i, list_i, 0);
+	  first_i = len;
+	  end_i = 0;
+	  for (m = 0; m < n_i; m++) {
+	    if (list_i[m] < first_i) first_i = list_i[m];
+	    if (list_i[m] + 8 > end_i) end_i = list_i[m] + 8;
+	  }
+	  if (end_i > len) end_i = len;
+
+	  ok_i = 0;
+	  diff = 0;
+	  kept_i = 0;
+	  reg_i = 0;
+	  if (n_i > 0) {
+	    reg_i = Q->reg[first_i];
+	    apply_changes (Q, list_i, n_i);
+	    ok_i = quick_region (Q, first_i, end_i, &reg_i, &kept_i);
+	    apply_changes (Q, list_i, n_i);
+	    diff = reg_i ^ Q->reg[end_i];
+	  }
+	  q = end_i;
+
+	  /* Second bit after i. */
 
+	  retry_cfg.u_bits.sep.bit_idx_a = i;
 	  ok = 0;
 	  for (j=i+2; j<len; j++) {
+
+	    if (done[j]) continue;		// Already tried as i.
+
+	    if (n_i == 0 || j < end_i) {
+
+	      // Too close.  Do it all as one region.
+
+	      memcpy (list, list_i, n_i * sizeof(int));
+	      n = quick_changes (Q, j, list, n_i);
+	      if ( ! quick_check (Q, list, n)) continue;
+	    }
+	    else {
+	      int end_j, kept_j;
+	      unsigned short reg_j;
+
+	      // Nothing after can fix a flag in or before the first region.
+
+	      if ( ! ok_i || Q->flags[first_i] > 0) break;
+
+	      // Carry the CRC difference along to the start of the second region.
+
+	      while (q < j) {
+	        if (Q->what[q] == BIT_KEEP) {
+	          diff = crc_bit (diff, 0);
+	        }
+	        else if (Q->what[q] == BIT_FLAG) {
+	          break;
+	        }
+	        q++;
+	      }
+	      if (q < j) break;		// Flag between the two regions.
+
+	      n = quick_changes (Q, j, list, 0);
+	      if (n == 0) continue;
+	      end_j = list[0];
+	      for (m = 1; m < n; m++) {
+	        if (list[m] > end_j) end_j = list[m];
+	      }
+	      end_j += 8;
+	      if (end_j > len) end_j = len;
+
+	      reg_j = Q->reg[j] ^ diff;
+	      apply_changes (Q, list, n);
+	      int ok_j = quick_region (Q, j, end_j, &reg_j, &kept_j);
+	      apply_changes (Q, list, n);
+	      if ( ! ok_j) continue;
+
+	      if ( ! quick_result (Q, Q->kept[first_i] + kept_i + Q->kept[j] - Q->kept[end_i] + kept_j + Q->kept[len] - Q->kept[end_j],
+					end_j, reg_j ^ Q->need[end_j])) continue;
+	    }
+
 	    retry_cfg.u_bits.sep.bit_idx_b = j;
-	    ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0);
+	    ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0, job);
 	    if (ok) {
 	      break;
 	    }
+	  }
+
+	  /* Second bit before i.  Not needed when every bit gets a turn as i. */
+
+	  if ( ! ok && soft && n_i > 0) {
+	    unsigned short req;
+
+	    // Difference needed at the start of region i.
+	    // Region i passes a difference thru like kept_i zero bits.
+
+	    req = reg_i ^ Q->need[end_i];
+	    for (m = 0; m < kept_i; m++) {
+	      req = crc_bit_undo (req, 0);
+	    }
+	    q = first_i;
+
+	    retry_cfg.u_bits.sep.bit_idx_b = i;
+	    for (j=i-2; j>=0; j--) {
+	      int first_j, end_j, kept_j;
+	      unsigned short reg_j;
+
+	      if (done[j]) continue;
+
+	      n = quick_changes (Q, j, list, 0);
+	      if (n == 0) continue;
+	      first_j = end_j = list[0];
+	      for (m = 1; m < n; m++) {
+	        if (list[m] < first_j) first_j = list[m];
+	        if (list[m] > end_j) end_j = list[m];
+	      }
+	      end_j += 8;
+
+	      if (end_j > first_i) {
+
+	        // Too close.  Do it all as one region.
+
+	        for (m = 0; m < n_i; m++) {
+	          n = toggle_change (list, n, list_i[m]);
+	        }
+	        if ( ! quick_check (Q, list, n)) continue;
+	      }
+	      else {
+	        if ( ! ok_i) break;		// Flag in region i can't be fixed from far away.
+
+	        // Needed difference, backwards to the end of region j.
+
+	        while (q > end_j) {
+	          q--;
+	          if (Q->what[q] == BIT_KEEP) {
+	            req = crc_bit_undo (req, 0);
+	          }
+	          else if (Q->what[q] == BIT_FLAG) {
+	            break;
+	          }
+	        }
+	        if (q > end_j || Q->what[q] == BIT_FLAG) break;	// Flag between the two regions.
+
+	        if (Q->flags[first_j] > 0) continue;
+
+	        reg_j = Q->reg[first_j];
+	        apply_changes (Q, list, n);
+	        int ok_j = quick_region (Q, first_j, end_j, &reg_j, &kept_j);
+	        apply_changes (Q, list, n);
+	        if ( ! ok_j) continue;
+
+	        if ( ! quick_result (Q, Q->kept[first_j] + kept_j + Q->kept[first_i] - Q->kept[end_j] + kept_i + Q->kept[len] - Q->kept[end_i],
+					end_i, reg_j ^ Q->reg[end_j] ^ req)) continue;
+	      }
+
+	      retry_cfg.u_bits.sep.bit_idx_a = j;
+	      ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, 0, job);
+	      if (ok) {
+	        break;
+	      }
+	    }
+	  }
 
-	  }	  
 	  if (ok) {
 #if DEBUG
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("*** Success by flipping TWO SEPARATED bits %d and %d of %d \n", i, j, len);
+	    dw_printf ("*** Success by flipping TWO SEPARATED bits %d and %d of %d \n",
+			retry_cfg.u_bits.sep.bit_idx_a, retry_cfg.u_bits.sep.bit_idx_b, len);
 #endif
 	    return (1);
 	  }
+	  done[i] = 1;
 	}
 
 	return 0;
@@ -469,45 +1084,48 @@ static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int slice,
 
 
 
-// TODO:  Remove this.  but first figure out what to do in atest.c
-
-
+/***********************************************************************************
+ *
+ * Name:	hdlc_rec2_fix_job
+ *
+ * Purpose:	Same fix up attempts as hdlc_rec2_block, from a worker thread.
+ *
+ * Inputs:	job	- Block of bits, which has already been tried as is,
+ *			  and space for the result.  See fix_pool.c.
+ *
+ * Description:	Any frame recovered is saved in job rather than being passed
+ *		along.  multi_modem picks it up from there, on the audio thread,
+ *		with the time it was received.
+ *
+ ***********************************************************************************/
 
-int hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel)
+void hdlc_rec2_fix_job (struct fix_job_s *job)
 {
-	int ok;
-	//int len;
-	//retry_t fix_bits = save_audio_config_p->achan[chan].fix_bits;
+	rrbb_t block = job->block;
+	int chan = rrbb_get_chan(block);
+	int subchan = rrbb_get_subchan(block);
+	int slice = rrbb_get_slice(block);
+	alevel_t alevel = rrbb_get_audio_level(block);
 	int passall = save_audio_config_p->achan[chan].passall;
-#if DEBUG_LATER
-	double tstart, tend;
-#endif
 	retry_conf_t retry_cfg;
 
-	memset (&retry_cfg, 0, sizeof(retry_cfg));
-
-	//len = rrbb_get_len(block);
-
+	uint64_t start = rx_stats_clock();
+	int ok = try_to_fix_quick_now (block, chan, subchan, slice, alevel, job);
+	rx_stats_time (chan, RX_STAGE_FIX, start);
 
-/*
- * All fix up attempts have failed.  
- * Should we pass it along anyhow with a bad CRC?
- * Note that we still need a minimum number of whole octets.
- */
-	if (passall) {
+	if (ok) {
+	  return;
+	}
 
+	if (passall && ! fix_pool_cancelled(job)) {
+	  memset (&retry_cfg, 0, sizeof(retry_cfg));
 	  retry_cfg.type = RETRY_TYPE_NONE;
 	  retry_cfg.mode = RETRY_MODE_CONTIGUOUS;
 	  retry_cfg.retry = RETRY_NONE;
-	  retry_cfg.u_bits.contig.nr_bits = 0;
-	  retry_cfg.u_bits.contig.bit_idx = 0;
-	  ok = try_decode (block, chan, subchan, slice, alevel, retry_cfg, passall);
-	  return (ok);
+	  try_decode (block, chan, subchan, slice, alevel, retry_cfg, 1, job);
 	}
 
-	return (0);
-
-}  /* end hdlc_rec2_try_to_fix_later */
+}  /* end hdlc_rec2_fix_job */
 
 
 
@@ -542,6 +1160,31 @@ inline static char is_sep_bit_modified(int bit_idx, retry_conf_t retry_conf) {
 
 
 
+/*
+ * Send a good frame along for further processing.
+ * From a worker thread, just save it.  We stop after the first.
+ */
+
+static void deliver (struct fix_job_s *job, int chan, int subchan, int slice, unsigned char *fbuf, int flen, alevel_t alevel, retry_t retries)
+{
+	rx_stats_add (&(rx_stats_slice(chan, subchan, slice)->fix_ok[retries]), 1);
+
+	if (job == NULL) {
+	  multi_modem_process_rec_frame (chan, subchan, slice, fbuf, flen, alevel, retries, 0);
+	  return;
+	}
+
+	assert (flen >= 0 && flen <= (int)sizeof(job->frame));
+	memcpy (job->frame, fbuf, flen);
+	job->flen = flen;
+	job->subchan = subchan;
+	job->slice = slice;
+	job->alevel = alevel;
+	job->retries = retries;
+	job->found = 1;
+}
+
+
 /***********************************************************************************
  *
  * Name:	try_decode
@@ -580,17 +1223,23 @@ inline static char is_sep_bit_modified(int bit_idx, retry_conf_t retry_conf) {
  *				  Valid only when no changes make.  i.e.
  *					retry == RETRY_NONE, type == RETRY_TYPE_NONE
  *
+ *		job		- NULL to pass a good frame along right away.
+ *				  Otherwise, it is saved here for a worker thread.
+ *
  * Returns:	1 = successfully extracted something.
  *		0 = failure.
  *
  ***********************************************************************************/
 
-static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, retry_conf_t retry_conf, int passall)
+static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel, retry_conf_t retry_conf, int passall, struct fix_job_s *job)
 {
 	struct hdlc_state2_s H2;
 	int blen;			/* Block length in bits. */
-	int i;
-	int raw;			/* From demodulator.  Should be 0 or 1. */
+	int nw;				/* Number of words used in block. */
+	int i, k;
+	uint32_t raw[RRBB_WORDS + 1];	/* From demodulator, 32 per word, with */
+					/* one word of history in front. */
+	uint32_t carry;
 #if DEBUGx
 	int crc_failed = 1;
 #endif
@@ -599,148 +1248,133 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
 	int retry_conf_retry = retry_conf.retry;
 
 
+	if (retry_conf.retry != RETRY_NONE) {
+	  rx_stats_add (&(rx_stats_slice(chan, subchan, slice)->fix_tried[retry_conf.retry]), 1);
+	}
+
 	H2.is_scrambled = rrbb_get_is_scrambled (block);
 	H2.prev_descram = rrbb_get_prev_descram (block);
 	H2.lfsr = rrbb_get_descram_state (block);
-	H2.prev_raw = rrbb_get_bit (block, 0);	  /* Actually last bit of the */
-					/* opening flag so we can derive the */
-					/* first data bit.  */
-
-	/* Does this make sense? */
-	/* This is the last bit of the "flag" pattern. */
-	/* If it was corrupted we wouldn't have detected */
-	/* the start of frame. */
-
-	if ((retry_conf.mode == RETRY_MODE_CONTIGUOUS && is_contig_bit_modified(0, retry_conf)) ||
-	    (retry_conf.mode == RETRY_MODE_SEPARATED && is_sep_bit_modified(0, retry_conf))) {
-	  H2.prev_raw = ! H2.prev_raw;
-	}
 
-	H2.pat_det = 0;
-	H2.oacc = 0;
-	H2.olen = 0;
-	H2.frame_len = 0;
+	hdlc_deframe_start (&H2.D);
 
 	blen = rrbb_get_len(block);
+	nw = (blen + 31) / 32;
 
 #if DEBUGx
 	text_color_set(DW_COLOR_DEBUG);
         if (retry_conf.type == RETRY_TYPE_NONE) 
         	dw_printf ("try_decode: blen=%d\n", blen);
 #endif
-	for (i=1; i<blen; i++) {
-	  /* Get the value for the current bit */
-	  raw = rrbb_get_bit (block, i);
-	  /* If swap two sep mode , swap the bit if needed */
-	  if (retry_conf_retry == RETRY_INVERT_TWO_SEP) {
-	      if (is_sep_bit_modified(i, retry_conf))
-	        raw = ! raw;
-	  } 
-	  /* Else handle all the others contiguous modes */
-	  else if (retry_conf_mode == RETRY_MODE_CONTIGUOUS) {
-
-            if (retry_conf_type == RETRY_TYPE_SWAP) {
-	        /* If this is the bit to swap */
-	        if (is_contig_bit_modified(i, retry_conf))
-	          raw = ! raw;
-            } 
-
-	  } else {
-	  }
-/*
- * Octets are sent LSB first.
- * Shift the most recent 8 bits thru the pattern detector.
- */
-	    H2.pat_det >>= 1;
 
 /*
- * Using NRZI encoding,
- *   A '0' bit is represented by an inversion since previous bit.
- *   A '1' bit is represented by no change.
- *   Note: this code can be factorized with the raw != H2.prev_raw code at the cost of processing time 
+ * Bit i of the block is bit i+32 here.  The word in front holds earlier
+ * bits so we can undo NRZI and scrambling a whole word at a time.
+ *
+ * Bit 0 is actually the last bit of the opening flag so we can derive
+ * the first data bit.  For scrambled data, the descrambler state has
+ * the 17 bits before the first data bit.
  */
+	memcpy (raw + 1, rrbb_get_words(block), nw * sizeof(uint32_t));
+	raw[0] = 0;
 
-	    int dbit ;
+	if (H2.is_scrambled) {
+	  for (k = 1; k <= 16; k++) {
+	    raw[0] |= (uint32_t)((H2.lfsr >> k) & 1) << (32 - k);
+	  }
+	  raw[1] = (raw[1] & ~1u) | (H2.lfsr & 1);
+	}
 
-	    if (H2.is_scrambled) {
-	      int descram;
+	/* Does this make sense? */
+	/* This is the last bit of the "flag" pattern. */
+	/* If it was corrupted we wouldn't have detected */
+	/* the start of frame. */
+	/* Scrambled data doesn't use it for anything. */
 
-	      descram = descramble(raw, &(H2.lfsr));
+	if ((retry_conf.mode == RETRY_MODE_CONTIGUOUS && is_contig_bit_modified(0, retry_conf)) ||
+	    (retry_conf.mode == RETRY_MODE_SEPARATED && is_sep_bit_modified(0, retry_conf))) {
+	  if ( ! H2.is_scrambled) {
+	    raw[1] ^= 1;
+	  }
+	}
 
-	      dbit = (descram == H2.prev_descram);
-	      H2.prev_descram = descram;
-	      H2.prev_raw = raw;
+	/* If swap two sep mode , swap the bits if needed */
+	if (retry_conf_retry == RETRY_INVERT_TWO_SEP) {
+	  int sep[3] = { retry_conf.u_bits.sep.bit_idx_a, retry_conf.u_bits.sep.bit_idx_b, retry_conf.u_bits.sep.bit_idx_c };
+	  for (k = 0; k < 3; k++) {
+	    i = sep[k];
+	    if (i >= 1 && i < blen && (k < 1 || i != sep[0]) && (k < 2 || i != sep[1])) {
+	      raw[1 + (i >> 5)] ^= (uint32_t)1 << (i & 31);
 	    }
-	    else {
+	  }
+	}
+	/* Else handle all the others contiguous modes */
+	else if (retry_conf_mode == RETRY_MODE_CONTIGUOUS && retry_conf_type == RETRY_TYPE_SWAP) {
+	  int first = retry_conf.u_bits.contig.bit_idx;
+	  int last = first + retry_conf.u_bits.contig.nr_bits;
+	  if (first < 1) first = 1;
+	  if (last > blen) last = blen;
+	  for (i = first; i < last; i++) {
+	    raw[1 + (i >> 5)] ^= (uint32_t)1 << (i & 31);
+	  }
+	}
 
-	      dbit = (raw == H2.prev_raw);
-	      H2.prev_raw = raw;
-	    }
+	carry = H2.prev_descram;
 
-	    if (dbit) {
+	for (k = 1; k <= nw; k++) {
 
-	      H2.pat_det |= 0x80;
-	      /* Valid data will never have 7 one bits in a row: exit. */
-	      if (H2.pat_det == 0xfe) {
-#if DEBUGx
-	        text_color_set(DW_COLOR_DEBUG);
-	        dw_printf ("try_decode: found abort, i=%d\n", i);
-#endif
-	        return 0;
-	      }
-	      H2.oacc >>= 1;
-	      H2.oacc |= 0x80;
-	    } else {
-	      
-	      /* The special pattern 01111110 indicates beginning and ending of a frame: exit. */
-	      if (H2.pat_det == 0x7e) {
-#if DEBUGx
-	        text_color_set(DW_COLOR_DEBUG);
-	        dw_printf ("try_decode: found flag, i=%d\n", i);
-#endif
-	      return 0;
 /*
- * If we have five '1' bits in a row, followed by a '0' bit,
- *
- *	011111xx
- *
- * the current '0' bit should be discarded because it was added for 
- * "bit stuffing."
+ * Using NRZI encoding,
+ *   A '0' bit is represented by an inversion since previous bit.
+ *   A '1' bit is represented by no change.
+ * For scrambled data, the previous bit is after descrambling.
  */
-	
-	      } else if ( (H2.pat_det >> 2) == 0x1f ) {
-	        continue;
-	      }
-	      H2.oacc >>= 1;
+	  uint32_t w = raw[k];
+	  uint32_t dbits;
+
+	  if (H2.is_scrambled) {
+	    uint32_t descram = w ^ ((w << 12) | (raw[k-1] >> 20)) ^ ((w << 17) | (raw[k-1] >> 15));
+	    if (k == 1) {
+	      descram = (descram & ~1u) | H2.prev_descram;
 	    }
+	    dbits = ~ (descram ^ ((descram << 1) | carry));
+	    carry = descram >> 31;
+	  }
+	  else {
+	    dbits = ~ (w ^ ((w << 1) | (raw[k-1] >> 31)));
+	  }
 
 /*
- * Now accumulate bits into octets, and complete octets
- * into the frame buffer.
+ * Bit 0 was only needed to get the first data bit.
+ * Remove bit stuffing and collect octets.
+ * Give up if we find a flag or abort pattern.
  */
+	  int nbits = blen - (k - 1) * 32;
+	  if (nbits > 32) nbits = 32;
 
-	    H2.olen++;
-
-	    if (H2.olen & 8) {
-	      H2.olen = 0;
+	  if (k == 1) {
+	    dbits >>= 1;
+	    nbits--;
+	  }
 
-	      if (H2.frame_len < MAX_FRAME_LEN) {
-	        H2.frame_buf[H2.frame_len] = H2.oacc;
-		H2.frame_len++;
-	      
-	      }
-	    }
-	  }	/* end of loop on all bits in block */
+	  if (hdlc_deframe_bits (&H2.D, dbits, nbits) != HDLC_DEFRAME_MORE) {
+#if DEBUGx
+	    text_color_set(DW_COLOR_DEBUG);
+	    dw_printf ("try_decode: found flag or abort, word %d\n", k);
+#endif
+	    return 0;
+	  }
+	}	/* end of loop on all bits in block */
 /* 
  * Do we have a minimum number of complete bytes?
  */
 
 #if DEBUGx
 	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("try_decode: olen=%d, frame_len=%d\n", H2.olen, H2.frame_len);
+	dw_printf ("try_decode: olen=%d, frame_len=%d\n", H2.D.alen, H2.D.frame_len);
 #endif
 
-	if (H2.olen == 0 && H2.frame_len >= MIN_FRAME_LEN) {
+	if (H2.D.alen == 0 && H2.D.frame_len >= MIN_FRAME_LEN) {
 
 	  unsigned short actual_fcs, expected_fcs;
 
@@ -748,9 +1382,9 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
         if (retry_conf.type == RETRY_TYPE_NONE) {
 	  int j;
 	  text_color_set(DW_COLOR_DEBUG);
-	  dw_printf ("NEW WAY: frame len = %d\n", H2.frame_len);
-	  for (j=0; j<H2.frame_len; j++) {
-	    dw_printf ("  %02x", H2.frame_buf[j]);
+	  dw_printf ("NEW WAY: frame len = %d\n", H2.D.frame_len);
+	  for (j=0; j<H2.D.frame_len; j++) {
+	    dw_printf ("  %02x", H2.D.frame_buf[j]);
 	  }
 	  dw_printf ("\n");
 
@@ -765,15 +1399,15 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
 	  /* I think making a second pass over it and comparing is */
 	  /* easier to understand. */
 
-	  actual_fcs = H2.frame_buf[H2.frame_len-2] | (H2.frame_buf[H2.frame_len-1] << 8);
+	  actual_fcs = H2.D.frame_buf[H2.D.frame_len-2] | (H2.D.frame_buf[H2.D.frame_len-1] << 8);
 
-	  expected_fcs = fcs_calc (H2.frame_buf, H2.frame_len - 2);
+	  expected_fcs = fcs_calc (H2.D.frame_buf, H2.D.frame_len - 2);
 
 	  if (actual_fcs == expected_fcs && save_audio_config_p->achan[chan].modem_type == MODEM_AIS) {
 
 	      // Sanity check for AIS.
-	      if (ais_check_length((H2.frame_buf[0] >> 2) & 0x3f, H2.frame_len - 2) == 0) {
-	          multi_modem_process_rec_frame (chan, subchan, slice, H2.frame_buf, H2.frame_len - 2, alevel, retry_conf.retry, 0);   /* len-2 to remove FCS. */
+	      if (ais_check_length((H2.D.frame_buf[0] >> 2) & 0x3f, H2.D.frame_len - 2) == 0) {
+	          deliver (job, chan, subchan, slice, H2.D.frame_buf, H2.D.frame_len - 2, alevel, retry_conf.retry);   /* len-2 to remove FCS. */
 	          return 1;		/* success */
 	      }
 	      else {
@@ -781,7 +1415,7 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
 	      }
 	  }
 	  else if (actual_fcs == expected_fcs &&
-			sanity_check (H2.frame_buf, H2.frame_len - 2, retry_conf.retry, save_audio_config_p->achan[chan].sanity_test)) {
+			sanity_check (H2.D.frame_buf, H2.D.frame_len - 2, retry_conf.retry, save_audio_config_p->achan[chan].sanity_test)) {
 
 	      // TODO: Shouldn't be necessary to pass chan, subchan, alevel into
 	      // try_decode because we can obtain them from block.
@@ -789,7 +1423,7 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
 
 	      assert (rrbb_get_chan(block) == chan);
 	      assert (rrbb_get_subchan(block) == subchan);
-	      multi_modem_process_rec_frame (chan, subchan, slice, H2.frame_buf, H2.frame_len - 2, alevel, retry_conf.retry, 0);   /* len-2 to remove FCS. */
+	      deliver (job, chan, subchan, slice, H2.D.frame_buf, H2.D.frame_len - 2, alevel, retry_conf.retry);   /* len-2 to remove FCS. */
 	      return 1;		/* success */
 
 	  } else if (passall) {
@@ -798,7 +1432,7 @@ static int try_decode (rrbb_t block, int chan, int subchan, int slice, alevel_t
 	      //text_color_set(DW_COLOR_ERROR);
 	      //dw_printf ("ATTEMPTING PASSALL PROCESSING\n");
   
-	      multi_modem_process_rec_frame (chan, subchan, slice, H2.frame_buf, H2.frame_len - 2, alevel, RETRY_MAX, 0);   /* len-2 to remove FCS. */
+	      deliver (job, chan, subchan, slice, H2.D.frame_buf, H2.D.frame_len - 2, alevel, RETRY_MAX);   /* len-2 to remove FCS. */
 	      return 1;		/* success */
 	    }
 	    else {
@@ -823,25 +1457,25 @@ failure:
 	      text_color_set(DW_COLOR_ERROR);
               if (crc_failed)
 	            dw_printf ("CRC failed\n");
-	      if (H2.olen != 0)
-		      dw_printf ("Bad olen: %d \n", H2.olen);
-	      else if (H2.frame_len < MIN_FRAME_LEN) {
+	      if (H2.D.alen != 0)
+		      dw_printf ("Bad olen: %d \n", H2.D.alen);
+	      else if (H2.D.frame_len < MIN_FRAME_LEN) {
 		      dw_printf ("Frame too small\n");
                       goto end;
 	      }
 
-	      dw_printf ("FAILURE with frame: frame len = %d\n", H2.frame_len);
+	      dw_printf ("FAILURE with frame: frame len = %d\n", H2.D.frame_len);
 	      dw_printf ("\n");
-	      for (j=0; j<H2.frame_len; j++) {
-                      dw_printf (" %02x", H2.frame_buf[j]);
+	      for (j=0; j<H2.D.frame_len; j++) {
+                      dw_printf (" %02x", H2.D.frame_buf[j]);
 	      }
 	  dw_printf ("\nDEC\n");
-	  for (j=0; j<H2.frame_len; j++) {
-	    dw_printf ("%c", H2.frame_buf[j]>>1);
+	  for (j=0; j<H2.D.frame_len; j++) {
+	    dw_printf ("%c", H2.D.frame_buf[j]>>1);
 	  }
 	  dw_printf ("\nORIG\n");
-          for (j=0; j<H2.frame_len; j++) {
-	    dw_printf ("%c", H2.frame_buf[j]);
+          for (j=0; j<H2.D.frame_len; j++) {
+	    dw_printf ("%c", H2.D.frame_buf[j]);
 	  }
 	  dw_printf ("\n");
         }
@@ -59,7 +59,9 @@ void hdlc_rec2_init (struct audio_s *audio_config_p);
 
 void hdlc_rec2_block (rrbb_t block);
 
-int hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int slice, alevel_t alevel);
+struct fix_job_s;
+
+void hdlc_rec2_fix_job (struct fix_job_s *job);
 
 /* Provided by the top level application to process a complete frame. */
 
@@ -167,7 +167,7 @@ packet_t il2p_decode_frame (unsigned char *irec)
 
 	// TODO?: for symmetry we might want to clarify the payload before combining.
 
-	return (il2p_decode_header_payload(uhdr, irec + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY, &e));
+	return (il2p_decode_header_payload(uhdr, irec + IL2P_HEADER_SIZE + IL2P_HEADER_PARITY, NULL, &e));
 }
 
 
@@ -179,6 +179,8 @@ packet_t il2p_decode_frame (unsigned char *irec)
  *
  * Inputs:	uhdr 		- Received header after FEC and descrambling.
  *		epayload	- Encoded payload.
+ *		econf		- Confidence, 0 to 100, for each byte of encoded payload.
+ *				  NULL if not known.
  *
  * In/Out:	symbols_corrected - Symbols (bytes) corrected in the header.
  *				  Should be 0 or 1 because it has 2 parity symbols.
@@ -188,7 +190,7 @@ packet_t il2p_decode_frame (unsigned char *irec)
  *
  *--------------------------------------------------------------*/
 
-packet_t il2p_decode_header_payload (unsigned char* uhdr, unsigned char *epayload, int *symbols_corrected)
+packet_t il2p_decode_header_payload (unsigned char* uhdr, unsigned char *epayload, const unsigned char *econf, int *symbols_corrected)
 {
 	int hdr_type;
 	int max_fec;
@@ -210,7 +212,7 @@ packet_t il2p_decode_header_payload (unsigned char* uhdr, unsigned char *epayloa
 	        // This is the AX.25 Information part.
 
 	        unsigned char extracted[IL2P_MAX_PAYLOAD_SIZE];
-		int e = il2p_decode_payload (epayload, payload_len, max_fec, extracted, symbols_corrected);
+		int e = il2p_decode_payload (epayload, econf, payload_len, max_fec, extracted, symbols_corrected);
 
 		// It would be possible to have a good header but too many errors in the payload.
 
@@ -234,7 +236,7 @@ packet_t il2p_decode_header_payload (unsigned char* uhdr, unsigned char *epayloa
 // Header type 0.  The payload is the entire AX.25 frame.
 
 	    unsigned char extracted[IL2P_MAX_PAYLOAD_SIZE];
-	    int e = il2p_decode_payload (epayload, payload_len, max_fec, extracted, symbols_corrected);
+	    int e = il2p_decode_payload (epayload, econf, payload_len, max_fec, extracted, symbols_corrected);
 
 	    if (e <= 0) {	// Payload was not received correctly.
 	        return (NULL);
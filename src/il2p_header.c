@@ -669,7 +669,7 @@ int il2p_clarify_header(unsigned char *rec_hdr, unsigned char *corrected_descram
 {
 	unsigned char corrected[IL2P_HEADER_SIZE+IL2P_HEADER_PARITY];
 
-	int e = il2p_decode_rs (rec_hdr, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY, corrected);
+	int e = il2p_decode_rs (rec_hdr, NULL, IL2P_HEADER_SIZE, IL2P_HEADER_PARITY, corrected);
 
 	il2p_descramble_block (corrected, corrected_descrambled_hdr, IL2P_HEADER_SIZE);
 
@@ -150,6 +150,9 @@ void il2p_encode_rs (unsigned char *tx_data, int data_size, int num_parity, unsi
  *
  * Inputs:	rec_block	Received block composed of data and parity.
  *				Total size is sum of following two parameters.
+ *		rec_conf	Confidence, 0 to 100, for each byte of above.
+ *				If not NULL, and there are too many errors,
+ *				the least confident are tried as erasures.
  *		data_size	Number of data bytes in above.
  *		num_parity	Number of parity symbols (bytes) in above.
  *
@@ -161,7 +164,7 @@ void il2p_encode_rs (unsigned char *tx_data, int data_size, int num_parity, unsi
  *
  *--------------------------------------------------------------*/
 
-int il2p_decode_rs (unsigned char *rec_block, int data_size, int num_parity, unsigned char *out)
+int il2p_decode_rs (unsigned char *rec_block, const unsigned char *rec_conf, int data_size, int num_parity, unsigned char *out)
 {
 
 	//  Use zero padding in front if data size is too small.
@@ -186,6 +189,15 @@ int il2p_decode_rs (unsigned char *rec_block, int data_size, int num_parity, uns
 	int derrlocs[FX25_MAX_CHECK];	// Half would probably be OK.
 
 	int derrors = DECODE_RS(il2p_find_rs(num_parity), rs_block, derrlocs, 0);
+
+	if (derrors < 0 && rec_conf != NULL) {
+	    unsigned char rs_conf[FX25_BLOCK_SIZE];
+
+	    memset (rs_conf, 100, sizeof(rs_conf) - n);		// Filler is known.
+	    memcpy (rs_conf + sizeof(rs_conf) - n, rec_conf, n);
+	    memcpy (rs_block + sizeof(rs_block) - n, rec_block, n);	// In case it was changed.
+	    derrors = rs_decode_erasures (il2p_find_rs(num_parity), rs_block, rs_conf, derrlocs);
+	}
 	memcpy (out, rs_block + sizeof(rs_block) - n, data_size);
 
 	if (il2p_get_debug() >= 3) {
@@ -195,6 +195,8 @@ int il2p_encode_payload (unsigned char *payload, int payload_size, int max_fec,
  *
  * Inputs:	received	Array of bytes.  Size is unknown but in practice it
  *				must not exceed IL2P_MAX_ENCODED_SIZE.
+ *		rec_conf	Confidence, 0 to 100, for each byte received.
+ *				NULL if not known.
  *		payload_size	0 to 1023.  (IL2P_MAX_PAYLOAD_SIZE)
  *				Expected result size based on header.
  *		max_fec		true for 16 parity symbols, false for automatic.
@@ -215,7 +217,7 @@ int il2p_encode_payload (unsigned char *payload, int payload_size, int max_fec,
  *
  *--------------------------------------------------------------------------------*/
 
-int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec, unsigned char *payload_out, int *symbols_corrected)
+int il2p_decode_payload (unsigned char *received, const unsigned char *rec_conf, int payload_size, int max_fec, unsigned char *payload_out, int *symbols_corrected)
 {
 // Determine number of blocks and sizes.
 
@@ -227,6 +229,7 @@ int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec,
 	}
 
 	unsigned char *pin = received;
+	const unsigned char *cin = rec_conf;
 	unsigned char *pout = payload_out;
 	int decoded_length = 0;
 	int failed = 0;
@@ -235,7 +238,7 @@ int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec,
 
 	for (int b = 0; b < ipp.large_block_count; b++) {
 	    unsigned char corrected_block[255];
-	    int e = il2p_decode_rs (pin, ipp.large_block_size, ipp.parity_symbols_per_block, corrected_block);
+	    int e = il2p_decode_rs (pin, cin, ipp.large_block_size, ipp.parity_symbols_per_block, corrected_block);
 
 	    // dw_printf ("%s:%d: large block decode_rs returned status = %d\n", __FILE__, __LINE__, e);
 
@@ -251,6 +254,7 @@ int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec,
 	    }
 
 	    pin += ipp.large_block_size + ipp.parity_symbols_per_block;
+	    if (cin != NULL) cin += ipp.large_block_size + ipp.parity_symbols_per_block;
 	    pout += ipp.large_block_size;
 	    decoded_length += ipp.large_block_size;
 	}
@@ -259,7 +263,7 @@ int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec,
 
 	for (int b = 0; b < ipp.small_block_count; b++) {
 	    unsigned char corrected_block[255];
-	    int e = il2p_decode_rs (pin, ipp.small_block_size, ipp.parity_symbols_per_block, corrected_block);
+	    int e = il2p_decode_rs (pin, cin, ipp.small_block_size, ipp.parity_symbols_per_block, corrected_block);
 
 	    // dw_printf ("%s:%d: small block decode_rs returned status = %d\n", __FILE__, __LINE__, e);
 
@@ -275,6 +279,7 @@ int il2p_decode_payload (unsigned char *received, int payload_size, int max_fec,
 	    }
 
 	    pin += ipp.small_block_size + ipp.parity_symbols_per_block;
+	    if (cin != NULL) cin += ipp.small_block_size + ipp.parity_symbols_per_block;
 	    pout += ipp.small_block_size;
 	    decoded_length += ipp.small_block_size;
 	}
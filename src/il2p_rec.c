@@ -39,6 +39,7 @@
 #include "il2p.h"
 #include "multi_modem.h"
 #include "demod.h"
+#include "rx_stats.h"
 
 
 struct il2p_context_s {
@@ -66,6 +67,10 @@ struct il2p_context_s {
 				// Scrambled and encoded payload as received over the radio.
 	int pc;			// Number of bytes placed in above.
 
+	unsigned char pconf[IL2P_MAX_ENCODED_PAYLOAD_SIZE];
+				// Lowest bit quality for each byte of the payload.
+	int qmin;		// Lowest bit quality for byte being accumulated.
+
 	int corrected;		// Number of symbols corrected by RS FEC.
 };
 
@@ -87,6 +92,10 @@ static struct il2p_context_s *il2p_context[MAX_CHANS][MAX_SUBCHANS][MAX_SLICERS]
  *
  *              dbit	- One bit from the received data stream.
  *
+ *		quality	- How sure the demodulator is about the bit, 0 to 100.
+ *			  Unsure payload bytes can be marked as erasures
+ *			  if there are too many errors to fix otherwise.
+ *
  * Description: This is called once for each received bit.
  *              For each valid packet, process_rec_frame() is called for further processing.
  *		It can gather multiple candidates from different parallel demodulators
@@ -94,7 +103,7 @@ static struct il2p_context_s *il2p_context[MAX_CHANS][MAX_SUBCHANS][MAX_SLICERS]
  *
  ***********************************************************************************/
 
-void il2p_rec_bit (int chan, int subchan, int slice, int dbit)
+void il2p_rec_bit (int chan, int subchan, int slice, int dbit, int quality)
 {
 
 // Allocate context blocks only as needed.
@@ -182,6 +191,7 @@ void il2p_rec_bit (int chan, int subchan, int slice, int dbit)
 
 	           if (F->eplen >= 1) {		// Need to gather payload.
 	             F->pc = 0;
+	             F->qmin = 100;
 	             F->state = IL2P_PAYLOAD;
 	           }
 	           else if (F->eplen == 0) {	// No payload.
@@ -207,9 +217,12 @@ void il2p_rec_bit (int chan, int subchan, int slice, int dbit)
 
 	  case IL2P_PAYLOAD:		// Gathering the payload, if any.
 
+	    if (quality < F->qmin) F->qmin = quality;
 	    F->bc++;
 	    if (F->bc == 8) {	// full byte has been collected.
 	      F->bc = 0;
+	      F->pconf[F->pc] = F->qmin;
+	      F->qmin = 100;
 	      if ( ! F->polarity) {
 	        F->spayload[F->pc++] = F->acc & 0xff;
 	      }
@@ -235,7 +248,19 @@ void il2p_rec_bit (int chan, int subchan, int slice, int dbit)
 	    // TODO?:  for symmetry, we might decode the payload here and later build the frame.
 
 	    {
-	      packet_t pp = il2p_decode_header_payload (F->uhdr, F->spayload, &(F->corrected));
+	      struct rx_slice_stats_s *stats = rx_stats_slice (chan, subchan, slice);
+	      uint64_t start = rx_stats_clock();
+
+	      packet_t pp = il2p_decode_header_payload (F->uhdr, F->spayload, F->pconf, &(F->corrected));
+
+	      rx_stats_time (chan, RX_STAGE_IL2P, start);
+	      rx_stats_add (&stats->il2p_frames, 1);
+	      if (pp == NULL) {
+	        rx_stats_add (&stats->il2p_failed, 1);
+	      }
+	      else {
+	        rx_stats_add (&stats->il2p_corrected, F->corrected);
+	      }
 
 	      if (il2p_get_debug() >= 1) {
 	          if (pp != NULL) {
@@ -161,29 +161,29 @@ static void test_rs()
 	unsigned char corrected[15];
 	int e;
 
-	e = il2p_decode_rs (example_s, 13, 2, corrected);
+	e = il2p_decode_rs (example_s, NULL, 13, 2, corrected);
 	assert (e == 0);
 	assert (memcmp(example_s, corrected, 13) == 0);
 
 	memcpy (received, example_s, 15);
 	received[0] = '?';
-	e = il2p_decode_rs (received, 13, 2, corrected);
+	e = il2p_decode_rs (received, NULL, 13, 2, corrected);
 	assert (e == 1);
 	assert (memcmp(example_s, corrected, 13) == 0);
 
-	e = il2p_decode_rs (example_u, 13, 2, corrected);
+	e = il2p_decode_rs (example_u, NULL, 13, 2, corrected);
 	assert (e == 0);
 	assert (memcmp(example_u, corrected, 13) == 0);
 
 	memcpy (received, example_u, 15);
 	received[12] = '?';
-	e = il2p_decode_rs (received, 13, 2, corrected);
+	e = il2p_decode_rs (received, NULL, 13, 2, corrected);
 	assert (e == 1);
 	assert (memcmp(example_u, corrected, 13) == 0);
 
 	received[1] = '?';
 	received[2] = '?';
-	e = il2p_decode_rs (received, 13, 2, corrected);
+	e = il2p_decode_rs (received, NULL, 13, 2, corrected);
 	assert (e == -1);
 }
 
@@ -298,7 +298,7 @@ static void test_payload(void)
 
 	        unsigned char extracted[IL2P_MAX_PAYLOAD_SIZE];
 	        int symbols_corrected = 0;
-		int e = il2p_decode_payload (encoded, payload_length, max_fec, extracted, &symbols_corrected);
+		int e = il2p_decode_payload (encoded, NULL, payload_length, max_fec, extracted, &symbols_corrected);
 	        //dw_printf ("e = %d, payload_length = %d\n", e, payload_length);
 		assert (e == payload_length);
 
@@ -851,7 +851,7 @@ static void decode_bitstream(void)
 	while ( (ch = fgetc(fp)) != EOF) {
 
 	  if (ch == '0' || ch == '1') {
-	    il2p_rec_bit (0, 0, 0, ch - '0');
+	    il2p_rec_bit (0, 0, 0, ch - '0', 100);
 	  }
 	}
 	fclose(fp);
@@ -922,7 +922,7 @@ static void test_serdes (void)
 	            dw_printf ("%d bits sent.\n", num_bits_sent);
 
 	            // Need extra bit at end to flush out state machine.
-	            il2p_rec_bit (0, 0, 0, 0);
+	            il2p_rec_bit (0, 0, 0, 0, 100);
 	        }
 	    }
 	    ax25_delete(pp);
@@ -938,7 +938,7 @@ static void test_serdes (void)
 
 void tone_gen_put_bit (int chan, int data)
 {
-	il2p_rec_bit (chan, 0, 0, data);
+	il2p_rec_bit (chan, 0, 0, data, 100);
 }
 
 // This is called when a complete frame has been deserialized.
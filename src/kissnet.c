@@ -677,8 +677,8 @@ static THREAD_F connect_listen_thread (void *arg)
 void kissnet_send_rec_packet (int chan, int kiss_cmd, unsigned char *fbuf, int flen,
 			struct kissport_status_s *onlykps, int onlyclient)
 {
-	unsigned char kiss_buff[2 * AX25_MAX_PACKET_LEN];
-	int kiss_len;
+	unsigned char kiss_buff[2][2 * AX25_MAX_PACKET_LEN];	// [0] for all channel ports, [1] for single channel.
+	int kiss_len[2] = { -1, -1 };				// -1 until encoded.
 	int err;
 
 // Something received over the radio would normally be sent to all attached clients.
@@ -696,6 +696,9 @@ void kissnet_send_rec_packet (int chan, int kiss_cmd, unsigned char *fbuf, int f
 
 	        if (kps->client_sock[client] != -1) {
 
+	          unsigned char *send_buff;
+	          int send_len;
+
 	          if (flen < 0) {
 
 // A client app might think it is attached to a traditional TNC.
@@ -714,13 +717,12 @@ void kissnet_send_rec_packet (int chan, int kiss_cmd, unsigned char *fbuf, int f
 	            if (kiss_debug) {
 	              kiss_debug_print (TO_CLIENT, "Fake command prompt", fbuf, flen);
 	            }
-	            strlcpy ((char *)kiss_buff, (char *)fbuf, sizeof(kiss_buff));
-	            kiss_len = strlen((char *)kiss_buff);
+	            strlcpy ((char *)kiss_buff[0], (char *)fbuf, sizeof(kiss_buff[0]));
+	            send_buff = kiss_buff[0];
+	            send_len = strlen((char *)send_buff);
 	          }
 	          else {
-	            unsigned char stemp[AX25_MAX_PACKET_LEN + 1];
-
-	            assert (flen < (int)(sizeof(stemp)));
+	            int form;
 
 	            // New in 1.7.
 	            // Previously all channels were sent to everyone.
@@ -729,38 +731,51 @@ void kissnet_send_rec_packet (int chan, int kiss_cmd, unsigned char *fbuf, int f
 
 	            if (kps->chan == -1) {
 	              // Normal case, all channels.
-	              stemp[0] = (chan << 4) | kiss_cmd;
+	              form = 0;
 	            }
 	            else if (kps->chan == chan) {
 	              // Single radio channel for this port.  Application sees 0.
-	              stemp[0] = (0 << 4) | kiss_cmd;
+	              form = 1;
 	            }
 	            else {
 	              // Skip it.
 	              continue;
 	            }
 
-	            memcpy (stemp+1, fbuf, flen);
+	            // Every client getting the same form gets the same bytes
+	            // so only encode it the first time.
 
-	            if (kiss_debug >= 2) {
-	              /* AX.25 frame with the CRC removed. */
-	              text_color_set(DW_COLOR_DEBUG);
-	              dw_printf ("\n");
-	              dw_printf ("Packet content before adding KISS framing and any escapes:\n");
-	              hex_dump (fbuf, flen);
-	            }
+	            if (kiss_len[form] < 0) {
+	              unsigned char stemp[AX25_MAX_PACKET_LEN + 1];
+
+	              assert (flen < (int)(sizeof(stemp)));
 
-	            kiss_len = kiss_encapsulate (stemp, flen+1, kiss_buff);
+	              stemp[0] = ((form == 0 ? chan : 0) << 4) | kiss_cmd;
+	              memcpy (stemp+1, fbuf, flen);
+
+	              if (kiss_debug >= 2) {
+	                /* AX.25 frame with the CRC removed. */
+	                text_color_set(DW_COLOR_DEBUG);
+	                dw_printf ("\n");
+	                dw_printf ("Packet content before adding KISS framing and any escapes:\n");
+	                hex_dump (fbuf, flen);
+	              }
+
+	              kiss_len[form] = kiss_encapsulate (stemp, flen+1, kiss_buff[form]);
+	            }
 
 	            /* This has the escapes and the surrounding FENDs. */
 
+	            send_buff = kiss_buff[form];
+	            send_len = kiss_len[form];
+
 	            if (kiss_debug) {
-	              kiss_debug_print (TO_CLIENT, NULL, kiss_buff, kiss_len);
+	              kiss_debug_print (TO_CLIENT, NULL, send_buff, send_len);
 	            }
 	          }
 
 #if __WIN32__	
-                  err = SOCK_SEND(kps->client_sock[client], (char*)kiss_buff, kiss_len);
+                  err = SOCK_SEND(kps->client_sock[client], (char*)send_buff, send_len);
 	          if (err == SOCKET_ERROR) {
 	            text_color_set(DW_COLOR_ERROR);
 	            dw_printf ("\nError %d sending message to KISS client application %d on port %d.  Closing connection.\n\n", WSAGetLastError(), client, kps->tcp_port);
@@ -769,7 +784,7 @@ void kissnet_send_rec_packet (int chan, int kiss_cmd, unsigned char *fbuf, int f
 	            WSACleanup();
 	          }
 #else
-                  err = SOCK_SEND (kps->client_sock[client], kiss_buff, kiss_len);
+                  err = SOCK_SEND (kps->client_sock[client], send_buff, send_len);
 	          if (err <= 0) {
 	            text_color_set(DW_COLOR_ERROR);
 	            dw_printf ("\nError %d sending message to KISS client application %d on port %d.  Closing connection.\n\n", err, client, kps->tcp_port);
@@ -78,6 +78,14 @@
  *		With normal AX.25 a couple frames can come and go during that time.	
  *		We want to delay the duplicate removal while FX.25 block reception
  *		is going on.
+ *
+ * New in version 1.8:
+ *
+ *		Candidates are indexed by CRC and frame length as they arrive
+ *		so duplicates from different decoders are found without
+ *		comparing every pair.  Once every decoder for the channel has
+ *		a candidate, nothing else can show up for that group, so the
+ *		best is picked right away rather than waiting the full time.
  *		
  *------------------------------------------------------------------*/
 
@@ -103,6 +111,9 @@
 #include "fx25.h"
 #include "version.h"
 #include "ais.h"
+#include "demod_pool.h"
+#include "fix_pool.h"
+#include "rx_stats.h"
 
 
 
@@ -113,7 +124,7 @@ static struct audio_s          *save_audio_config_p;
 
 // Candidates for further processing.
 
-static struct {
+static struct candidate_s {
 	packet_t packet_p;
 	alevel_t alevel;
 	float speed_error;
@@ -123,12 +134,42 @@ static struct {
 				// It would be 0 to something around 4.
 				// For FX.25, it is the number of corrected.
 				// This could be from 0 thru 32.
-	int age;
+	int age;		// Number of samples since found.
+	int64_t born;		// Value of chan_clock for the audio sample
+				// where it was found.
 	unsigned int crc;
+	int flen;		// Frame length.  Duplicates have the same crc & flen.
 	int score;
+	struct candidate_s *dup_next;	// Next with same crc & flen.  See dedupe below.
 } candidate[MAX_CHANS][MAX_SUBCHANS][MAX_SLICERS];
 
 
+// Index of candidates by crc & frame length.
+// Each entry is the head of a list of duplicates thru dup_next.
+// Usually there is only one, or a few if there is a collision.
+// With more than one demodulator thread, candidates are added
+// concurrently, each to its own slot.  The index is shared by all
+// of them so it is built on the channel thread when a group is picked.
+
+#define MAX_BARS (MAX_SUBCHANS * MAX_SLICERS)
+
+static struct dedupe_s {
+	unsigned int crc;
+	int flen;
+	int count;
+	struct candidate_s *first;
+} dedupe[MAX_CHANS][MAX_BARS];
+
+static int num_dedupe[MAX_CHANS];
+
+static void dedupe_build (int chan);
+
+
+// Count of audio samples processed for each channel.
+
+static int64_t chan_clock[MAX_CHANS];
+
+
 
 //#define PROCESS_AFTER_BITS 2		// version 1.4.  Was a little short for skew of PSK with different modem types, optional pre-filter
 
@@ -137,7 +178,28 @@ static struct {
 
 static int process_age[MAX_CHANS];
 
-static void pick_best_candidate (int chan);
+
+/*
+ * Frames being fixed by the worker threads are waited for, in
+ * the same way, up to this many bits after they were received.
+ * It is less than the shortest possible frame so the next one,
+ * from the same slicer, can't show up before we are done.
+ */
+
+#define FIX_DEADLINE_BITS 64
+
+static int fix_deadline[MAX_CHANS];
+
+static void pick_best_candidate (int chan, int64_t before);
+static void demod_all_block (int chan, const int16_t *samples, int n);
+
+static void age_candidates (int chan, int64_t now);
+
+static void add_candidate (int chan, int subchan, int slice, packet_t pp, alevel_t alevel, retry_t retries, fec_type_t fec_type, int64_t born);
+static void add_fixed_frame (struct fix_job_s *job);
+static packet_t rec_frame_to_packet (int chan, unsigned char *fbuf, int flen, alevel_t alevel);
+
+static void demod_subchan_block (void *arg, int task);
 
 
 
@@ -168,6 +230,12 @@ void multi_modem_init (struct audio_s *pa)
 	save_audio_config_p = pa;
 
 	memset (candidate, 0, sizeof(candidate));
+	memset (dedupe, 0, sizeof(dedupe));
+	memset (num_dedupe, 0, sizeof(num_dedupe));
+	memset (chan_clock, 0, sizeof(chan_clock));
+
+	demod_pool_init (pa->demod_threads);
+	fix_pool_init (pa->fix_threads, 0);
 
 	demod_init (save_audio_config_p);
 	hdlc_rec_init (save_audio_config_p);
@@ -183,7 +251,10 @@ void multi_modem_init (struct audio_s *pa)
 	    if (save_audio_config_p->achan[chan].modem_type == MODEM_QPSK) real_baud = save_audio_config_p->achan[chan].baud / 2;
 	    if (save_audio_config_p->achan[chan].modem_type == MODEM_8PSK) real_baud = save_audio_config_p->achan[chan].baud / 3;
 
-	    process_age[chan] = PROCESS_AFTER_BITS * save_audio_config_p->adev[ACHAN2ADEV(chan)].samples_per_sec / real_baud ;
+	    // Demodulators might be running at a reduced sample rate.
+
+	    process_age[chan] = PROCESS_AFTER_BITS * save_audio_config_p->adev[ACHAN2ADEV(chan)].samples_per_sec / real_baud / demod_front_end_factor(chan);
+	    fix_deadline[chan] = FIX_DEADLINE_BITS * save_audio_config_p->adev[ACHAN2ADEV(chan)].samples_per_sec / save_audio_config_p->achan[chan].baud / demod_front_end_factor(chan);
 	    //crc_queue_of_last_to_app[chan] = NULL;
 	  }
 	}
@@ -235,7 +306,6 @@ __attribute__((hot))
 void multi_modem_process_sample (int chan, int audio_sample) 
 {
 	int d;
-	int subchan;
 
 // Accumulate an average DC bias level.
 // Shouldn't happen with a soundcard but could with mistuned SDR.
@@ -260,36 +330,293 @@ void multi_modem_process_sample (int chan, int audio_sample)
 	  exit (EXIT_FAILURE);
 	}
 
+	/* Shared front end might reduce the sample rate. */
+
+	if (demod_front_end_factor(chan) > 1) {
+	  int16_t in = audio_sample;
+	  int16_t out;
+
+	  if (demod_front_end_block (chan, &in, 1, &out) == 0) {
+	    return;
+	  }
+	  audio_sample = out;
+	}
+
 	/* Formerly one loop. */
 	/* 1.2: We can feed one demodulator but end up with multiple outputs. */
 
 	/* Send same thing to all. */
+	int16_t sam16 = audio_sample;
+	demod_shared_block (chan, &sam16, 1);
+
 	for (d = 0; d < save_audio_config_p->achan[chan].num_subchan; d++) {
 	  demod_process_sample(chan, d, audio_sample);
 	}
 
-	for (subchan = 0; subchan < save_audio_config_p->achan[chan].num_subchan; subchan++) {
-	  int slice;
+	chan_clock[chan]++;
+	rx_stats_add (&(rx_stats_chan(chan)->samples), 1);
+	age_candidates (chan, chan_clock[chan]);
+}
 
-	  for (slice = 0; slice < save_audio_config_p->achan[chan].num_slicers; slice++) {
 
-	    if (candidate[chan][subchan][slice].packet_p != NULL) {
-	      candidate[chan][subchan][slice].age++;
-	      if (candidate[chan][subchan][slice].age > process_age[chan]) {
-	        if (fx25_rec_busy(chan)) {
-		  candidate[chan][subchan][slice].age = 0;
+/*------------------------------------------------------------------------------
+ *
+ * Name:	multi_modem_process_block
+ *
+ * Purpose:	Feed a buffer of samples into the proper modem(s) for the channel.
+ *
+ * Inputs:	chan	- Radio channel number
+ *
+ *		samples	- Audio for this channel only, not interleaved.
+ *
+ *		n	- Number of samples.
+ *
+ * Description:	Same result as calling multi_modem_process_sample for each
+ *		sample but each demodulator gets to run through many samples
+ *		at a time rather than switching between them for every sample.
+ *
+ *		The candidates, from different demodulators and slicers,
+ *		are collected for PROCESS_AFTER_BITS before picking the best.
+ *		Each one is marked with the time (sample count) when it
+ *		was found so we can still do that after all demodulators
+ *		have gone through the whole block.
+ *
+ *		With the DEMODTHREADS configuration option, the demodulators
+ *		for a channel are run in parallel.  See demod_pool.c.
+ *
+ *------------------------------------------------------------------------------*/
+
+struct block_job_s {
+	int chan;
+	const int16_t *samples;
+	int n;
+};
+
+__attribute__((hot))
+void multi_modem_process_block (int chan, const int16_t *samples, int n)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	if (save_audio_config_p->achan[chan].num_subchan <= 0 || save_audio_config_p->achan[chan].num_subchan > MAX_SUBCHANS ||
+	    save_audio_config_p->achan[chan].num_slicers <= 0 || save_audio_config_p->achan[chan].num_slicers > MAX_SLICERS) {
+
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("ERROR!  Something is seriously wrong in %s %s.\n", __FILE__, __func__);
+	  dw_printf ("chan = %d, num_subchan = %d [max %d], num_slicers = %d [max %d]\n", chan,
+									save_audio_config_p->achan[chan].num_subchan, MAX_SUBCHANS,
+									save_audio_config_p->achan[chan].num_slicers, MAX_SLICERS);
+	  dw_printf ("Please report this message and include a copy of your configuration file.\n");
+	  exit (EXIT_FAILURE);
+	}
+
+	float dc = dc_average[chan];
+	for (int k = 0; k < n; k++) {
+	  dc = dc * 0.999f + (float)samples[k] * 0.001f;
+	}
+	dc_average[chan] = dc;
+
+/*
+ * Shared front end might reduce the sample rate.
+ * Take it in chunks that fit into our buffer after reduction.
+ */
+	int factor = demod_front_end_factor(chan);
+
+	if (factor > 1) {
+	  int16_t reduced[256];
+	  int chunk = 256 * factor;
+
+	  for (int off = 0; off < n; off += chunk) {
+	    int len = n - off < chunk ? n - off : chunk;
+	    int m = demod_front_end_block (chan, samples + off, len, reduced);
+	    if (m > 0) {
+	      demod_all_block (chan, reduced, m);
+	    }
+	  }
+	}
+	else {
+	  demod_all_block (chan, samples, n);
+	}
+}
+
+
+/*
+ * All demodulators for the channel, at the demodulator sample rate.
+ */
+
+__attribute__((hot))
+static void demod_all_block (int chan, const int16_t *samples, int n)
+{
+/*
+ * First anything that can be done once for all of them.
+ * Then each demodulator goes thru the whole block.
+ * They are independent of each other so they can be run
+ * in parallel when we have more than one.
+ */
+	uint64_t start = rx_stats_clock();
+
+	demod_shared_block (chan, samples, n);
+
+	struct block_job_s job;
+	job.chan = chan;
+	job.samples = samples;
+	job.n = n;
+
+	int num_subchan = save_audio_config_p->achan[chan].num_subchan;
+
+	if (num_subchan > 1 && demod_pool_size() > 1) {
+	  demod_pool_run (num_subchan, demod_subchan_block, &job);
+	}
+	else {
+	  for (int d = 0; d < num_subchan; d++) {
+	    demod_subchan_block (&job, d);
+	  }
+	}
+
+	rx_stats_time (chan, RX_STAGE_DEMOD, start);
+	rx_stats_add (&(rx_stats_chan(chan)->samples), n);
+
+/*
+ * Now catch up with the candidates as if the demodulators
+ * had been run together, one sample at a time.
+ */
+	age_candidates (chan, chan_clock[chan] + n);
+	chan_clock[chan] += n;
+}
+
+
+/*
+ * One demodulator for a whole block.
+ */
+
+__attribute__((hot))
+static void demod_subchan_block (void *arg, int subchan)
+{
+	struct block_job_s *job = arg;
+
+	demod_process_block (job->chan, subchan, job->samples, job->n);
+}
+
+
+/*
+ * Candidates get older as more samples are processed.
+ * Pick the best when the oldest has waited long enough.
+ * now is the chan_clock value after the audio just processed.
+ *
+ * After a block, several groups of candidates could be ready.
+ * Take them in order, each group at the time it would have been
+ * picked if we went one sample at a time.  Any found later are
+ * not mixed in.
+ *
+ * Frames fixed by worker threads are added with the time they were
+ * received, not when the work was finished.  A group is not picked
+ * while there is still work in progress for it.
+ *
+ * If every decoder already has a candidate for the group, and nothing
+ * is in progress, there is no reason to wait any longer.
+ */
+
+static void age_candidates (int chan, int64_t now)
+{
+	// Results from worker threads fixing bits.  Give up on those taking too long.
+
+	if (fix_pool_size() > 0) {
+	  fix_pool_cancel (chan, now - fix_deadline[chan]);
+	  fix_pool_collect (chan, add_fixed_frame);
+	}
+
+	int num_bars = save_audio_config_p->achan[chan].num_subchan * save_audio_config_p->achan[chan].num_slicers;
+
+	while (1) {
+	  int subchan, slice;
+	  int found = 0;
+	  int64_t oldest = now;
+
+	  for (subchan = 0; subchan < save_audio_config_p->achan[chan].num_subchan; subchan++) {
+	    for (slice = 0; slice < save_audio_config_p->achan[chan].num_slicers; slice++) {
+	      if (candidate[chan][subchan][slice].packet_p != NULL) {
+	        candidate[chan][subchan][slice].age = now - candidate[chan][subchan][slice].born;
+	        if ( ! found || candidate[chan][subchan][slice].born < oldest) {
+	          oldest = candidate[chan][subchan][slice].born;
+	        }
+	        found++;
+	      }
+	    }
+	  }
+
+	  if ( ! found) {
+	    return;
+	  }
+
+	  if (now - oldest <= process_age[chan]) {
+
+	    // Not old enough but maybe we already have them all.
+
+	    if (found < num_bars) {
+	      return;
+	    }
+	    for (subchan = 0; subchan < save_audio_config_p->achan[chan].num_subchan; subchan++) {
+	      for (slice = 0; slice < save_audio_config_p->achan[chan].num_slicers; slice++) {
+	        if (candidate[chan][subchan][slice].born > oldest + process_age[chan]) {
+	          return;
 	        }
-	        else {
-	          pick_best_candidate (chan);
+	      }
+	    }
+	  }
+
+	  if (fx25_rec_busy(chan)) {
+
+	    // Wait until FX.25 decoding is done.  Start the clock over.
+
+	    for (subchan = 0; subchan < save_audio_config_p->achan[chan].num_subchan; subchan++) {
+	      for (slice = 0; slice < save_audio_config_p->achan[chan].num_slicers; slice++) {
+	        if (candidate[chan][subchan][slice].packet_p != NULL &&
+		    now - candidate[chan][subchan][slice].born > process_age[chan]) {
+		  candidate[chan][subchan][slice].age = 0;
+		  candidate[chan][subchan][slice].born = now;
 	        }
 	      }
 	    }
+	    return;
 	  }
+
+	  if (fix_pool_busy(chan, oldest + process_age[chan])) {
+
+	    // Another slicer might be getting the same frame by fixing bits.
+	    // Wait until it is done or cancelled.
+
+	    return;
+	  }
+
+	  uint64_t start = rx_stats_clock();
+	  pick_best_candidate (chan, oldest + process_age[chan]);
+	  rx_stats_time (chan, RX_STAGE_PICK, start);
 	}
 }
 
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        multi_modem_clock
+ *
+ * Purpose:     Time stamp for something found now by a demodulator.
+ *
+ * Inputs:	chan	- Audio channel number.
+ *		subchan	- Which demodulator.
+ *
+ * Returns:	Number of samples processed by demodulators for the channel.
+ *		When a block is being processed, this includes the
+ *		position within the block for that demodulator.
+ *
+ *--------------------------------------------------------------------*/
+
+int64_t multi_modem_clock (int chan, int subchan)
+{
+	return (chan_clock[chan] + demod_block_position(chan, subchan));
+}
+
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        multi_modem_process_rec_frame
@@ -323,6 +650,16 @@ void multi_modem_process_rec_frame (int chan, int subchan, int slice, unsigned c
 	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
 	assert (slice >= 0 && slice < MAX_SUBCHANS);
 
+	pp = rec_frame_to_packet (chan, fbuf, flen, alevel);
+
+	multi_modem_process_rec_packet (chan, subchan, slice, pp, alevel, retries, fec_type);
+}
+
+
+static packet_t rec_frame_to_packet (int chan, unsigned char *fbuf, int flen, alevel_t alevel)
+{
+	packet_t pp;
+
 // Special encapsulation for AIS & EAS so they can be treated normally pretty much everywhere else.
 
 	if (save_audio_config_p->achan[chan].modem_type == MODEM_AIS) {
@@ -347,7 +684,7 @@ void multi_modem_process_rec_frame (int chan, int subchan, int slice, unsigned c
 	  pp = ax25_from_frame (fbuf, flen, alevel);
 	}
 
-	multi_modem_process_rec_packet (chan, subchan, slice, pp, alevel, retries, fec_type);
+	return (pp);
 }
 
 // TODO: Eliminate function above and move code elsewhere?
@@ -366,7 +703,8 @@ void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t
  */
 	if (save_audio_config_p->achan[chan].num_subchan == 1 &&
 	    save_audio_config_p->achan[chan].num_slicers == 1 &&
-	    ! fx25_rec_busy(chan)) {
+	    ! fx25_rec_busy(chan) &&
+	    ! fix_pool_busy(chan, INT64_MAX)) {
 
 
 	  int drop_it = 0;
@@ -387,6 +725,7 @@ void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t
 	    ax25_delete (pp);
 	  }
 	  else {
+	    rx_stats_add (&(rx_stats_chan(chan)->frames), 1);
 	    dlq_rec_frame (chan, subchan, slice, pp, alevel, fec_type, retries, "");
 	  }
 	  return;
@@ -396,6 +735,40 @@ void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t
 /*
  * Otherwise, save them up for a few bit times so we can pick the best.
  */
+	add_candidate (chan, subchan, slice, pp, alevel, retries, fec_type, multi_modem_clock(chan, subchan));
+}
+
+
+/*
+ * A frame was fixed by a worker thread.
+ * Always goes thru the candidates so it doesn't get ahead of
+ * anything received after it.
+ */
+
+static void add_fixed_frame (struct fix_job_s *job)
+{
+	packet_t pp = rec_frame_to_packet (job->chan, job->frame, job->flen, job->alevel);
+
+	if (pp == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Unexpected internal problem, %s %d\n", __FILE__, __LINE__);
+	  return;
+	}
+
+	add_candidate (job->chan, job->subchan, job->slice, pp, job->alevel, job->retries, fec_type_none, job->born);
+}
+
+
+static void add_candidate (int chan, int subchan, int slice, packet_t pp, alevel_t alevel, retry_t retries, fec_type_t fec_type, int64_t born)
+{
+	if (candidate[chan][subchan][slice].packet_p != NULL &&
+	    candidate[chan][subchan][slice].born > born) {
+	  /* Fixed frame finished after the next one from the same slicer. */
+	  /* Should not happen with the deadline.  Keep the newer one. */
+	  ax25_delete (pp);
+	  return;
+	}
+
 	if (candidate[chan][subchan][slice].packet_p != NULL) {
 	  /* Plain old AX.25: Oops!  Didn't expect it to be there. */
 	  /* FX.25: Quietly replace anything already there.  It will have priority. */
@@ -410,7 +783,52 @@ void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t
 	candidate[chan][subchan][slice].fec_type = fec_type;
 	candidate[chan][subchan][slice].retries = retries;
 	candidate[chan][subchan][slice].age = 0;
+	candidate[chan][subchan][slice].born = born;
 	candidate[chan][subchan][slice].crc = ax25_m_m_crc(pp);
+	candidate[chan][subchan][slice].flen = ax25_get_frame_len(pp);
+}
+
+
+/*
+ * Index the candidates of the group being picked.
+ * Only called from the channel thread, after the demodulators
+ * are done with the block, so nothing else touches it.
+ */
+
+static void dedupe_build (int chan)
+{
+	num_dedupe[chan] = 0;
+
+	for (int j = 0; j < MAX_SUBCHANS; j++) {
+	  for (int k = 0; k < MAX_SLICERS; k++) {
+	    struct candidate_s *c = &candidate[chan][j][k];
+	    int i;
+
+	    if (c->packet_p == NULL) {
+	      continue;
+	    }
+
+	    for (i = 0; i < num_dedupe[chan]; i++) {
+	      if (dedupe[chan][i].crc == c->crc && dedupe[chan][i].flen == c->flen) {
+	        break;
+	      }
+	    }
+
+	    struct dedupe_s *d = &dedupe[chan][i];
+	    if (i == num_dedupe[chan]) {
+	      assert (i < MAX_BARS);
+	      num_dedupe[chan]++;
+	      d->crc = c->crc;
+	      d->flen = c->flen;
+	      d->count = 0;
+	      d->first = NULL;
+	    }
+
+	    c->dup_next = d->first;
+	    d->first = c;
+	    d->count++;
+	  }
+	}
 }
 
 
@@ -439,11 +857,28 @@ void multi_modem_process_rec_packet (int chan, int subchan, int slice, packet_t
 #define slice_from_n(x)   ((x) / save_audio_config_p->achan[chan].num_subchan)
 
 
-static void pick_best_candidate (int chan) 
+static void pick_best_candidate (int chan, int64_t before)
 {
 	int best_n, best_score;
 	char spectrum[MAX_SUBCHANS*MAX_SLICERS+1];
 	int n, j, k;
+
+	/* Any found after 'before' are for the next round. */
+	/* Set them aside so they don't get mixed up with these. */
+
+	struct candidate_s later[MAX_SUBCHANS][MAX_SLICERS];
+	int num_later = 0;
+
+	memset (later, 0, sizeof(later));
+	for (j = 0; j < MAX_SUBCHANS; j++) {
+	  for (k = 0; k < MAX_SLICERS; k++) {
+	    if (candidate[chan][j][k].packet_p != NULL && candidate[chan][j][k].born > before) {
+	      later[j][k] = candidate[chan][j][k];
+	      candidate[chan][j][k].packet_p = NULL;
+	      num_later++;
+	    }
+	  }
+	}
 	if (save_audio_config_p->achan[chan].num_slicers < 1) {
 	  save_audio_config_p->achan[chan].num_slicers = 1;
 	}
@@ -503,25 +938,22 @@ static void pick_best_candidate (int chan)
 
 
 	/* Bump it up slightly if others nearby have the same CRC. */
+	/* Only those in the same list of duplicates need to be compared. */
 
-	for (n = 0; n < num_bars; n++) {
-	  int m;
+	dedupe_build (chan);
 
-	  j = subchan_from_n(n);
-	  k = slice_from_n(n);
+	for (int i = 0; i < num_dedupe[chan]; i++) {
+	  for (struct candidate_s *a = dedupe[chan][i].first; a != NULL; a = a->dup_next) {
+	    int ai = a - &candidate[chan][0][0];
+	    int an = (ai % MAX_SLICERS) * save_audio_config_p->achan[chan].num_subchan + ai / MAX_SLICERS;
 
-	  if (candidate[chan][j][k].packet_p != NULL) {
+	    for (struct candidate_s *b = a->dup_next; b != NULL; b = b->dup_next) {
+	      int bi = b - &candidate[chan][0][0];
+	      int bn = (bi % MAX_SLICERS) * save_audio_config_p->achan[chan].num_subchan + bi / MAX_SLICERS;
+	      int bump = (num_bars+1) - abs(an-bn);
 
-	    for (m = 0; m < num_bars; m++) {
-
-	      int mj = subchan_from_n(m);
-	      int mk = slice_from_n(m);
-
-	      if (m != n && candidate[chan][mj][mk].packet_p != NULL) {
-	        if (candidate[chan][j][k].crc == candidate[chan][mj][mk].crc) {
-	          candidate[chan][j][k].score += (num_bars+1) - abs(m-n);
-	        }
-	      }
+	      a->score += bump;
+	      b->score += bump;
 	    }
 	  }
 	}
@@ -612,6 +1044,7 @@ static void pick_best_candidate (int chan)
 	}
 	else {
 	  assert (candidate[chan][j][k].packet_p != NULL);
+	  rx_stats_add (&(rx_stats_chan(chan)->frames), 1);
 	  dlq_rec_frame (chan, j, k,
 		candidate[chan][j][k].packet_p,
 		candidate[chan][j][k].alevel,
@@ -626,6 +1059,11 @@ static void pick_best_candidate (int chan)
 	/* Clear in preparation for next time. */
 
 	memset (candidate[chan], 0, sizeof(candidate[chan]));
+	num_dedupe[chan] = 0;
+
+	if (num_later > 0) {
+	  memcpy (candidate[chan], later, sizeof(later));
+	}
 
 } /* end pick_best_candidate */
 
@@ -3,6 +3,8 @@
 #ifndef MULTI_MODEM_H
 #define MULTI_MODEM 1
 
+#include <stdint.h>
+
 /* Needed for typedef retry_t. */
 #include "hdlc_rec2.h"
 
@@ -14,8 +16,12 @@ void multi_modem_init (struct audio_s *pmodem);
 
 void multi_modem_process_sample (int c, int audio_sample);
 
+void multi_modem_process_block (int chan, const int16_t *samples, int n);
+
 int multi_modem_get_dc_average (int chan);
 
+int64_t multi_modem_clock (int chan, int subchan);
+
 // Deprecated.  Replace with ...packet
 void multi_modem_process_rec_frame (int chan, int subchan, int slice, unsigned char *fbuf, int flen, alevel_t alevel, retry_t retries, fec_type_t fec_type);
 
@@ -64,7 +64,7 @@
  *		recv_init()		This starts up a separate thread
  *					for each audio device.
  *					Each thread reads audio samples and
- *					passes them to multi_modem_process_sample.
+ *					passes them to multi_modem_process_block.
  *
  *					The difference is that app_process_rec_frame
  *					is no longer called directly.  Instead
@@ -120,6 +120,9 @@ static void * recv_adev_thread (void *arg);
 static struct audio_s *save_pa;		/* Keep pointer to audio configuration */
 					/* for later use. */
 
+#define RECV_BLOCK_SIZE 256		/* Most samples, for each channel, passed */
+					/* to multi_modem_process_block at once. */
+
 /*------------------------------------------------------------------
  *
  * Name:        recv_init
@@ -218,25 +221,27 @@ static void * recv_adev_thread (void *arg)
 #endif
 /*
  * Get sound samples and decode them.
+ * We take whatever is available, up to a block for each channel,
+ * so each demodulator can go through many at a time.
  */
 	eof = 0;
 	while ( ! eof) 
 	{
-
-	  int audio_sample;
+	  int16_t block[2][RECV_BLOCK_SIZE];	// Only mono or stereo.
+	  int n;
 	  int c;
-	  char tt;
+
+	  n = audio_read_samples (a, &(block[0][0]), RECV_BLOCK_SIZE);
+	  if (n < 0) {
+	    eof = 1;
+	    continue;
+	  }
 
 	  for (c=0; c<num_chan; c++)
 	  {
-	    audio_sample = demod_get_sample (a);
-	  
- 	    if (audio_sample >= 256 * 256) 
-	      eof = 1;
-
 	    // Future?  provide more flexible mapping.
 	    // i.e. for each valid channel where audio_source[] is first_chan+c.
-	    multi_modem_process_sample(first_chan + c, audio_sample);
+	    multi_modem_process_block (first_chan + c, block[c], n);
 
 
 	    /* Originally, the DTMF decoder was always active. */
@@ -259,9 +264,12 @@ static void * recv_adev_thread (void *arg)
 	    /* sequences arriving at the same instant. */
 
 	    if (save_pa->achan[first_chan + c].dtmf_decode != DTMF_DECODE_OFF) {
-	      tt = dtmf_sample (first_chan + c, audio_sample/16384.);
-	      if (tt != ' ') {
-	        aprs_tt_button (first_chan + c, tt);
+	      int k;
+	      for (k = 0; k < n; k++) {
+	        char tt = dtmf_sample (first_chan + c, block[c][k]/16384.);
+	        if (tt != ' ') {
+	          aprs_tt_button (first_chan + c, tt);
+	        }
 	      }
 	    }
 	  }  // for c is just 0 or 0 then 1
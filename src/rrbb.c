@@ -31,6 +31,20 @@
  *
  * Version 1.3:	Store as bytes rather than packing 8 bits per byte.
  *
+ *		Also keep the demodulator's confidence for each bit so
+ *		the bit fix up attempts can try the doubtful ones first.
+ *
+ * Version 1.8:	Back to packing bits, 32 per word now, so the HDLC decoder
+ *		can work on a word at a time.  Quality stays one byte per bit.
+ *		Fewer levels made the bit fix up ordering worse.
+ *
+ *		Keep a few recently deleted buffers on a list, for each
+ *		thread, and reuse them rather than going back to malloc
+ *		for each frame from each demodulator and slicer.
+ *		A buffer is usually deleted by the same thread that got it,
+ *		after hdlc_rec2_block.  Those finished by a bit fix up worker
+ *		thread end up on its list, up to the limit, then are freed.
+ *
  *******************************************************************************/
 
 #define RRBB_C
@@ -45,14 +59,64 @@
 #include "textcolor.h"
 #include "ax25_pad.h"
 #include "rrbb.h"
+#include "fix_pool.h"		/* for FIX_POOL_MAX_JOBS */
 
 
 #define MAGIC1 0x12344321
 #define MAGIC2 0x56788765
 
 
-volatile static int new_count = 0;
-volatile static int delete_count = 0;
+/*
+ * For detecting a memory leak.
+ * Updated by the demodulator and bit fixing threads at the same time
+ * so atomic operations are needed.
+ * Blocks waiting in fix_pool jobs are in use, not leaked.
+ */
+
+static int new_count = 0;
+static int delete_count = 0;
+
+#define LEAK_THRESHOLD (100 + FIX_POOL_MAX_JOBS)
+
+
+#define POOL_MAX 16		/* Maximum number of free buffers kept for each thread. */
+
+static __thread rrbb_t pool_head = NULL;
+static __thread int pool_count = 0;
+
+/*
+ * Free a thread's list when the thread ends.
+ * Not done for Windows, which doesn't keep a list.  See ax25_pad.c.
+ */
+
+#if __WIN32__
+
+#undef POOL_MAX
+#define POOL_MAX 0
+
+#else
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+static __thread int pool_key_set = 0;
+
+static void pool_drain (void *unused)
+{
+	while (pool_head != NULL) {
+	  rrbb_t b = pool_head;
+	  pool_head = b->nextp;
+	  free (b);
+	}
+	pool_count = 0;
+	pool_key_set = 0;
+}
+
+static void pool_key_create (void)
+{
+	pthread_key_create (&pool_key, pool_drain);
+}
+
+#endif
 
 
 /***********************************************************************************
@@ -75,7 +139,7 @@ volatile static int delete_count = 0;
  *
  * Returns:	Handle to be used by other functions.
  *		
- * Description:	
+ * Description:	Reuse one from this thread's free list if available.
  *
  ***********************************************************************************/
 
@@ -87,7 +151,14 @@ rrbb_t rrbb_new (int chan, int subchan, int slice, int is_scrambled, int descram
 	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
 	assert (slice >= 0 && slice < MAX_SLICERS);
 
-	result = malloc(sizeof(struct rrbb_s));
+	if (pool_head != NULL) {
+	  result = pool_head;
+	  pool_head = result->nextp;
+	  pool_count--;
+	}
+	else {
+	  result = malloc(sizeof(struct rrbb_s));
+	}
 	if (result == NULL) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("FATAL ERROR: Out of memory.\n");
@@ -99,11 +170,12 @@ rrbb_t rrbb_new (int chan, int subchan, int slice, int is_scrambled, int descram
 	result->slice = slice;
 	result->magic2 = MAGIC2;
 
-	new_count++;
+	int nnew = __atomic_add_fetch (&new_count, 1, __ATOMIC_RELAXED);
+	int ndel = __atomic_load_n (&delete_count, __ATOMIC_RELAXED);
 
-	if (new_count > delete_count + 100) {
+	if (nnew > ndel + LEAK_THRESHOLD) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("MEMORY LEAK, rrbb_new, new_count=%d, delete_count=%d\n", new_count, delete_count);
+	  dw_printf ("MEMORY LEAK, rrbb_new, new_count=%d, delete_count=%d\n", nnew, ndel);
 	}
 
 	rrbb_clear (result, is_scrambled, descram_state, prev_descram);
@@ -158,6 +230,7 @@ void rrbb_clear (rrbb_t b, int is_scrambled, int descram_state, int prev_descram
  *
  * Inputs:	Handle for sample array.
  *		Value for the sample.
+ *		Quality, 0 to 100, how sure the demodulator is about it.
  *
  ***********************************************************************************/
 
@@ -223,6 +296,38 @@ int rrbb_get_len (rrbb_t b)
 /* Definition in header file so it can be inlined. */
 
 
+/***********************************************************************************
+ *
+ * Name:	rrbb_get_quality
+ *
+ * Purpose:	Get confidence of bit in specified position.
+ *
+ * Inputs:	Handle for sample array.
+ *		Index into array.
+ *
+ * Returns:	0 to 100.  Small numbers are close to the slicing threshold.
+ *
+ ***********************************************************************************/
+
+/* Definition in header file so it can be inlined. */
+
+
+/***********************************************************************************
+ *
+ * Name:	rrbb_get_words
+ *
+ * Purpose:	Get the bits packed 32 per word.
+ *
+ * Inputs:	Handle for sample array.
+ *
+ * Returns:	Array of (len + 31) / 32 words.  First bit is the least
+ *		significant bit of the first word.  Bits beyond len are undefined.
+ *
+ ***********************************************************************************/
+
+/* Definition in header file so it can be inlined. */
+
+
 
 
 /***********************************************************************************
@@ -259,7 +364,9 @@ int rrbb_get_len (rrbb_t b)
  * Purpose:	Free the storage associated with the bit array.
  *
  * Inputs:	Handle for bit array.
- *		
+ *
+ * Description:	Keep it on this thread's free list unless that is full.
+ *
  ***********************************************************************************/
 
 void rrbb_delete (rrbb_t b)
@@ -270,10 +377,24 @@ void rrbb_delete (rrbb_t b)
 
 	b->magic1 = 0;
 	b->magic2 = 0;
-	
-	free (b);
 
-	delete_count++;
+	if (pool_count < POOL_MAX) {
+#if ! __WIN32__
+	  if ( ! pool_key_set) {
+	    pthread_once (&pool_key_once, pool_key_create);
+	    pthread_setspecific (pool_key, &pool_head);
+	    pool_key_set = 1;
+	  }
+#endif
+	  b->nextp = pool_head;
+	  pool_head = b;
+	  pool_count++;
+	}
+	else {
+	  free (b);
+	}
+
+	__atomic_add_fetch (&delete_count, 1, __ATOMIC_RELAXED);
 }
 
 
@@ -3,9 +3,7 @@
 
 #define RRBB_H
 
-
-#define FASTER13 1		// Don't pack 8 samples per byte.
-
+#include <stdint.h>
 
 //typedef short slice_t;
 
@@ -24,6 +22,13 @@
 
 #define MAX_NUM_BITS (MAX_FRAME_LEN * 8 * 6 / 5)
 
+/*
+ * Bits are packed 32 per word, first received in the least significant
+ * position, so the HDLC decoder can undo NRZI and scrambling a word at a time.
+ */
+
+#define RRBB_WORDS ((MAX_NUM_BITS + 31) / 32)
+
 typedef struct rrbb_s {
 	int magic1;
 	struct rrbb_s* nextp;	/* Next pointer to maintain a queue. */
@@ -40,7 +45,8 @@ typedef struct rrbb_s {
 	int descram_state;	/* Descrambler state before first data bit of frame. */
 	int prev_descram;	/* Previous descrambled bit. */
 
-	unsigned char fdata[MAX_NUM_BITS];
+	uint32_t fdata[RRBB_WORDS];
+	unsigned char quality[MAX_NUM_BITS];	/* Confidence for each bit, 0 to 100, from demodulator. */
 
 	int magic2;
 } *rrbb_t;
@@ -52,18 +58,31 @@ rrbb_t rrbb_new (int chan, int subchan, int slice, int is_scrambled, int descram
 void rrbb_clear (rrbb_t b, int is_scrambled, int descram_state, int prev_descram);
 
 
-static inline /*__attribute__((always_inline))*/ void rrbb_append_bit (rrbb_t b, const unsigned char val)
+static inline /*__attribute__((always_inline))*/ void rrbb_append_bit (rrbb_t b, const unsigned char val, const unsigned char quality)
 {
-	if (b->len >= MAX_NUM_BITS) {
+	unsigned int n = b->len;
+
+	if (n >= MAX_NUM_BITS) {
 	  return;	/* Silently discard if full. */
 	}
-	b->fdata[b->len] = val;
+	b->fdata[n >> 5] = (b->fdata[n >> 5] & ~((uint32_t)1 << (n & 31))) | ((uint32_t)(val & 1) << (n & 31));
+	b->quality[n] = quality;
 	b->len++;
 }
 
 static inline /*__attribute__((always_inline))*/ unsigned char rrbb_get_bit (const rrbb_t b, const int ind)
 {
-	return (b->fdata[ind]);
+	return ((b->fdata[ind >> 5] >> (ind & 31)) & 1);
+}
+
+static inline /*__attribute__((always_inline))*/ unsigned char rrbb_get_quality (const rrbb_t b, const int ind)
+{
+	return (b->quality[ind]);
+}
+
+static inline /*__attribute__((always_inline))*/ const uint32_t *rrbb_get_words (const rrbb_t b)
+{
+	return (b->fdata);
 }
 
 
@@ -0,0 +1,213 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2024  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rx_stats.c
+ *
+ * Purpose:   	Keep counts of what happens in the receive path.
+ *
+ * Description:	Until now, the only way to see how well FIX_BITS or
+ *		extra slicers were working was to look at the printed
+ *		frames and the little "spectrum" display.  Here we count,
+ *		for each HDLC decoder:
+ *
+ *		  - flag patterns and possible frames found,
+ *		  - how many had a bad FCS,
+ *		  - fix up attempts and successes at each level,
+ *		  - FX.25 and IL2P blocks and symbols corrected.
+ *
+ *		For each channel, we have the number of audio samples,
+ *		frames passed along, and time spent in each part.
+ *
+ *		Counters are updated with relaxed atomic adds so they can
+ *		be bumped from any thread, including the demodulator and
+ *		bit fixing thread pools, without locking.  They are only
+ *		updated when something interesting happens, such as a flag,
+ *		or once for each block of audio, not for every bit.
+ *
+ *		The results are available from the AGW network protocol,
+ *		with the 'Q' command, and "atest -d s".
+ *
+ *---------------------------------------------------------------*/
+
+#include "direwolf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include "textcolor.h"
+#include "audio.h"
+#include "dtime_now.h"
+#include "rx_stats.h"
+
+
+static struct rx_slice_stats_s slice_stats[MAX_CHANS][MAX_SUBCHANS][MAX_SLICERS];
+
+static struct rx_chan_stats_s chan_stats[MAX_CHANS];
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rx_stats_slice
+ *
+ * Purpose:     Get counters for one HDLC decoder.
+ *
+ * Inputs:	chan, subchan, slice
+ *
+ *--------------------------------------------------------------------*/
+
+struct rx_slice_stats_s *rx_stats_slice (int chan, int subchan, int slice)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+	assert (slice >= 0 && slice < MAX_SLICERS);
+
+	return (&slice_stats[chan][subchan][slice]);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rx_stats_chan
+ *
+ * Purpose:     Get counters for a channel.
+ *
+ *--------------------------------------------------------------------*/
+
+struct rx_chan_stats_s *rx_stats_chan (int chan)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	return (&chan_stats[chan]);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rx_stats_clock
+ *
+ * Purpose:     Time, in nanoseconds, for measuring how long something took.
+ *
+ *--------------------------------------------------------------------*/
+
+uint64_t rx_stats_clock (void)
+{
+	return ((uint64_t)(dtime_monotonic() * 1.0e9));
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rx_stats_reset
+ *
+ * Purpose:     Start counting over for a channel.
+ *
+ * Description:	Something still running could add to a counter as it
+ *		is being cleared.  That's not a problem for counts.
+ *
+ *--------------------------------------------------------------------*/
+
+void rx_stats_reset (int chan)
+{
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	memset (slice_stats[chan], 0, sizeof(slice_stats[chan]));
+	memset (&chan_stats[chan], 0, sizeof(chan_stats[chan]));
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rx_stats_report
+ *
+ * Purpose:     Describe the counts for a channel as lines of text.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		fn	- Called for each line, without a newline.
+ *			  Lines are never longer than 200 characters.
+ *
+ *		arg	- Passed along to fn.
+ *
+ * Description:	First a line for the channel, then one for each
+ *		decoder that has seen anything.
+ *
+ *		"fixed" shows successes / attempts for the single, double,
+ *		triple, and two separated bit levels.
+ *
+ *--------------------------------------------------------------------*/
+
+#define NS2MS(x) ((double)rx_stats_get(&(x)) / 1.0e6)
+
+void rx_stats_report (int chan, rx_stats_line_fn_t fn, void *arg)
+{
+	char line[200];
+	struct rx_chan_stats_s *c = rx_stats_chan (chan);
+
+	snprintf (line, sizeof(line), "Channel %d: %" PRIu64 " samples, %" PRIu64 " frames.  "
+			"Milliseconds: demod %.1f, fix %.1f, fx25 %.1f, il2p %.1f, pick %.1f",
+			chan, rx_stats_get(&c->samples), rx_stats_get(&c->frames),
+			NS2MS(c->stage_ns[RX_STAGE_DEMOD]),
+			NS2MS(c->stage_ns[RX_STAGE_FIX]),
+			NS2MS(c->stage_ns[RX_STAGE_FX25]),
+			NS2MS(c->stage_ns[RX_STAGE_IL2P]),
+			NS2MS(c->stage_ns[RX_STAGE_PICK]));
+	(*fn) (arg, line);
+
+	for (int j = 0; j < MAX_SUBCHANS; j++) {
+	  for (int k = 0; k < MAX_SLICERS; k++) {
+	    struct rx_slice_stats_s *s = rx_stats_slice (chan, j, k);
+
+	    if (rx_stats_get(&s->flags) == 0 && rx_stats_get(&s->fx25_blocks) == 0 && rx_stats_get(&s->il2p_frames) == 0) {
+	      continue;
+	    }
+
+	    int n = snprintf (line, sizeof(line), "%d.%d.%d: flags %" PRIu64 ", blocks %" PRIu64 ", fcs bad %" PRIu64
+			", good %" PRIu64 ", fixed %" PRIu64 "/%" PRIu64 " %" PRIu64 "/%" PRIu64
+			" %" PRIu64 "/%" PRIu64 " %" PRIu64 "/%" PRIu64 ", passall %" PRIu64,
+			chan, j, k,
+			rx_stats_get(&s->flags), rx_stats_get(&s->blocks), rx_stats_get(&s->fcs_fail),
+			rx_stats_get(&s->fix_ok[RETRY_NONE]),
+			rx_stats_get(&s->fix_ok[RETRY_INVERT_SINGLE]), rx_stats_get(&s->fix_tried[RETRY_INVERT_SINGLE]),
+			rx_stats_get(&s->fix_ok[RETRY_INVERT_DOUBLE]), rx_stats_get(&s->fix_tried[RETRY_INVERT_DOUBLE]),
+			rx_stats_get(&s->fix_ok[RETRY_INVERT_TRIPLE]), rx_stats_get(&s->fix_tried[RETRY_INVERT_TRIPLE]),
+			rx_stats_get(&s->fix_ok[RETRY_INVERT_TWO_SEP]), rx_stats_get(&s->fix_tried[RETRY_INVERT_TWO_SEP]),
+			rx_stats_get(&s->fix_ok[RETRY_MAX]));
+
+	    if (n > 0 && n < (int)sizeof(line) && rx_stats_get(&s->fx25_blocks) > 0) {
+	      n += snprintf (line + n, sizeof(line) - n, ", fx25 %" PRIu64 " failed %" PRIu64 " corrected %" PRIu64,
+			rx_stats_get(&s->fx25_blocks), rx_stats_get(&s->fx25_failed), rx_stats_get(&s->fx25_corrected));
+	    }
+	    if (n > 0 && n < (int)sizeof(line) && rx_stats_get(&s->il2p_frames) > 0) {
+	      snprintf (line + n, sizeof(line) - n, ", il2p %" PRIu64 " failed %" PRIu64 " corrected %" PRIu64,
+			rx_stats_get(&s->il2p_frames), rx_stats_get(&s->il2p_failed), rx_stats_get(&s->il2p_corrected));
+	    }
+	    (*fn) (arg, line);
+	  }
+	}
+
+} /* end rx_stats_report */
+
+/* end rx_stats.c */
@@ -0,0 +1,104 @@
+/* rx_stats.h */
+
+#ifndef RX_STATS_H
+#define RX_STATS_H 1
+
+
+/*
+ * Counters for the receive path, so FIX_BITS, slicers, etc.
+ * can be tuned by looking rather than guessing.
+ * See rx_stats.c for details.
+ */
+
+#include <stdint.h>
+
+#include "audio.h"		/* for retry_t, MAX_CHANS, etc. */
+
+
+/* Counters for each HDLC decoder, i.e. channel, demodulator, and slicer. */
+
+struct rx_slice_stats_s {
+
+	uint64_t flags;			/* 01111110 patterns seen. */
+
+	uint64_t blocks;		/* Bits between flags, long enough to be a frame. */
+
+	uint64_t fcs_fail;		/* Of those, how many didn't have a good FCS as received. */
+
+	uint64_t fix_tried[RETRY_MAX];	/* Complete decodes attempted, for each fix up level. */
+					/* [RETRY_NONE] is not used.  See blocks. */
+
+	uint64_t fix_ok[RETRY_MAX+1];	/* Frames passed along, for each fix up level. */
+					/* [RETRY_NONE] is good the first time. */
+					/* [RETRY_MAX] is let thru by passall. */
+
+	uint64_t fx25_blocks;		/* FX.25 codeblocks after correlation tag match. */
+	uint64_t fx25_failed;		/* Too many errors to fix. */
+	uint64_t fx25_corrected;	/* Total number of symbols corrected. */
+
+	uint64_t il2p_frames;		/* IL2P frames after a good header. */
+	uint64_t il2p_failed;		/* Payload could not be recovered. */
+	uint64_t il2p_corrected;	/* Total number of symbols corrected. */
+};
+
+
+/* Time spent in each part, for a channel. */
+
+enum rx_stage_e {
+	RX_STAGE_DEMOD = 0,		/* Demodulators and HDLC decoders, for a block of audio. */
+	RX_STAGE_FIX,			/* Fixing frames with bad FCS.  Could be on other threads. */
+	RX_STAGE_FX25,			/* FX.25 Reed-Solomon decoding. */
+	RX_STAGE_IL2P,			/* IL2P decoding. */
+	RX_STAGE_PICK,			/* Picking the best of the duplicates. */
+	RX_NUM_STAGES
+};
+
+struct rx_chan_stats_s {
+
+	uint64_t samples;		/* Audio samples processed. */
+
+	uint64_t frames;		/* Passed along after removing duplicates. */
+
+	uint64_t stage_ns[RX_NUM_STAGES];	/* Nanoseconds spent in each part. */
+};
+
+
+struct rx_slice_stats_s *rx_stats_slice (int chan, int subchan, int slice);
+
+struct rx_chan_stats_s *rx_stats_chan (int chan);
+
+uint64_t rx_stats_clock (void);
+
+void rx_stats_reset (int chan);
+
+typedef void (*rx_stats_line_fn_t) (void *arg, const char *line);
+
+void rx_stats_report (int chan, rx_stats_line_fn_t fn, void *arg);
+
+
+/*
+ * These can be used from any thread without locking.
+ * Reading a counter while another thread adds to it is fine.
+ */
+
+static inline void rx_stats_add (uint64_t *counter, uint64_t n)
+{
+	__atomic_fetch_add (counter, n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t rx_stats_get (uint64_t *counter)
+{
+	return (__atomic_load_n (counter, __ATOMIC_RELAXED));
+}
+
+/* Add time since start, from rx_stats_clock, to a stage. */
+
+static inline void rx_stats_time (int chan, enum rx_stage_e stage, uint64_t start)
+{
+	rx_stats_add (&(rx_stats_chan(chan)->stage_ns[stage]), rx_stats_clock() - start);
+}
+
+
+#endif
+
+/* end rx_stats.h */
@@ -71,6 +71,9 @@
  *
  *			'd'	Disconnect, Terminate an AX.25 Connection		(new in 1.4)
  *
+ *			'Q'	Receive statistics for a port.  Dire Wolf only.		(new in 1.8)
+ *				Send "reset" as the data to start counting over.
+ *
  *		
  *			A message is printed if any others are received.
  *
@@ -105,6 +108,9 @@
  *
  *			'Y'	How many frames waiting for transmit for a particular station (new in 1.5)
  *
+ *			'Q'	Receive statistics, one line of text in each.	(new in 1.8)
+ *				An empty one marks the end.
+ *
  *			'C'	AX.25 Connection Received		(new in 1.4)
  *
  *			'D'	Connected AX.25 Data			(new in 1.4)
@@ -166,6 +172,7 @@
 #include "audio.h"
 #include "server.h"
 #include "dlq.h"
+#include "rx_stats.h"
 
 
 
@@ -282,6 +289,27 @@ struct agwpe_s {
 static void send_to_client (int client, void *reply_p);
 
 
+/*
+ * For the 'Q' command.  rx_stats_report calls send_stats_line
+ * for each line of text and we send it as a separate reply.
+ */
+
+struct stats_reply_s {
+	struct agwpe_s hdr;
+	char info[200];
+	int client;		/* Not sent. */
+};
+
+static void send_stats_line (void *arg, const char *line)
+{
+	struct stats_reply_s *reply = (struct stats_reply_s *) arg;
+
+	strlcpy (reply->info, line, sizeof(reply->info));
+	reply->hdr.data_len_NETLE = host2netle(strlen(reply->info) + 1);
+	send_to_client (reply->client, reply);
+}
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        debug_print 
@@ -360,6 +388,7 @@ static void debug_print (fromto_t fromto, int client, struct agwpe_s *pmsg, int
 	      case 'c': strlcpy (datakind, "Non-Standard Connections, Connection with PID", sizeof(datakind)); break;
 	      case 'K': strlcpy (datakind, "Send data in raw AX.25 format",		sizeof(datakind)); break;
 	      case 'k': strlcpy (datakind, "Activate reception of Frames in raw format", sizeof(datakind)); break;
+	      case 'Q': strlcpy (datakind, "Ask Receive Statistics for a Port",		sizeof(datakind)); break;
 	      default:  strlcpy (datakind, "**INVALID**",				sizeof(datakind)); break;
 	    }
 	    break;
@@ -384,6 +413,7 @@ static void debug_print (fromto_t fromto, int client, struct agwpe_s *pmsg, int
 	      case 'U': strlcpy (datakind, "Monitored Unproto Information",		sizeof(datakind)); break;
 	      case 'T': strlcpy (datakind, "Monitoring Own Information",		sizeof(datakind)); break;
 	      case 'K': strlcpy (datakind, "Monitored Information in Raw Format",	sizeof(datakind)); break;
+	      case 'Q': strlcpy (datakind, "Receive Statistics for a Port",		sizeof(datakind)); break;
 	      default:  strlcpy (datakind, "**INVALID**",				sizeof(datakind)); break;
 	    }
 	}
@@ -798,6 +828,7 @@ void server_send_rec_packet (int chan, packet_t pp, unsigned char *fbuf,  int fl
 	} agwpe_msg;
 
 	int err;
+	int built = 0;		// agwpe_msg filled in yet?
 
 /*
  * RAW format
@@ -806,22 +837,29 @@ void server_send_rec_packet (int chan, packet_t pp, unsigned char *fbuf,  int fl
 
 	  if (enable_send_raw_to_client[client] && client_sock[client] > 0){
 
-	    memset (&agwpe_msg.hdr, 0, sizeof(agwpe_msg.hdr));
+	    // Same for every client so build it only the first time.
+
+	    if (! built) {
+
+	      memset (&agwpe_msg.hdr, 0, sizeof(agwpe_msg.hdr));
+
+	      agwpe_msg.hdr.portx = chan;
 
-	    agwpe_msg.hdr.portx = chan;
+	      agwpe_msg.hdr.datakind = 'K';
 
-	    agwpe_msg.hdr.datakind = 'K';
+	      ax25_get_addr_with_ssid (pp, AX25_SOURCE, agwpe_msg.hdr.call_from);
 
-	    ax25_get_addr_with_ssid (pp, AX25_SOURCE, agwpe_msg.hdr.call_from);
+	      ax25_get_addr_with_ssid (pp, AX25_DESTINATION, agwpe_msg.hdr.call_to);
 
-	    ax25_get_addr_with_ssid (pp, AX25_DESTINATION, agwpe_msg.hdr.call_to);
+	      agwpe_msg.hdr.data_len_NETLE = host2netle(flen + 1);
 
-	    agwpe_msg.hdr.data_len_NETLE = host2netle(flen + 1);
+	      /* Stick in extra byte for the "TNC" to use. */
 
-	    /* Stick in extra byte for the "TNC" to use. */
+	      agwpe_msg.data[0] = 0;
+	      memcpy (agwpe_msg.data + 1, fbuf, (size_t)flen);
 
-	    agwpe_msg.data[0] = 0;
-	    memcpy (agwpe_msg.data + 1, fbuf, (size_t)flen);
+	      built = 1;
+	    }
 
 	    if (debug_client) {
 	      debug_print (TO_CLIENT, client, &agwpe_msg.hdr, sizeof(agwpe_msg.hdr) + netle2host(agwpe_msg.hdr.data_len_NETLE));
@@ -873,71 +911,79 @@ void server_send_monitored (int chan, packet_t pp, int own_xmit)
 	} agwpe_msg;
 
 	int err;
+	int built = 0;		// agwpe_msg filled in yet?
 
 	for (int client=0; client<MAX_NET_CLIENTS; client++) {
 
 	  if (enable_send_monitor_to_client[client] && client_sock[client] > 0) {
 
-	    memset (&agwpe_msg.hdr, 0, sizeof(agwpe_msg.hdr));
+	    // Same for every client so build it only the first time.
 
-	    agwpe_msg.hdr.portx = chan;	// datakind is added later.
-	    ax25_get_addr_with_ssid (pp, AX25_SOURCE, agwpe_msg.hdr.call_from);
-	    ax25_get_addr_with_ssid (pp, AX25_DESTINATION, agwpe_msg.hdr.call_to);
+	    if (! built) {
 
-	    /* http://uz7ho.org.ua/includes/agwpeapi.htm#_Toc500723812 */
+	      memset (&agwpe_msg.hdr, 0, sizeof(agwpe_msg.hdr));
 
-	    /* Description mentions one CR character after timestamp but example has two. */
-	    /* Actual observed cases have only one. */
-	    /* Also need to add extra CR, CR, null at end. */
-	    /* The documentation example includes these 3 extra in the Len= value */
-	    /* but actual observed data uses only the packet info length. */
+	      agwpe_msg.hdr.portx = chan;	// datakind is added later.
+	      ax25_get_addr_with_ssid (pp, AX25_SOURCE, agwpe_msg.hdr.call_from);
+	      ax25_get_addr_with_ssid (pp, AX25_DESTINATION, agwpe_msg.hdr.call_to);
 
-	    // Documentation doesn't mention anything about including the via path.
-	    // In version 1.4, we add that to match observed behaviour.
+	      /* http://uz7ho.org.ua/includes/agwpeapi.htm#_Toc500723812 */
 
-	    // This inconsistency was reported:
-	    // Direwolf:
-	    // [AGWE-IN] 1:Fm ZL4FOX-8 To Q7P2U2 [08:25:07]`I1*l V>/"9<}[:Barts Tracker 3.83V X
-	    // AGWPE:
-	    // [AGWE-IN] 1:Fm ZL4FOX-8 To Q7P2U2 Via WIDE3-3 [08:32:14]`I0*l V>/"98}[:Barts Tracker 3.83V X
+	      /* Description mentions one CR character after timestamp but example has two. */
+	      /* Actual observed cases have only one. */
+	      /* Also need to add extra CR, CR, null at end. */
+	      /* The documentation example includes these 3 extra in the Len= value */
+	      /* but actual observed data uses only the packet info length. */
 
-	    // Format the channel and addresses, with leading and trailing space.
+	      // Documentation doesn't mention anything about including the via path.
+	      // In version 1.4, we add that to match observed behaviour.
 
-	    mon_addrs (chan, pp, (char*)(agwpe_msg.data), sizeof(agwpe_msg.data));
+	      // This inconsistency was reported:
+	      // Direwolf:
+	      // [AGWE-IN] 1:Fm ZL4FOX-8 To Q7P2U2 [08:25:07]`I1*l V>/"9<}[:Barts Tracker 3.83V X
+	      // AGWPE:
+	      // [AGWE-IN] 1:Fm ZL4FOX-8 To Q7P2U2 Via WIDE3-3 [08:32:14]`I0*l V>/"98}[:Barts Tracker 3.83V X
 
-	    // Add the description with <... >
+	      // Format the channel and addresses, with leading and trailing space.
 
-	    char desc[120];
-	    agwpe_msg.hdr.datakind = mon_desc (pp, desc, sizeof(desc));
-	    if (own_xmit) {
-	      agwpe_msg.hdr.datakind = 'T';
-	    }
-	    strlcat ((char*)(agwpe_msg.data), desc, sizeof(agwpe_msg.data));
+	      mon_addrs (chan, pp, (char*)(agwpe_msg.data), sizeof(agwpe_msg.data));
 
-	    // Timestamp with [...]\r
+	      // Add the description with <... >
 
-	    time_t clock = time(NULL);
-	    struct tm *tm = localtime(&clock);		// TODO: use localtime_r ?
-	    char ts[32];
-	    snprintf (ts, sizeof(ts), "[%02d:%02d:%02d]\r", tm->tm_hour, tm->tm_min, tm->tm_sec);
-	    strlcat ((char*)(agwpe_msg.data), ts, sizeof(agwpe_msg.data));
+	      char desc[120];
+	      agwpe_msg.hdr.datakind = mon_desc (pp, desc, sizeof(desc));
+	      if (own_xmit) {
+	        agwpe_msg.hdr.datakind = 'T';
+	      }
+	      strlcat ((char*)(agwpe_msg.data), desc, sizeof(agwpe_msg.data));
 
-	    // Information if any with \r.
+	      // Timestamp with [...]\r
 
-	    unsigned char *pinfo = NULL;
-	    int info_len = ax25_get_info (pp, &pinfo);
-	    int msg_data_len = strlen((char*)(agwpe_msg.data));	// result length so far
+	      time_t clock = time(NULL);
+	      struct tm *tm = localtime(&clock);		// TODO: use localtime_r ?
+	      char ts[32];
+	      snprintf (ts, sizeof(ts), "[%02d:%02d:%02d]\r", tm->tm_hour, tm->tm_min, tm->tm_sec);
+	      strlcat ((char*)(agwpe_msg.data), ts, sizeof(agwpe_msg.data));
 
-	    if (info_len > 0 && pinfo != NULL) {
-	      // Issue 367: Use of strlcat truncated information part at any nul character.
-	      // Use memcpy instead to preserve binary data, e.g. NET/ROM.
-	      memcpy (agwpe_msg.data + msg_data_len, pinfo, info_len);
-	      msg_data_len += info_len;
-	      agwpe_msg.data[msg_data_len++] = '\r';
-	    }
+	      // Information if any with \r.
 
-	    agwpe_msg.data[msg_data_len++] = '\0';	// add nul at end, included in length.
-	    agwpe_msg.hdr.data_len_NETLE = host2netle(msg_data_len);
+	      unsigned char *pinfo = NULL;
+	      int info_len = ax25_get_info (pp, &pinfo);
+	      int msg_data_len = strlen((char*)(agwpe_msg.data));	// result length so far
+
+	      if (info_len > 0 && pinfo != NULL) {
+	        // Issue 367: Use of strlcat truncated information part at any nul character.
+	        // Use memcpy instead to preserve binary data, e.g. NET/ROM.
+	        memcpy (agwpe_msg.data + msg_data_len, pinfo, info_len);
+	        msg_data_len += info_len;
+	        agwpe_msg.data[msg_data_len++] = '\r';
+	      }
+
+	      agwpe_msg.data[msg_data_len++] = '\0';	// add nul at end, included in length.
+	      agwpe_msg.hdr.data_len_NETLE = host2netle(msg_data_len);
+
+	      built = 1;
+	    }
 
 	    if (debug_client) {
 	      debug_print (TO_CLIENT, client, &agwpe_msg.hdr, sizeof(agwpe_msg.hdr) + netle2host(agwpe_msg.hdr.data_len_NETLE));
@@ -1692,6 +1738,42 @@ static THREAD_F cmd_listen_thread (void *arg)
 
 
 
+	    case 'Q':				/* Ask for receive statistics.  Not part of AGWPE. */
+
+	      {
+		struct stats_reply_s reply;
+
+	        memset (&reply, 0, sizeof(reply));
+		reply.hdr.portx = cmd.hdr.portx;
+	        reply.hdr.datakind = 'Q';
+		reply.client = client;
+
+		if (save_audio_config_p->chan_medium[cmd.hdr.portx] == MEDIUM_RADIO) {
+		  rx_stats_report (cmd.hdr.portx, send_stats_line, &reply);
+		  if (strcmp(cmd.data, "reset") == 0) {
+		    rx_stats_reset (cmd.hdr.portx);
+		  }
+		}
+		else {
+		  send_stats_line (&reply, "Not a radio channel.");
+		}
+
+		int qlen, qmax, qremoved;
+		double qavg, qworst;
+		char qline[120];
+
+		dlq_get_stats (&qlen, &qmax, &qremoved, &qavg, &qworst);
+		snprintf (qline, sizeof(qline), "Receive queue: length %d, max %d, %d removed.  Wait ms: avg %.1f, max %.1f",
+				qlen, qmax, qremoved, qavg * 1000., qworst * 1000.);
+		send_stats_line (&reply, qline);
+		if (strcmp(cmd.data, "reset") == 0) {
+		  dlq_reset_stats ();
+		}
+
+		send_stats_line (&reply, "");
+	      }
+	      break;
+
 	    case 'k':				/* Ask to start receiving RAW AX25 frames */
 
 	      // Actually it is a toggle so we must be sure to clear it for a new connection.
@@ -57,6 +57,11 @@
 
 static packet_t queue_head[MAX_CHANS][TQ_NUM_PRIO];	/* Head of linked list for each queue. */
 
+static packet_t queue_tail[MAX_CHANS][TQ_NUM_PRIO];	/* Last in each list, so appending doesn't walk it. */
+
+static int queue_frames[MAX_CHANS][TQ_NUM_PRIO];	/* Kept up to date so tq_count doesn't walk the */
+static int queue_bytes[MAX_CHANS][TQ_NUM_PRIO];		/* list.  Only real frames, not seize requests. */
+
 
 static dw_mutex_t tq_mutex;				/* Critical section for updating queues. */
 							/* Just one for all queues. */
@@ -77,6 +82,8 @@ static int xmit_thread_is_waiting[MAX_CHANS];
 
 static int tq_is_empty (int chan);
 
+static void append_locked (int chan, int prio, packet_t pp);
+
 
 /*-------------------------------------------------------------------
  *
@@ -131,6 +138,9 @@ void tq_init (struct audio_s *audio_config_p)
 	for (c=0; c<MAX_CHANS; c++) {
 	  for (p=0; p<TQ_NUM_PRIO; p++) {
 	    queue_head[c][p] = NULL;
+	    queue_tail[c][p] = NULL;
+	    queue_frames[c][p] = 0;
+	    queue_bytes[c][p] = 0;
 	  }
 	}
 
@@ -222,10 +232,6 @@ void tq_init (struct audio_s *audio_config_p)
 
 void tq_append (int chan, int prio, packet_t pp)
 {
-	packet_t plast;
-	packet_t pnext;
-
-
 #if DEBUG
 	unsigned char *pinfo;
 	int info_len = ax25_get_info (pp, &pinfo);
@@ -339,16 +345,7 @@ void tq_append (int chan, int prio, packet_t pp)
 
 	dw_mutex_lock (&tq_mutex);
 
-	if (queue_head[chan][prio] == NULL) {
-	  queue_head[chan][prio] = pp;
-	}
-	else {
-	  plast = queue_head[chan][prio];
-	  while ((pnext = ax25_get_nextp(plast)) != NULL) {
-	    plast = pnext;
-	  }
-	  ax25_set_nextp (plast, pp);
-	}
+	append_locked (chan, prio, pp);
 
 	dw_mutex_unlock (&tq_mutex);
 
@@ -461,10 +458,6 @@ void tq_append (int chan, int prio, packet_t pp)
 
 void lm_data_request (int chan, int prio, packet_t pp)
 {
-	packet_t plast;
-	packet_t pnext;
-
-
 #if DEBUG
 	unsigned char *pinfo;
 	int info_len = ax25_get_info (pp, &pinfo);
@@ -519,16 +512,7 @@ void lm_data_request (int chan, int prio, packet_t pp)
 	dw_mutex_lock (&tq_mutex);
 
 
-	if (queue_head[chan][prio] == NULL) {
-	  queue_head[chan][prio] = pp;
-	}
-	else {
-	  plast = queue_head[chan][prio];
-	  while ((pnext = ax25_get_nextp(plast)) != NULL) {
-	    plast = pnext;
-	  }
-	  ax25_set_nextp (plast, pp);
-	}
+	append_locked (chan, prio, pp);
 
 	dw_mutex_unlock (&tq_mutex);
 
@@ -637,10 +621,6 @@ void lm_seize_request (int chan)
 	packet_t pp;
 	int prio = TQ_PRIO_1_LO;
 
-	packet_t plast;
-	packet_t pnext;
-
-
 #if DEBUG
 	unsigned char *pinfo;
 	text_color_set(DW_COLOR_DEBUG);
@@ -676,16 +656,7 @@ void lm_seize_request (int chan)
 	dw_mutex_lock (&tq_mutex);
 
 
-	if (queue_head[chan][prio] == NULL) {
-	  queue_head[chan][prio] = pp;
-	}
-	else {
-	  plast = queue_head[chan][prio];
-	  while ((pnext = ax25_get_nextp(plast)) != NULL) {
-	    plast = pnext;
-	  }
-	  ax25_set_nextp (plast, pp);
-	}
+	append_locked (chan, prio, pp);
 
 	dw_mutex_unlock (&tq_mutex);
 
@@ -854,6 +825,14 @@ packet_t tq_remove (int chan, int prio)
 	  result_p = queue_head[chan][prio];
 	  queue_head[chan][prio] = ax25_get_nextp(result_p);
 	  ax25_set_nextp (result_p, NULL);
+
+	  if (queue_head[chan][prio] == NULL) {
+	    queue_tail[chan][prio] = NULL;
+	  }
+	  if (ax25_get_num_addr(result_p) >= AX25_MIN_ADDRS) {
+	    queue_frames[chan][prio]--;
+	    queue_bytes[chan][prio] -= ax25_get_frame_len(result_p);
+	  }
 	}
 	 
 	dw_mutex_unlock (&tq_mutex);
@@ -960,6 +939,35 @@ static int tq_is_empty (int chan)
 } /* end tq_is_empty */
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        append_locked
+ *
+ * Purpose:     Add packet to the end of a queue and update the counts.
+ *
+ * Description:	Caller must have tq_mutex.
+ *
+ *--------------------------------------------------------------------*/
+
+static void append_locked (int chan, int prio, packet_t pp)
+{
+	ax25_set_nextp (pp, NULL);
+
+	if (queue_head[chan][prio] == NULL) {
+	  queue_head[chan][prio] = pp;
+	}
+	else {
+	  ax25_set_nextp (queue_tail[chan][prio], pp);
+	}
+	queue_tail[chan][prio] = pp;
+
+	if (ax25_get_num_addr(pp) >= AX25_MIN_ADDRS) {
+	  queue_frames[chan][prio]++;
+	  queue_bytes[chan][prio] += ax25_get_frame_len(pp);
+	}
+}
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        tq_count
@@ -1015,6 +1023,19 @@ int tq_count (int chan, int prio, char *source, char *dest, int bytes)
 	  return (0);
 	}
 
+	// Usual case.  Totals are kept up to date as packets come and go.
+
+	if ((source == NULL || *source == '\0') && (dest == NULL || *dest == '\0')) {
+	  dw_mutex_lock (&tq_mutex);
+	  int n = bytes ? queue_bytes[chan][prio] : queue_frames[chan][prio];
+	  dw_mutex_unlock (&tq_mutex);
+#if DEBUG2
+	  text_color_set(DW_COLOR_DEBUG);
+	  dw_printf ("tq_count(%d, %d, \"%s\", \"%s\", %d) returns %d\n", chan, prio, source, dest, bytes, n);
+#endif
+	  return (n);
+	}
+
 	// Don't want lists being rearranged while we are traversing them.
 
 	dw_mutex_lock (&tq_mutex);
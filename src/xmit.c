@@ -72,6 +72,7 @@
 #include "hdlc_rec.h"
 #include "ptt.h"
 #include "dtime_now.h"
+#include "gen_tone.h"
 #include "morse.h"
 #include "dtmf.h"
 #include "xid.h"
@@ -745,9 +746,24 @@ static void xmit_ax25_frames (int chan, int prio, packet_t pp, int max_bundle)
 
 	int nb;
 
+/*
+ * Generate the leading flag bytes and the first frame before turning on
+ * the transmitter, so the audio can start right away when it is on.
+ * Not for the null frame from lm_seize_request.  The data link state
+ * machine needs to hear that the transmitter is on before it adds frames.
+ */
+	int early = ! ax25_is_null_frame(pp);
+
+	pre_flags = MS_TO_BITS(xmit_txdelay[chan] * 10, chan) / 8;
+
+	if (early) {
+	  gen_tone_render_start (chan);
+	  num_bits = layer2_preamble_postamble (chan, pre_flags, 0, save_audio_config_p);
+	  nb = send_one_frame (chan, prio, pp);
+	}
+
 /* 
  * Turn on transmitter.
- * Start sending leading flag bytes.
  */
 	time_ptt = dtime_now ();
 
@@ -761,12 +777,19 @@ static void xmit_ax25_frames (int chan, int prio, packet_t pp, int max_bundle)
 	ptt_set (OCTYPE_PTT, chan, 1);
 
 // Inform data link state machine that we are now transmitting.
+// Do this before sending the held audio, which can block for a while,
+// so it has time to add more frames to this transmission.
 
 	dlq_seize_confirm (chan);	// C4.2.  "This primitive indicates, to the Data-link State
 					// machine, that the transmission opportunity has arrived."
 
-	pre_flags = MS_TO_BITS(xmit_txdelay[chan] * 10, chan) / 8;
-	num_bits =  layer2_preamble_postamble (chan, pre_flags, 0, save_audio_config_p);
+	if (early) {
+	  gen_tone_render_end (chan);
+	}
+
+	if ( ! early) {
+	  num_bits = layer2_preamble_postamble (chan, pre_flags, 0, save_audio_config_p);
+	}
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("xmit_thread: t=%.3f, txdelay=%d [*10], pre_flags=%d, num_bits=%d\n", dtime_now()-time_ptt, xmit_txdelay[chan], pre_flags, num_bits);
@@ -790,10 +813,12 @@ static void xmit_ax25_frames (int chan, int prio, packet_t pp, int max_bundle)
 #endif
 
 /*
- * Transmit the frame.
+ * Transmit the frame, if not done above.
  */
 
-	nb = send_one_frame (chan, prio, pp);
+	if ( ! early) {
+	  nb = send_one_frame (chan, prio, pp);
+	}
 
 	num_bits += nb;
 	if (nb > 0) numframe++;